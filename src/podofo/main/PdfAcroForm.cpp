@@ -7,15 +7,74 @@
 #include <podofo/private/PdfDeclarationsPrivate.h>
 
 #include "PdfAcroForm.h"
+
+#include <podofo/private/ParallelUtils.h>
+#include <podofo/private/PdfDrawingOperations.h>
+
 #include "PdfArray.h"
+#include "PdfChoiceField.h"
 #include "PdfDictionary.h"
 #include "PdfDocument.h"
+#include "PdfFilter.h"
 #include "PdfFont.h"
 #include "PdfStringStream.h"
+#include "PdfTextBox.h"
+#include "PdfXObjectForm.h"
 
 using namespace std;
 using namespace PoDoFo;
 
+namespace
+{
+    // A parsed /DA default appearance string
+    struct DefaultAppearance
+    {
+        PdfName FontName;
+        double FontSize = 0;
+        // The other operators, eg. the color ones
+        string Operators;
+    };
+
+    struct AppearanceLine
+    {
+        double X;
+        double Y;
+        charbuff Encoded;
+    };
+
+    // A checked value of a field, ready to be set
+    struct FieldFill
+    {
+        PdfField* Field;
+        const PdfString* Value;
+        unsigned ItemIndex;
+    };
+
+    // The layed out normal appearance of a widget, ready to be written
+    struct AppearanceJob
+    {
+        PdfDictionary* Widget;
+        const PdfFont* Font;
+        unique_ptr<PdfXObjectForm> XObject;
+        PdfObjectStream* Stream;
+        double Width;
+        double Height;
+        string Operators;
+        PdfName FontName;
+        double FontSize;
+        bool HexStrings;
+        vector<AppearanceLine> Lines;
+        charbuff Encoded;
+    };
+}
+
+static DefaultAppearance parseDefaultAppearance(const string_view& da);
+static void collectWidgets(PdfField& field, vector<PdfDictionary*>& widgets);
+static bool setButtonState(PdfField& field, const PdfName& state);
+static void encodeAppearance(AppearanceJob& job);
+static void removeUnusedAppearances(PdfAcroForm& form, unordered_set<PdfReference>& refs);
+static void visitAppearances(const PdfField& field, unordered_set<PdfReference>& refs);
+
 // The AcroForm dict does NOT have a /Type key!
 PdfAcroForm::PdfAcroForm(PdfDocument& doc, PdfAcroFormDefaulAppearance defaultAppearance)
     : PdfDictionaryElement(doc), m_fieldArray(nullptr)
@@ -90,6 +149,16 @@ const PdfField& PdfAcroForm::GetField(const PdfReference& ref) const
     return getField(ref);
 }
 
+PdfField* PdfAcroForm::FindField(const string_view& fullName)
+{
+    return findField(fullName);
+}
+
+const PdfField* PdfAcroForm::FindField(const string_view& fullName) const
+{
+    return findField(fullName);
+}
+
 PdfField& PdfAcroForm::getField(unsigned index) const
 {
     const_cast<PdfAcroForm&>(*this).initFields();
@@ -115,6 +184,8 @@ void PdfAcroForm::RemoveFieldAt(unsigned index)
     {
         // It may be null if the field is invalid
         m_fieldMap->erase(m_fieldMap->find(m_Fields[index]->GetObject().GetIndirectReference()));
+        if (m_fieldNameMap != nullptr)
+            indexFieldNames(*m_Fields[index], { }, true);
     }
 
     m_fieldArray->RemoveAt(index);
@@ -133,6 +204,9 @@ void PdfAcroForm::RemoveField(const PdfReference& ref)
         return;
 
     unsigned index = found->second;
+    if (m_fieldNameMap != nullptr && m_Fields[index] != nullptr)
+        indexFieldNames(*m_Fields[index], { }, true);
+
     m_Fields.erase(m_Fields.begin() + index);
     m_fieldArray->RemoveAt(index);
     m_fieldMap->erase(found);
@@ -148,23 +222,125 @@ unsigned PdfAcroForm::GetFieldCount() const
     return (unsigned)m_Fields.size();
 }
 
+void PdfAcroForm::FillFields(const unordered_map<string, PdfString>& values,
+    const PdfFieldsFillParams& params)
+{
+    // Resolve and check all the values first, so the form is not
+    // left partially filled if any of them is invalid. Collect
+    // also the text to be drawn in the appearances
+    vector<FieldFill> fills;
+    vector<pair<PdfField*, string>> fields;
+    fills.reserve(values.size());
+    for (auto& pair : values)
+    {
+        auto field = FindField(pair.first);
+        if (field == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidName, "Field {} not found", pair.first);
+
+        FieldFill fill = { field, &pair.second, 0 };
+        switch (field->GetType())
+        {
+            case PdfFieldType::TextBox:
+            {
+                auto& textBox = static_cast<PdfTextBox&>(*field);
+                int64_t maxLength = textBox.GetMaxLen();
+                if (maxLength != -1 && pair.second.GetString().length() > (unsigned)maxLength)
+                    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "The value of field {} is longer than MaxLen", pair.first);
+
+                if (textBox.IsPasswordField())
+                    fields.push_back({ field, string() });
+                else
+                    fields.push_back({ field, pair.second.GetString() });
+                break;
+            }
+            case PdfFieldType::ComboBox:
+            case PdfFieldType::ListBox:
+            {
+                auto& choice = static_cast<PdChoiceField&>(*field);
+                unsigned count = choice.GetItemCount();
+                unsigned i = 0;
+                for (; i < count; i++)
+                {
+                    if (choice.GetItem(i) == pair.second)
+                        break;
+                }
+
+                if (i == count)
+                    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Item {} not found in field {}", pair.second.GetString(), pair.first);
+
+                fill.ItemIndex = i;
+                if (field->GetType() == PdfFieldType::ComboBox)
+                {
+                    auto displayText = choice.GetItemDisplayText((int)i);
+                    fields.push_back({ field, (displayText.has_value() ? *displayText : pair.second).GetString() });
+                }
+                break;
+            }
+            case PdfFieldType::CheckBox:
+            case PdfFieldType::RadioButton:
+                break;
+            default:
+                PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidDataType, "Unsupported filling field {}", pair.first);
+        }
+
+        fills.push_back(fill);
+    }
+
+    // NOTE: The appearances are generated before setting the
+    // values, since the text may fail to be encoded
+    if (params.GenerateAppearances)
+        generateAppearances(fields, params.ThreadCount);
+
+    bool needAppearances = false;
+    for (auto& fill : fills)
+    {
+        auto& field = *fill.Field;
+        switch (field.GetType())
+        {
+            case PdfFieldType::TextBox:
+                static_cast<PdfTextBox&>(field).SetText(*fill.Value);
+                break;
+            case PdfFieldType::ComboBox:
+            case PdfFieldType::ListBox:
+                static_cast<PdChoiceField&>(field).SetSelectedIndex((int)fill.ItemIndex);
+                if (field.GetType() == PdfFieldType::ListBox)
+                    needAppearances = true;
+                break;
+            case PdfFieldType::CheckBox:
+            case PdfFieldType::RadioButton:
+                if (!setButtonState(field, PdfName(fill.Value->GetString())))
+                    needAppearances = true;
+                break;
+            default:
+                PODOFO_RAISE_ERROR(PdfErrorCode::InternalLogic);
+        }
+    }
+
+    if (params.GenerateAppearances && needAppearances)
+        SetNeedAppearances(true);
+}
+
 PdfAcroForm::iterator PdfAcroForm::begin()
 {
+    initFields();
     return iterator(m_Fields.begin());
 }
 
 PdfAcroForm::iterator PdfAcroForm::end()
 {
+    initFields();
     return iterator(m_Fields.end());
 }
 
 PdfAcroForm::const_iterator PdfAcroForm::begin() const
 {
+    const_cast<PdfAcroForm&>(*this).initFields();
     return const_iterator(m_Fields.begin());
 }
 
 PdfAcroForm::const_iterator PdfAcroForm::end() const
 {
+    const_cast<PdfAcroForm&>(*this).initFields();
     return const_iterator(m_Fields.end());
 }
 
@@ -181,6 +357,9 @@ PdfField& PdfAcroForm::AddField(unique_ptr<PdfField>&& field)
 
     (*m_fieldMap)[field->GetObject().GetIndirectReference()] = m_fieldArray->GetSize();
     m_fieldArray->AddIndirectSafe(field->GetObject());
+    if (m_fieldNameMap != nullptr)
+        indexFieldNames(*field, { }, false);
+
     m_Fields.push_back(std::move(field));
     return *m_Fields.back();
 }
@@ -245,3 +424,468 @@ void PdfAcroForm::fixIndices(unsigned index)
             pair.second--;
     }
 }
+
+PdfField* PdfAcroForm::findField(const string_view& fullName) const
+{
+    auto& form = const_cast<PdfAcroForm&>(*this);
+    if (m_fieldNameMap == nullptr)
+    {
+        form.initFields();
+        form.m_fieldNameMap.reset(new FieldNameMap());
+        for (auto& field : m_Fields)
+        {
+            // It may be null if the field is invalid
+            if (field != nullptr)
+                form.indexFieldNames(*field, { }, false);
+        }
+    }
+
+    auto found = m_fieldNameMap->find(fullName);
+    if (found == m_fieldNameMap->end())
+        return nullptr;
+
+    return found->second;
+}
+
+// Add or remove the fully qualified names of the
+// field and its descendants to/from the names index
+void PdfAcroForm::indexFieldNames(PdfField& field, const string_view& parentName, bool remove)
+{
+    string fullName;
+    auto name = field.GetNameRaw();
+    if (name.has_value())
+    {
+        if (parentName.empty())
+            fullName = name->GetString();
+        else
+            fullName.append(parentName).append(".").append(name->GetString());
+
+        if (remove)
+        {
+            auto found = m_fieldNameMap->find(fullName);
+            if (found != m_fieldNameMap->end() && found->second == &field)
+                m_fieldNameMap->erase(found);
+        }
+        else
+        {
+            // NOTE: In case of duplicate names the first field wins
+            m_fieldNameMap->emplace(fullName, &field);
+        }
+    }
+    else
+    {
+        // Fields with no partial name, eg. widget
+        // annotations, inherit the name of the parent
+        fullName = parentName;
+    }
+
+    for (auto child : field.GetChildren())
+    {
+        // It may be null if the field is invalid
+        if (child != nullptr)
+            indexFieldNames(*child, fullName, remove);
+    }
+}
+
+void PdfAcroForm::invalidateFieldNames()
+{
+    // The index will be rebuilt on the next lookup
+    m_fieldNameMap = nullptr;
+}
+
+void PdfAcroForm::generateAppearances(const vector<pair<PdfField*, string>>& fields, unsigned threadCount)
+{
+    constexpr double Padding = 2;
+    constexpr double DefaultFontSize = 12;
+
+    auto& doc = GetDocument();
+    string_view formDA;
+    auto daObj = GetDictionary().FindKey("DA");
+    if (daObj != nullptr && daObj->IsString())
+        formDA = daObj->GetString().GetString();
+
+    const PdfDictionary* drFonts = nullptr;
+    auto drObj = GetDictionary().FindKey("DR");
+    if (drObj != nullptr && drObj->IsDictionary())
+    {
+        auto fontsObj = drObj->GetDictionary().FindKey("Font");
+        if (fontsObj != nullptr)
+            (void)fontsObj->TryGetDictionary(drFonts);
+    }
+
+    // NOTE: Fonts are resolved once and shared by all the appearances
+    unordered_map<PdfName, PdfFont*> fonts;
+    auto getFont = [&](PdfName& name) -> const PdfFont& {
+        auto found = fonts.find(name);
+        if (found == fonts.end())
+        {
+            PdfFont* font = nullptr;
+            const PdfObject* fontObj;
+            if (drFonts != nullptr && (fontObj = drFonts->FindKey(name)) != nullptr)
+                font = doc.GetFonts().GetDrawingFont(*fontObj);
+
+            found = fonts.emplace(name, font).first;
+        }
+
+        if (found->second == nullptr)
+        {
+            // Fallback to a standard font if the one in the
+            // default appearance is missing or invalid
+            auto& font = doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica);
+            name = font.GetIdentifier();
+            return font;
+        }
+
+        return *found->second;
+    };
+
+    vector<AppearanceJob> jobs;
+    vector<PdfDictionary*> widgets;
+    for (auto& pair : fields)
+    {
+        auto& field = *pair.first;
+        auto& dict = field.GetDictionary();
+        daObj = dict.FindKeyParent("DA");
+        auto da = parseDefaultAppearance(daObj != nullptr && daObj->IsString()
+            ? daObj->GetString().GetString() : formDA);
+        auto& font = getFont(da.FontName);
+        auto quadding = dict.FindKeyParentAs<int64_t>("Q", GetDictionary().FindKeyAs<int64_t>("Q", 0));
+        bool multiLine = field.GetType() == PdfFieldType::TextBox
+            && static_cast<PdfTextBox&>(field).IsMultiLine();
+
+        vector<string_view> lines;
+        if (multiLine)
+        {
+            string_view text = pair.second;
+            size_t pos;
+            while ((pos = text.find('\n')) != string_view::npos)
+            {
+                auto line = text.substr(0, pos);
+                if (line.size() != 0 && line.back() == '\r')
+                    line = line.substr(0, line.size() - 1);
+
+                lines.push_back(line);
+                text = text.substr(pos + 1);
+            }
+
+            lines.push_back(text);
+        }
+        else if (pair.second.size() != 0)
+        {
+            lines.push_back(pair.second);
+        }
+
+        widgets.clear();
+        collectWidgets(field, widgets);
+        for (auto widget : widgets)
+        {
+            auto rectObj = widget->FindKey("Rect");
+            const PdfArray* rectArr;
+            if (rectObj == nullptr || !rectObj->TryGetArray(rectArr))
+                continue;
+
+            auto rect = Rect::FromArray(*rectArr);
+            PdfTextState state;
+            state.Font = &font;
+            state.FontSize = da.FontSize;
+            if (state.FontSize <= 0)
+            {
+                // Auto size: fit the height, and the width for single lines
+                state.FontSize = 1;
+                state.FontSize = multiLine ? DefaultFontSize : std::min(DefaultFontSize,
+                    (rect.Height - 2 * Padding) / (font.GetAscent(state) - font.GetDescent(state)));
+                if (!multiLine && lines.size() != 0)
+                {
+                    double width = font.GetStringLength(lines[0], state);
+                    if (width > rect.Width - 2 * Padding)
+                        state.FontSize *= (rect.Width - 2 * Padding) / width;
+                }
+
+                if (state.FontSize <= 0)
+                    state.FontSize = 1;
+            }
+
+            AppearanceJob job;
+            job.Widget = widget;
+            job.Font = &font;
+            job.Stream = nullptr;
+            job.Width = rect.Width;
+            job.Height = rect.Height;
+            job.Operators = da.Operators;
+            job.FontName = da.FontName;
+            job.FontSize = state.FontSize;
+            job.HexStrings = !font.GetEncoding().IsSimpleEncoding();
+
+            double ascent = font.GetAscent(state);
+            double descent = font.GetDescent(state);
+            double y = multiLine ? rect.Height - Padding - ascent
+                : (rect.Height - (ascent - descent)) / 2 - descent;
+            for (auto& line : lines)
+            {
+                double x;
+                switch (quadding)
+                {
+                    case 1:
+                        x = (rect.Width - font.GetStringLength(line, state)) / 2;
+                        break;
+                    case 2:
+                        x = rect.Width - Padding - font.GetStringLength(line, state);
+                        break;
+                    default:
+                        x = Padding;
+                        break;
+                }
+
+                // NOTE: Encode serially, since encoding may
+                // update the used glyphs of the font
+                charbuff encoded;
+                if (!font.GetEncoding().TryConvertToEncoded(line, encoded))
+                {
+                    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidFontData,
+                        "The value of field {} can't be encoded with font {}",
+                        field.GetFullName(), font.GetName());
+                }
+
+                job.Lines.push_back({ x, y, std::move(encoded) });
+                y -= font.GetLineSpacing(state);
+            }
+
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // All the appearances are layed out: create the XObjects
+    // and replace the normal appearances of the widgets,
+    // collecting the replaced appearance streams
+    unordered_set<PdfReference> replaced;
+    for (auto& job : jobs)
+    {
+        job.XObject = doc.CreateXObjectForm(Rect(0, 0, job.Width, job.Height));
+        job.XObject->GetOrCreateResources().AddResource("Font", job.FontName, job.Font->GetObject());
+        job.Stream = &job.XObject->GetObject().GetOrCreateStream();
+
+        PdfDictionary* apDict;
+        auto apObj = job.Widget->FindKey("AP");
+        if (apObj == nullptr || !apObj->TryGetDictionary(apDict))
+            apDict = &job.Widget->AddKey("AP", PdfDictionary()).GetDictionary();
+
+        PdfReference ref;
+        auto normalObj = apDict->GetKey("N");
+        if (normalObj != nullptr && normalObj->TryGetReference(ref))
+            replaced.insert(ref);
+
+        apDict->AddKeyIndirect("N", job.XObject->GetObject());
+    }
+
+    // Write and compress the appearance streams possibly concurrently,
+    // as they don't share any state. Setting the stream data notifies
+    // the document observers, eg. PdfImmediateWriter that writes
+    // the stream to the device, so it's done serially instead
+    utls::ParallelFor(jobs.size(), threadCount, [&jobs](size_t i)
+    {
+        encodeAppearance(jobs[i]);
+    });
+
+    for (auto& job : jobs)
+        job.Stream->SetData(job.Encoded, { PdfFilterType::FlateDecode }, true);
+
+    removeUnusedAppearances(*this, replaced);
+}
+
+// Parse a default appearance string, eg. "/Helv 12 Tf 0 g"
+DefaultAppearance parseDefaultAppearance(const string_view& da)
+{
+    DefaultAppearance ret;
+    vector<string_view> tokens;
+    size_t pos = 0;
+    while (true)
+    {
+        pos = da.find_first_not_of(" \t\r\n", pos);
+        if (pos == string_view::npos)
+            break;
+
+        size_t end = da.find_first_of(" \t\r\n", pos);
+        if (end == string_view::npos)
+            end = da.size();
+
+        tokens.push_back(da.substr(pos, end - pos));
+        pos = end;
+    }
+
+    for (unsigned i = 0; i < tokens.size(); i++)
+    {
+        double size;
+        if (i + 2 < tokens.size() && tokens[i + 2] == "Tf"
+            && tokens[i].size() > 1 && tokens[i][0] == '/'
+            && utls::TryParse(tokens[i + 1], size))
+        {
+            ret.FontName = PdfName::FromEscaped(tokens[i].substr(1));
+            ret.FontSize = size;
+            i += 2;
+            continue;
+        }
+
+        if (ret.Operators.size() != 0)
+            ret.Operators.push_back(' ');
+
+        ret.Operators.append(tokens[i]);
+    }
+
+    return ret;
+}
+
+// Collect the widget annotations of a terminal field, which may
+// be the field itself or its kids with no partial name
+void collectWidgets(PdfField& field, vector<PdfDictionary*>& widgets)
+{
+    auto& dict = field.GetDictionary();
+    auto subtype = dict.FindKey("Subtype");
+    if (subtype != nullptr && subtype->IsName() && subtype->GetName() == "Widget")
+        widgets.push_back(&dict);
+
+    for (auto child : field.GetChildren())
+    {
+        if (child != nullptr && !child->GetNameRaw().has_value())
+            collectWidgets(*child, widgets);
+    }
+}
+
+// Set the value of a button field and switch on the widgets
+// that have an appearance for the state, switching off the others.
+// Returns false if the widgets have no appearances to switch
+bool setButtonState(PdfField& field, const PdfName& state)
+{
+    field.GetDictionary().AddKey("V", state);
+    bool hasAppearances = true;
+    vector<PdfDictionary*> widgets;
+    collectWidgets(field, widgets);
+    for (auto widget : widgets)
+    {
+        const PdfDictionary* normalDict = nullptr;
+        auto apObj = widget->FindKey("AP");
+        const PdfDictionary* apDict;
+        if (apObj != nullptr && apObj->TryGetDictionary(apDict))
+        {
+            auto normalObj = apDict->FindKey("N");
+            if (normalObj != nullptr)
+                (void)normalObj->TryGetDictionary(normalDict);
+        }
+
+        PdfName widgetState;
+        if (normalDict == nullptr)
+        {
+            // NOTE: The widget of a check box with no appearances is
+            // switched to the state anyway, like PdfCheckBox::SetChecked()
+            // does. The on state of radio button widgets can't be known
+            if (state != "Off")
+                hasAppearances = false;
+
+            widgetState = field.GetType() == PdfFieldType::CheckBox ? state : PdfName("Off");
+        }
+        else
+        {
+            widgetState = normalDict->HasKey(state) ? state : PdfName("Off");
+        }
+
+        widget->AddKey("AS", widgetState);
+    }
+
+    return hasAppearances;
+}
+
+void encodeAppearance(AppearanceJob& job)
+{
+    PdfStringStream stream;
+    WriteOperator_BMC(stream, "Tx");
+    WriteOperator_q(stream);
+    WriteOperator_re(stream, 1, 1, job.Width - 2, job.Height - 2);
+    WriteOperator_W(stream);
+    WriteOperator_n(stream);
+    if (job.Lines.size() != 0)
+    {
+        WriteOperator_BT(stream);
+        if (job.Operators.size() != 0)
+            stream << job.Operators << '\n';
+
+        WriteOperator_Tf(stream, job.FontName.GetString(), job.FontSize);
+        double x = 0;
+        double y = 0;
+        for (auto& line : job.Lines)
+        {
+            WriteOperator_Td(stream, line.X - x, line.Y - y);
+            WriteOperator_Tj(stream, line.Encoded, job.HexStrings);
+            x = line.X;
+            y = line.Y;
+        }
+
+        WriteOperator_ET(stream);
+    }
+
+    WriteOperator_Q(stream);
+    WriteOperator_EMC(stream);
+    PdfFilterFactory::Create(PdfFilterType::FlateDecode)->EncodeTo(job.Encoded, stream.GetString());
+}
+
+// Remove the replaced appearance streams, unless
+// they are still used by any widget of the form
+void removeUnusedAppearances(PdfAcroForm& form, unordered_set<PdfReference>& refs)
+{
+    if (refs.size() == 0)
+        return;
+
+    for (auto field : form)
+    {
+        // It may be null if the field is invalid
+        if (field != nullptr)
+            visitAppearances(*field, refs);
+    }
+
+    auto& objects = form.GetDocument().GetObjects();
+    for (auto& ref : refs)
+    {
+        auto obj = objects.GetObject(ref);
+        if (obj != nullptr && obj->HasStream())
+            (void)objects.RemoveObject(ref);
+    }
+}
+
+// Erase the appearance streams used by the
+// field and its descendants from the set
+void visitAppearances(const PdfField& field, unordered_set<PdfReference>& refs)
+{
+    auto apObj = field.GetDictionary().FindKey("AP");
+    const PdfDictionary* apDict;
+    if (apObj != nullptr && apObj->TryGetDictionary(apDict))
+    {
+        PdfReference ref;
+        const PdfDictionary* statesDict;
+        for (auto& pair : *apDict)
+        {
+            if (pair.second.TryGetReference(ref))
+            {
+                refs.erase(ref);
+                auto obj = field.GetDocument().GetObjects().GetObject(ref);
+                if (obj == nullptr || !obj->TryGetDictionary(statesDict) || obj->HasStream())
+                    continue;
+            }
+            else if (!pair.second.TryGetDictionary(statesDict))
+            {
+                continue;
+            }
+
+            // The appearances of the states, eg. /N << /Yes 5 0 R /Off 6 0 R >>
+            for (auto& state : *statesDict)
+            {
+                if (state.second.TryGetReference(ref))
+                    refs.erase(ref);
+            }
+        }
+    }
+
+    for (auto child : field.GetChildren())
+    {
+        // It may be null if the field is invalid
+        if (child != nullptr)
+            visitAppearances(*child, refs);
+    }
+}
@@ -19,9 +19,23 @@ enum class PdfAcroFormDefaulAppearance
     BlackText12pt ///< Add a default appearance with Arial embedded and black text 12pt if no other DA key is present
 };
 
+struct PdfFieldsFillParams
+{
+    /** Generate the normal appearance streams of the filled text
+     * and combo box fields, so viewers don't need to regenerate them
+     */
+    bool GenerateAppearances = true;
+    /** The number of threads used to write and compress the appearance
+     * streams, that are then set to the document serially.
+     * 0 means hardware concurrency, 1 (default) means serial writing
+     */
+    unsigned ThreadCount = 1;
+};
+
 class PODOFO_API PdfAcroForm final : public PdfDictionaryElement
 {
     friend class PdfField;
+    friend class PdfFieldChildrenCollectionBase;
 
 public:
     /** Create a new PdfAcroForm dictionary object
@@ -74,6 +88,16 @@ public:
 
     const PdfField& GetField(const PdfReference& ref) const;
 
+    /** Find a field by its fully qualified name
+     *  \param fullName the fully qualified name, as returned by PdfField::GetFullName()
+     *  \returns the field or nullptr if no field has the given name
+     *  \remarks The lookup uses an index that is built on first use and
+     *  is kept up to date when fields are created, removed or renamed
+     */
+    PdfField* FindField(const std::string_view& fullName);
+
+    const PdfField* FindField(const std::string_view& fullName) const;
+
     /** Delete the field with index index from this page.
      *  \param index the index of the field to delete
      */
@@ -86,6 +110,19 @@ public:
 
     unsigned GetFieldCount() const;
 
+    /** Set the values of many fields at once
+     *  \param values a map of field fully qualified names to values. For
+     *      text boxes the value is the text, for choice fields it's the
+     *      item to select, for check boxes and radio buttons it's the
+     *      state name of the widget to switch on, eg. "Yes" or "Off"
+     *  \remarks The appearance streams are generated in a single pass
+     *  after all the values are set, sharing the font resources between
+     *  them. List boxes appearances are not generated: if any is filled,
+     *  the NeedAppearances flag is set instead
+     */
+    void FillFields(const std::unordered_map<std::string, PdfString>& values,
+        const PdfFieldsFillParams& params = { });
+
 public:
     using FieldList = std::vector<std::shared_ptr<PdfField>>;
 
@@ -164,12 +201,20 @@ private:
 
     void fixIndices(unsigned index);
 
+    PdfField* findField(const std::string_view& fullName) const;
+    void generateAppearances(const std::vector<std::pair<PdfField*, std::string>>& fields, unsigned threadCount);
+    void indexFieldNames(PdfField& field, const std::string_view& parentName, bool remove);
+    void invalidateFieldNames();
+
 private:
     using FieldMap = std::map<PdfReference, unsigned>;
+    // NOTE: Transparent comparison, so names can be looked up with no copy
+    using FieldNameMap = std::map<std::string, PdfField*, std::less<>>;
 
 private:
     FieldList m_Fields;
     std::unique_ptr<FieldMap> m_fieldMap;
+    std::unique_ptr<FieldNameMap> m_fieldNameMap;
     PdfArray* m_fieldArray;
 };
 
@@ -195,3 +195,41 @@ void PdfAnnotationCollection::fixIndices(unsigned index)
             pair.second--;
     }
 }
+
+void PdfAnnotationCollection::removeAnnotsAt(const vector<unsigned>& indices)
+{
+    if (indices.size() == 0)
+        return;
+
+    initAnnotations();
+    AnnotationList annots;
+    annots.reserve(m_Annots.size() - indices.size());
+    auto it = indices.begin();
+    for (unsigned i = 0; i < m_Annots.size(); i++)
+    {
+        if (it != indices.end() && *it == i)
+        {
+            if (m_Annots[i] != nullptr)
+                m_annotMap->erase(m_Annots[i]->GetObject().GetIndirectReference());
+
+            it++;
+            continue;
+        }
+
+        annots.push_back(std::move(m_Annots[i]));
+    }
+
+    for (auto& pair : *m_annotMap)
+    {
+        // Shift the indices by the count of the removed annotations preceding them
+        pair.second -= (unsigned)(std::lower_bound(indices.begin(), indices.end(), pair.second) - indices.begin());
+    }
+
+    for (auto rit = indices.rbegin(); rit != indices.rend(); rit++)
+        m_annotArray->RemoveAt(*rit);
+
+    m_Annots = std::move(annots);
+
+    // NOTE: No need to remove the objects from the document
+    // indirect object list: they will be garbage collected
+}
@@ -104,6 +104,9 @@ namespace PoDoFo
         PdfAnnotation& getAnnotAt(unsigned index) const;
         PdfAnnotation& getAnnot(const PdfReference& ref) const;
         void fixIndices(unsigned index);
+        // Remove the annotations at the given sorted
+        // indices, rebuilding the collection once
+        void removeAnnotsAt(const std::vector<unsigned>& indices);
 
     private:
         using AnnotationMap = std::map<PdfReference, unsigned>;
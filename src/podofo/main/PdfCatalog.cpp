@@ -58,13 +58,14 @@ string PdfCatalog::GetMetadataStreamValue() const
 void PdfCatalog::SetMetadataStreamValue(const string_view& value)
 {
     auto& obj = GetOrCreateMetadataObject();
-    auto& stream = obj.GetOrCreateStream();
-    stream.SetData(value, true);
 
     // We are writing raw clear text, which is required in most
     // relevant scenarions (eg. PDF/A). Remove any possibly
-    // existing filter
+    // existing filter. NOTE: Do it before setting the data, as
+    // streamed documents write the object immediately
     obj.GetDictionary().RemoveKey(PdfName::KeyFilter);
+    auto& stream = obj.GetOrCreateStream();
+    stream.SetData(value, true);
 
     // Invalidate current metadata
     GetDocument().GetMetadata().Invalidate();
@@ -19,6 +19,9 @@ PODOFO_EXPORT PdfLogSeverity s_MaxLogSeverity = PdfLogSeverity::Information;
 
 PODOFO_EXPORT LogMessageCallback s_LogMessageCallback;
 
+PODOFO_EXPORT atomic<bool> s_InstrumentationEnabled;
+PODOFO_EXPORT atomic<uint64_t> s_InstrumentationCounters[InstrumentationCounterCount];
+
 void PdfCommon::AddFontDirectory(const string_view& path)
 {
     PdfFontManager::AddFontDirectory(path);
@@ -41,5 +44,29 @@ PdfLogSeverity PdfCommon::GetMaxLoggingSeverity()
 
 bool PdfCommon::IsLoggingSeverityEnabled(PdfLogSeverity logSeverity)
 {
-    return logSeverity <= s_MaxLogSeverity;
+    return logSeverity <= PdfLogSeverity::PODOFO_MAX_LOG_SEVERITY && logSeverity <= s_MaxLogSeverity;
+}
+
+void PdfCommon::SetInstrumentationEnabled(bool enabled)
+{
+    s_InstrumentationEnabled = enabled;
+}
+
+bool PdfCommon::IsInstrumentationEnabled()
+{
+    return s_InstrumentationEnabled;
+}
+
+uint64_t PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter counter)
+{
+    if ((unsigned)counter >= InstrumentationCounterCount)
+        PODOFO_RAISE_ERROR(PdfErrorCode::InvalidEnumValue);
+
+    return s_InstrumentationCounters[(unsigned)counter].load(memory_order_relaxed);
+}
+
+void PdfCommon::ResetInstrumentationCounters()
+{
+    for (auto& counter : s_InstrumentationCounters)
+        counter.store(0, memory_order_relaxed);
 }
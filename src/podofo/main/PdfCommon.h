@@ -10,6 +10,18 @@
 
 namespace PoDoFo {
 
+/** Counters of library events, updated only when the
+ *  instrumentation is enabled
+ *  \see PdfCommon::SetInstrumentationEnabled
+ */
+enum class PdfInstrumentationCounter : uint8_t
+{
+    LogMessages = 0,        ///< Log messages passing the severity filter
+    SuppressedLogMessages,  ///< Log messages discarded by the severity filter, before being formatted
+    ParsedObjects,          ///< Objects parsed from loaded documents
+    ImportedObjects,        ///< Objects imported from other documents
+};
+
 class PODOFO_API PdfCommon final
 {
     PdfCommon() = delete;
@@ -36,6 +48,23 @@ public:
     /** The if the given logging severity enabled or not
      */
     static bool IsLoggingSeverityEnabled(PdfLogSeverity logSeverity);
+
+    /** Enable or disable the instrumentation counters. They are
+     * disabled by default, and they cost nothing when disabled
+     * \see GetInstrumentationCounter
+     */
+    static void SetInstrumentationEnabled(bool enabled);
+
+    static bool IsInstrumentationEnabled();
+
+    /** Get the value of an instrumentation counter, accumulated
+     * since it was last reset while the instrumentation was enabled
+     */
+    static uint64_t GetInstrumentationCounter(PdfInstrumentationCounter counter);
+
+    /** Reset all the instrumentation counters to zero
+     */
+    static void ResetInstrumentationCounters();
 };
 
 }
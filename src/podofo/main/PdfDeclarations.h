@@ -167,6 +167,7 @@ enum class PdfTextExtractFlags
     ComputeBoundingBox = 32,    ///< NOTE: Currently the bounding is inaccurate
     RawCoordinates = 64,
     ExtractSubstring = 128,     ///< NOTE: Extract the matched substring
+    TextOnly = 256,             ///< Don't compute the entries lengths and don't keep the per glyph widths and positions, just the widths of the white space and non white space runs needed to advance the text position. Faster when only the text and the position are needed
 };
 
 enum class PdfXObjectType : uint8_t
@@ -591,6 +592,23 @@ enum class PdfAnnotationFlags : uint32_t
     LockedContents = 0x0200,
 };
 
+/** Flags to control the import of pages from other documents
+ */
+enum class PdfImportFlags
+{
+    None = 0,
+    DeduplicateStreams = 1, ///< Share the imported streams, together with their dictionaries, that are identical to streams already in the document, eg. fonts, ICC profiles and images embedded by many of the merged documents
+};
+
+/** Flags to control the flattening of the annotations
+ *  \see PdfDocument::FlattenAnnotations
+ */
+enum class PdfFlattenFlags
+{
+    None = 0,
+    WidgetsOnly = 1,        ///< Flatten only the form fields widgets, leaving the other annotations untouched
+};
+
 /** The type of PDF field
  */
 enum class PdfFieldType : uint32_t
@@ -784,6 +802,8 @@ ENABLE_BITMASK_OPERATORS(PoDoFo::PdfFontDescriptorFlags);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfGlyphAccess);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfTextExtractFlags);
 ENABLE_BITMASK_OPERATORS(PoDoFo::PdfAnnotationFlags);
+ENABLE_BITMASK_OPERATORS(PoDoFo::PdfFlattenFlags);
+ENABLE_BITMASK_OPERATORS(PoDoFo::PdfImportFlags);
 
 /**
  * \mainpage
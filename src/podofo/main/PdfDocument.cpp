@@ -6,13 +6,17 @@
 
 #include <podofo/private/PdfDeclarationsPrivate.h>
 #include <podofo/private/XMPUtils.h>
+#include <podofo/private/OpenSSLInternal.h>
 #include "PdfDocument.h"
 
 #include <algorithm>
 #include <deque>
+#include <unordered_set>
+
 
 #include "PdfArray.h"
 #include "PdfDictionary.h"
+#include "PdfFilter.h"
 #include "PdfImmediateWriter.h"
 #include "PdfObjectStream.h"
 #include "PdfIndirectObjectList.h"
@@ -27,10 +31,59 @@
 #include "PdfPageCollection.h"
 #include "PdfXObjectForm.h"
 #include "PdfImage.h"
+#include <podofo/auxiliary/StreamDevice.h>
 
 using namespace std;
 using namespace PoDoFo;
 
+namespace
+{
+    // The digests of the objects of a document, computed
+    // following the references between them
+    struct DigestContext
+    {
+        DigestContext(const PdfIndirectObjectList& objects)
+            : Objects(&objects) { }
+
+        const PdfIndirectObjectList* Objects;
+        unordered_map<PdfReference, string> Digests;
+        // The objects whose digest is being computed
+        unordered_set<PdfReference> Visiting;
+    };
+}
+
+static bool isPageTreeObject(const PdfObject& obj);
+static string getStreamDigest(const PdfObject& obj);
+static string getObjectDigest(DigestContext& context, const PdfObject& obj);
+static string getReferenceDigest(DigestContext& context, const PdfReference& ref);
+static string getDigest(const string_view& header, InputStream& input);
+static void collectReferences(PdfObject& obj, const PdfReference& ref, vector<PdfObject*>& references);
+
+struct PdfDocument::ImportContext
+{
+    ImportContext(const PdfIndirectObjectList& objects, const PdfIndirectObjectList& sourceObjects,
+            ReferenceMap& refMap, bool deduplicate)
+        : SourceObjects(&sourceObjects), RefMap(&refMap), Deduplicate(deduplicate),
+        Digests(objects), SourceDigests(sourceObjects) { }
+
+    const PdfIndirectObjectList* SourceObjects;
+    ReferenceMap* RefMap;
+    bool Deduplicate;
+    // NOTE: The existing objects are not modified by the
+    // import, so their digests can be cached as well
+    DigestContext Digests;
+    DigestContext SourceDigests;
+    // Copies of the imported objects whose
+    // references must still be fixed
+    vector<pair<const PdfObject*, PdfObject*>> PendingObjects;
+    // Streams whose dictionary is being imported
+    unordered_set<PdfReference> ImportingStreams;
+    // Streams indexed by this import. The objects they
+    // reference may still have to be filled
+    unordered_set<PdfReference> IndexedStreams;
+    vector<PdfObject*> ImportedObjects;
+};
+
 PdfDocument::PdfDocument(bool empty) :
     m_Objects(*this),
     m_Metadata(*this),
@@ -78,6 +131,8 @@ void PdfDocument::Clear()
     m_AcroForm = nullptr;
     m_Outlines = nullptr;
     m_NameTree = nullptr;
+    m_streamIndex = nullptr;
+    m_xobjectCache.clear();
     m_Objects.Clear();
     m_Objects.SetCanReuseObjectNumbers(true);
 }
@@ -109,231 +164,134 @@ void PdfDocument::Init()
         m_AcroForm.reset(new PdfAcroForm(*acroformObj));
 }
 
-void PdfDocument::AppendDocumentPages(const PdfDocument& doc)
+void PdfDocument::AppendDocumentPages(const PdfDocument& doc, PdfImportFlags flags)
 {
-    append(doc, true);
+    importPages(doc, GetPages().GetCount(), 0, doc.GetPages().GetCount(), flags);
 }
 
-void PdfDocument::append(const PdfDocument& doc, bool appendAll)
+void PdfDocument::InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex, PdfImportFlags flags)
 {
-    unsigned difference = static_cast<unsigned>(m_Objects.GetSize() + m_Objects.GetFreeObjects().size());
-
-    // Because GetNextObject uses m_ObjectCount instead 
-    // of m_Objects.GetSize() + m_Objects.GetFreeObjects().size() + 1
-    // make sure the free objects are already present before appending to
-    // prevent overlapping obj-numbers
-
-    // create all free objects again, to have a clean free object list
-    for (auto& ref : doc.GetObjects().GetFreeObjects())
-        m_Objects.AddFreeObject(PdfReference(ref.ObjectNumber() + difference, ref.GenerationNumber()));
+    importPages(doc, atIndex, pageIndex, 1, flags);
+}
 
-    // append all objects first and fix their references
-    for (auto& obj : doc.GetObjects())
-    {
-        PdfReference ref(static_cast<uint32_t>(obj->GetIndirectReference().ObjectNumber() + difference), obj->GetIndirectReference().GenerationNumber());
-        auto newObj = new PdfObject(PdfDictionary());
-        newObj->setDirty();
-        newObj->SetIndirectReference(ref);
-        m_Objects.PushObject(newObj);
-        *newObj = *obj;
+void PdfDocument::AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount, PdfImportFlags flags)
+{
+    importPages(doc, GetPages().GetCount(), pageIndex, pageCount, flags);
+}
 
-        PoDoFo::LogMessage(PdfLogSeverity::Information, "Fixing references in {} {} R by {}",
-            newObj->GetIndirectReference().ObjectNumber(), newObj->GetIndirectReference().GenerationNumber(), difference);
-        fixObjectReferences(*newObj, difference);
-    }
+void PdfDocument::importPages(const PdfDocument& doc, unsigned atIndex, unsigned pageIndex, unsigned pageCount,
+    PdfImportFlags flags)
+{
+    auto& pages = doc.GetPages();
+    if (pageIndex + pageCount > pages.GetCount() || pageIndex + pageCount < pageIndex)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::PageNotFound, "Page range {}-{} out of range", pageIndex, pageIndex + pageCount);
 
-    if (appendAll)
+    // Create the page objects first, so the references between
+    // the imported pages are preserved, while the other
+    // pages of the source document are not followed
+    ReferenceMap refMap;
+    ImportContext context(m_Objects, doc.GetObjects(), refMap,
+        (flags & PdfImportFlags::DeduplicateStreams) != PdfImportFlags::None);
+    if (context.Deduplicate && m_streamIndex == nullptr)
     {
-        const PdfName inheritableAttributes[] = {
-            PdfName("Resources"),
-            PdfName("MediaBox"),
-            PdfName("CropBox"),
-            PdfName("Rotate"),
-            PdfName::KeyNull
-        };
-
-        // append all pages now to our page tree
-        for (unsigned i = 0; i < doc.GetPages().GetCount(); i++)
+        // Index the streams already in the document. Streams
+        // already written, eg. by PdfStreamedDocument, can't be read
+        m_streamIndex.reset(new unordered_map<string, PdfReference>());
+        for (auto obj : m_Objects)
         {
-            auto& page = doc.GetPages().GetPageAt(i);
-            auto& obj = m_Objects.MustGetObject(PdfReference(page.GetObject().GetIndirectReference().ObjectNumber()
-                + difference, page.GetObject().GetIndirectReference().GenerationNumber()));
-            if (obj.IsDictionary() && obj.GetDictionary().HasKey("Parent"))
-                obj.GetDictionary().RemoveKey("Parent");
-
-            // Deal with inherited attributes
-            auto inherited = inheritableAttributes;
-            while (!inherited->IsNull())
-            {
-                auto attribute = page.GetDictionary().FindKeyParent(*inherited);
-                if (attribute != nullptr)
-                {
-                    PdfObject attributeCopy(*attribute);
-                    fixObjectReferences(attributeCopy, difference);
-                    obj.GetDictionary().AddKey(*inherited, attributeCopy);
-                }
-
-                inherited++;
-            }
-
-            m_Pages->InsertPageAt(m_Pages->GetCount(), *new PdfPage(obj));
-        }
-
-        // Append all outlines
-        const PdfOutlineItem* appendRoot = doc.GetOutlines();
-        if (appendRoot != nullptr && (appendRoot = appendRoot->First()) != nullptr)
-        {
-            // Get or create outlines
-            PdfOutlineItem* root = &this->GetOrCreateOutlines();
-
-            // Find actual item where to append
-            while (root->Next() != nullptr)
-                root = root->Next();
-
-            PdfReference ref(appendRoot->GetObject().GetIndirectReference().ObjectNumber()
-                + difference, appendRoot->GetObject().GetIndirectReference().GenerationNumber());
-            root->InsertChild(new PdfOutlines(m_Objects.MustGetObject(ref)));
+            if (obj->HasStream() && !obj->IsImmutable())
+                m_streamIndex->insert({ getObjectDigest(context.Digests, *obj), obj->GetIndirectReference() });
         }
     }
 
-    // TODO: merge name trees
-    // ToDictionary -> then iteratate over all keys and add them to the new one
-}
-
-void PdfDocument::InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex)
-{
-    // copy of PdfDocument::Append, only restricts which page to add
-    unsigned difference = static_cast<unsigned>(m_Objects.GetSize() + m_Objects.GetFreeObjects().size());
-
-
-    // Because GetNextObject uses m_ObjectCount instead 
-    // of m_Objects.GetSize() + m_Objects.GetFreeObjects().size() + 1
-    // make sure the free objects are already present before appending to
-    // prevent overlapping obj-numbers
-
-    // create all free objects again, to have a clean free object list
-    for (auto& freeObj : GetObjects().GetFreeObjects())
+    vector<PdfObject*> pageObjs(pageCount);
+    for (unsigned i = 0; i < pageCount; i++)
     {
-        m_Objects.AddFreeObject(PdfReference(freeObj.ObjectNumber() + difference, freeObj.GenerationNumber()));
+        pageObjs[i] = &m_Objects.CreateDictionaryObject();
+        refMap[pages.GetPageAt(pageIndex + i).GetObject().GetIndirectReference()] = pageObjs[i]->GetIndirectReference();
     }
+    IncrementCounter(PdfInstrumentationCounter::ImportedObjects, pageCount);
 
-    // append all objects first and fix their references
-    for (auto& obj : doc.GetObjects())
+    constexpr string_view inheritableAttributes[] = { "Resources"sv, "MediaBox"sv, "CropBox"sv, "Rotate"sv };
+    for (unsigned i = 0; i < pageCount; i++)
     {
-        PdfReference ref(static_cast<uint32_t>(obj->GetIndirectReference().ObjectNumber() + difference), obj->GetIndirectReference().GenerationNumber());
-        auto newObj = new PdfObject(PdfDictionary());
-        newObj->setDirty();
-        newObj->SetIndirectReference(ref);
-        m_Objects.PushObject(newObj);
-        *newObj = *obj;
+        auto& page = pages.GetPageAt(pageIndex + i);
+        auto& obj = *pageObjs[i];
+        obj = page.GetObject();
+        obj.GetDictionary().RemoveKey("Parent");
 
-        PoDoFo::LogMessage(PdfLogSeverity::Information, "Fixing references in {} {} R by {}",
-            newObj->GetIndirectReference().ObjectNumber(), newObj->GetIndirectReference().GenerationNumber(), difference);
-        fixObjectReferences(*newObj, difference);
+        // Deal with inherited attributes
+        for (unsigned j = 0; j < std::size(inheritableAttributes); j++)
+        {
+            auto attribute = page.findInheritableAttribute(inheritableAttributes[j]);
+            if (attribute == nullptr)
+                continue;
+
+            if (attribute->IsIndirect())
+                obj.GetDictionary().AddKey(inheritableAttributes[j], attribute->GetIndirectReference());
+            else
+                obj.GetDictionary().AddKey(inheritableAttributes[j], *attribute);
+        }
+
+        importReferences(context, obj);
     }
 
-    const PdfName inheritableAttributes[] = {
-        PdfName("Resources"),
-        PdfName("MediaBox"),
-        PdfName("CropBox"),
-        PdfName("Rotate"),
-        PdfName::KeyNull
-    };
+    for (unsigned i = 0; i < pageCount; i++)
+        m_Pages->InsertPageAt(atIndex + i, *new PdfPage(*pageObjs[i]));
 
-    // append all pages now to our page tree
-    for (unsigned i = 0; i < doc.GetPages().GetCount(); i++)
+    // The objects referenced directly by the pages, and the
+    // annotations, are still reachable by the page API
+    unordered_set<PdfReference> pageReferences;
+    for (unsigned i = 0; i < pageCount; i++)
     {
-        if (i != pageIndex)
-            continue;
-
-        auto& page = doc.GetPages().GetPageAt(i);
-        auto& obj = m_Objects.MustGetObject(PdfReference(page.GetObject().GetIndirectReference().ObjectNumber()
-            + difference, page.GetObject().GetIndirectReference().GenerationNumber()));
-        if (obj.IsDictionary() && obj.GetDictionary().HasKey("Parent"))
-            obj.GetDictionary().RemoveKey("Parent");
+        for (auto& pair : pageObjs[i]->GetDictionary())
+        {
+            if (pair.second.IsReference())
+                pageReferences.insert(pair.second.GetReference());
+        }
 
-        // Deal with inherited attributes
-        const PdfName* inherited = inheritableAttributes;
-        while (!inherited->IsNull())
+        auto annotsObj = pageObjs[i]->GetDictionary().FindKey("Annots");
+        const PdfArray* annots;
+        if (annotsObj != nullptr && annotsObj->TryGetArray(annots))
         {
-            auto attribute = page.GetDictionary().FindKeyParent(*inherited);
-            if (attribute != nullptr)
+            for (auto& annot : *annots)
             {
-                PdfObject attributeCopy(*attribute);
-                fixObjectReferences(attributeCopy, difference);
-                obj.GetDictionary().AddKey(*inherited, attributeCopy);
+                if (annot.IsReference())
+                    pageReferences.insert(annot.GetReference());
             }
-
-            inherited++;
         }
+    }
 
-        m_Pages->InsertPageAt(atIndex, *new PdfPage(obj));
+    vector<PdfObject*> importedObjs;
+    for (auto obj : context.ImportedObjects)
+    {
+        if (pageReferences.find(obj->GetIndirectReference()) == pageReferences.end())
+            importedObjs.push_back(obj);
     }
 
-    // append all outlines
-    PdfOutlineItem* root = this->GetOutlines();
-    PdfOutlines* appendRoot = const_cast<PdfDocument&>(doc).GetOutlines();
-    if (appendRoot != nullptr && appendRoot->First())
+    OnObjectsImported(importedObjs);
+
+    // Append all outlines
+    auto appendRoot = doc.GetOutlines();
+    const PdfOutlineItem* appendFirst;
+    if (appendRoot != nullptr && (appendFirst = appendRoot->First()) != nullptr)
     {
-        // only append outlines if appended document has outlines
-        while (root != nullptr && root->Next())
+        // Get or create outlines
+        PdfOutlineItem* root = &this->GetOrCreateOutlines();
+
+        // Find actual item where to append
+        while (root->Next() != nullptr)
             root = root->Next();
 
-        PdfReference ref(appendRoot->First()->GetObject().GetIndirectReference().ObjectNumber()
-            + difference, appendRoot->First()->GetObject().GetIndirectReference().GenerationNumber());
-        root->InsertChild(new PdfOutlines(m_Objects.MustGetObject(ref)));
+        PdfObject first(appendFirst->GetObject().GetIndirectReference());
+        importReferences(doc.GetObjects(), first, refMap);
+        root->InsertChild(new PdfOutlines(m_Objects.MustGetObject(first.GetReference())));
     }
 
     // TODO: merge name trees
     // ToDictionary -> then iteratate over all keys and add them to the new one
 }
 
-void PdfDocument::AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount)
-{
-    /*
-      This function works a bit different than one might expect.
-      Rather than copying one page at a time - we copy the ENTIRE document
-      and then delete the pages we aren't interested in.
-
-      We do this because
-      1) SIGNIFICANTLY simplifies the process
-      2) Guarantees that shared objects aren't copied multiple times
-      3) offers MUCH faster performance for the common cases
-
-      HOWEVER: because PoDoFo doesn't currently do any sort of "object garbage collection" during
-      a Write() - we will end up with larger documents, since the data from unused pages
-      will also be in there.
-    */
-
-    // calculate preliminary "left" and "right" page ranges to delete
-    // then offset them based on where the pages were inserted
-    // NOTE: some of this will change if/when we support insertion at locations
-    //       OTHER than the end of the document!
-    unsigned leftStartPage = 0;
-    unsigned leftCount = pageIndex;
-    unsigned rightStartPage = pageIndex + pageCount;
-    unsigned rightCount = doc.GetPages().GetCount() - rightStartPage;
-    unsigned pageOffset = this->GetPages().GetCount();
-
-    leftStartPage += pageOffset;
-    rightStartPage += pageOffset;
-
-    // append in the whole document
-    this->AppendDocumentPages(doc);
-
-    // delete
-    if (rightCount > 0)
-        this->deletePages(rightStartPage, rightCount);
-    if (leftCount > 0)
-        this->deletePages(leftStartPage, leftCount);
-}
-
-void PdfDocument::deletePages(unsigned atIndex, unsigned pageCount)
-{
-    for (unsigned i = 0; i < pageCount; i++)
-        this->GetPages().RemovePageAt(atIndex);
-}
-
 PdfInfo& PdfDocument::GetOrCreateInfo()
 {
     if (m_Info == nullptr)
@@ -348,18 +306,6 @@ PdfInfo& PdfDocument::GetOrCreateInfo()
 
 Rect PdfDocument::FillXObjectFromPage(PdfXObjectForm& xobj, const PdfPage& page, bool useTrimBox)
 {
-    unsigned difference = 0;
-    auto& sourceDoc = page.GetDocument();
-    if (this != &sourceDoc)
-    {
-        difference = static_cast<unsigned>(m_Objects.GetSize() + m_Objects.GetFreeObjects().size());
-        append(sourceDoc, false);
-    }
-
-    // TODO: remove unused objects: page, ...
-
-    auto& pageObj = m_Objects.MustGetObject(PdfReference(page.GetObject().GetIndirectReference().ObjectNumber()
-        + difference, page.GetObject().GetIndirectReference().GenerationNumber()));
     Rect box = page.GetMediaBox();
 
     // intersect with crop-box
@@ -370,117 +316,198 @@ Rect PdfDocument::FillXObjectFromPage(PdfXObjectForm& xobj, const PdfPage& page,
         box.Intersect(page.GetTrimBox());
 
     // link resources from external doc to x-object
-    if (pageObj.IsDictionary() && pageObj.GetDictionary().HasKey("Resources"))
-        xobj.GetObject().GetDictionary().AddKey("Resources", *pageObj.GetDictionary().GetKey("Resources"));
+    auto resources = page.findInheritableAttribute("Resources");
+    if (resources != nullptr)
+    {
+        PdfObject resourcesCopy;
+        if (resources->IsIndirect())
+            resourcesCopy = PdfObject(resources->GetIndirectReference());
+        else
+            resourcesCopy = *resources;
+
+        auto& sourceDoc = page.GetDocument();
+        if (this != &sourceDoc)
+        {
+            // Import only the objects reachable from the resources
+            ReferenceMap refMap;
+            importReferences(sourceDoc.GetObjects(), resourcesCopy, refMap);
+        }
+
+        xobj.GetObject().GetDictionary().AddKey("Resources", resourcesCopy);
+    }
 
     // copy top-level content from external doc to x-object
-    if (pageObj.IsDictionary() && pageObj.GetDictionary().HasKey("Contents"))
+    auto contents = page.GetContents();
+    if (contents != nullptr)
     {
-        // get direct pointer to contents
-        auto& contents = pageObj.GetDictionary().MustFindKey("Contents");
-        if (contents.IsArray())
-        {
-            // copy array as one stream to xobject
-            PdfArray arr = contents.GetArray();
+        auto& xobjStream = xobj.GetObject().GetOrCreateStream();
+        auto output = xobjStream.GetOutputStream({ PdfFilterType::FlateDecode });
+        contents->CopyTo(output);
+    }
 
-            auto& xobjStream = xobj.GetObject().GetOrCreateStream();
-            auto output = xobjStream.GetOutputStream({ PdfFilterType::FlateDecode });
+    return box;
+}
 
-            for (auto& child : arr)
+void PdfDocument::importReferences(const PdfIndirectObjectList& sourceObjects, PdfObject& obj, ReferenceMap& refMap)
+{
+    ImportContext context(m_Objects, sourceObjects, refMap, false);
+    importReferences(context, obj);
+}
+
+void PdfDocument::importReferences(ImportContext& context, PdfObject& obj)
+{
+    // The copies of the imported objects are fixed
+    // iteratively, to not overflow the stack with long chains
+    fixImportedReferences(context, obj);
+    while (context.PendingObjects.size() != 0)
+    {
+        auto pending = context.PendingObjects.back();
+        context.PendingObjects.pop_back();
+        *pending.second = *pending.first;
+        fixImportedReferences(context, *pending.second);
+    }
+}
+
+void PdfDocument::fixImportedReferences(ImportContext& context, PdfObject& obj)
+{
+    vector<PdfObject*> containers = { &obj };
+    while (containers.size() != 0)
+    {
+        auto container = containers.back();
+        containers.pop_back();
+
+        PdfDictionary* dict;
+        PdfArray* arr;
+        if (container->TryGetDictionary(dict))
+        {
+            for (auto& pair : *dict)
             {
-                if (child.IsReference())
-                {
-                    // TODO: not very efficient !!
-                    auto obj = GetObjects().GetObject(child.GetReference());
-
-                    while (obj != nullptr)
-                    {
-                        if (obj->IsReference())    // Recursively look for the stream
-                        {
-                            obj = GetObjects().GetObject(obj->GetReference());
-                        }
-                        else if (obj->HasStream())
-                        {
-                            PdfObjectStream& contStream = obj->GetOrCreateStream();
-
-                            charbuff contStreamBuffer;
-                            contStream.CopyTo(contStreamBuffer);
-                            output.Write(contStreamBuffer);
-                            break;
-                        }
-                        else
-                        {
-                            PODOFO_RAISE_ERROR(PdfErrorCode::InvalidStream);
-                            break;
-                        }
-                    }
-                }
-                else
-                {
-                    string str;
-                    child.ToString(str);
-                    output.Write(str);
-                    output.Write(" ");
-                }
+                if (pair.second.IsReference())
+                    pair.second = importObject(context, pair.second.GetReference());
+                else if (pair.second.IsDictionary() || pair.second.IsArray())
+                    containers.push_back(&pair.second);
             }
         }
-        else if (contents.HasStream())
+        else if (container->TryGetArray(arr))
         {
-            // copy stream to xobject
-            auto& contentsStream = contents.GetOrCreateStream();
-            auto contentsInput = contentsStream.GetInputStream();
-
-            auto& xobjStream = xobj.GetObject().GetOrCreateStream();
-            auto output = xobjStream.GetOutputStream({ PdfFilterType::FlateDecode });
-            contentsInput.CopyTo(output);
+            for (auto& child : *arr)
+            {
+                if (child.IsReference())
+                    child = importObject(context, child.GetReference());
+                else if (child.IsDictionary() || child.IsArray())
+                    containers.push_back(&child);
+            }
         }
-        else
+        else if (container->IsReference())
         {
-            PODOFO_RAISE_ERROR(PdfErrorCode::InternalLogic);
+            *container = importObject(context, container->GetReference());
         }
     }
+}
 
-    return box;
+PdfObject PdfDocument::importObject(ImportContext& context, const PdfReference& ref)
+{
+    auto found = context.RefMap->find(ref);
+    if (found != context.RefMap->end())
+        return PdfObject(found->second);
+
+    auto sourceObj = context.SourceObjects->GetObject(ref);
+    if (sourceObj == nullptr || isPageTreeObject(*sourceObj))
+    {
+        // Don't follow the page tree, and the pages not being
+        // imported, or the whole source document would be copied
+        return PdfObject::Null;
+    }
+
+    if (sourceObj->HasStream())
+    {
+        if (context.ImportingStreams.find(ref) == context.ImportingStreams.end())
+            return PdfObject(importStream(context, *sourceObj));
+
+        // The stream is referenced by its own dictionary: create
+        // the copy now, and skip the deduplication of it
+        auto& newObj = m_Objects.CreateDictionaryObject();
+        (*context.RefMap)[ref] = newObj.GetIndirectReference();
+        return PdfObject(newObj.GetIndirectReference());
+    }
+
+    auto& newObj = m_Objects.CreateDictionaryObject();
+    (*context.RefMap)[ref] = newObj.GetIndirectReference();
+    context.PendingObjects.push_back({ sourceObj, &newObj });
+    context.ImportedObjects.push_back(&newObj);
+    IncrementCounter(PdfInstrumentationCounter::ImportedObjects);
+    return PdfObject(newObj.GetIndirectReference());
 }
 
-void PdfDocument::fixObjectReferences(PdfObject& obj, int difference)
+PdfReference PdfDocument::importStream(ImportContext& context, const PdfObject& sourceObj)
 {
-    if (obj.IsDictionary())
+    auto& ref = sourceObj.GetIndirectReference();
+    auto& sourceStream = sourceObj.MustGetStream();
+
+    // NOTE: The digest covers also the objects referenced by the
+    // stream, eg. the fonts of a form XObject, so it's computed on
+    // the source objects, before importing them
+    string digest;
+    if (context.Deduplicate)
     {
-        for (auto& pair : obj.GetDictionary())
+        digest = getObjectDigest(context.SourceDigests, sourceObj);
+        auto indexed = m_streamIndex->find(digest);
+        if (indexed != m_streamIndex->end())
         {
-            if (pair.second.IsReference())
-            {
-                pair.second = PdfObject(PdfReference(pair.second.GetReference().ObjectNumber() + difference,
-                    pair.second.GetReference().GenerationNumber()));
-            }
-            else if (pair.second.IsDictionary() ||
-                pair.second.IsArray())
+            // The indexed stream may have been removed or modified
+            // after a previous import. Streams already written can't
+            // be modified instead, and they are trusted
+            auto candidate = m_Objects.GetObject(indexed->second);
+            if (candidate != nullptr && candidate->HasStream()
+                && (candidate->IsImmutable()
+                    || context.IndexedStreams.find(indexed->second) != context.IndexedStreams.end()
+                    || getObjectDigest(context.Digests, *candidate) == digest))
             {
-                fixObjectReferences(pair.second, difference);
+                (*context.RefMap)[ref] = candidate->GetIndirectReference();
+                return candidate->GetIndirectReference();
             }
         }
     }
-    else if (obj.IsArray())
+
+    // NOTE: /Length is written by the serializer, and
+    // it may be an indirect object unique to the stream
+    PdfObject dict(sourceObj.GetDictionary());
+    dict.GetDictionary().RemoveKey(PdfName::KeyLength);
+    context.ImportingStreams.insert(ref);
+    fixImportedReferences(context, dict);
+    context.ImportingStreams.erase(ref);
+
+    PdfObject* newObj;
+    auto found = context.RefMap->find(ref);
+    if (found == context.RefMap->end())
     {
-        for (auto& child : obj.GetArray())
-        {
-            if (child.IsReference())
-            {
-                child = PdfObject(PdfReference(child.GetReference().ObjectNumber() + difference,
-                    child.GetReference().GenerationNumber()));
-            }
-            else if (child.IsDictionary() || child.IsArray())
-            {
-                fixObjectReferences(child, difference);
-            }
-        }
+        newObj = &m_Objects.CreateDictionaryObject();
+        (*context.RefMap)[ref] = newObj->GetIndirectReference();
+    }
+    else
+    {
+        // The copy was created while importing the dictionary
+        newObj = &m_Objects.MustGetObject(found->second);
     }
-    else if (obj.IsReference())
+
+    *newObj = std::move(dict);
+    auto input = sourceStream.GetInputStream(true);
+    newObj->GetOrCreateStream().SetData(input, PdfFilterFactory::CreateFilterList(sourceObj), true);
+    if (digest.length() != 0)
     {
-        obj = PdfObject(PdfReference(obj.GetReference().ObjectNumber() + difference,
-            obj.GetReference().GenerationNumber()));
+        (*m_streamIndex)[digest] = newObj->GetIndirectReference();
+        context.IndexedStreams.insert(newObj->GetIndirectReference());
     }
+
+    context.ImportedObjects.push_back(newObj);
+    IncrementCounter(PdfInstrumentationCounter::ImportedObjects);
+    return newObj->GetIndirectReference();
+}
+
+void PdfDocument::OnObjectsImported(const vector<PdfObject*>& objects)
+{
+    // Do nothing
+    (void)objects;
 }
 
 void PdfDocument::CollectGarbage()
@@ -510,6 +537,21 @@ PdfNameTree& PdfDocument::GetOrCreateNameTree()
     return *m_NameTree;
 }
 
+void PdfDocument::FlattenAnnotations(PdfFlattenFlags flags)
+{
+    auto& pages = GetPages();
+    for (unsigned i = 0; i < pages.GetCount(); i++)
+        pages.GetPageAt(i).flattenAnnotations(flags);
+
+    if (m_AcroForm == nullptr)
+        return;
+
+    // All the widgets have been flattened, so the
+    // fields are not reachable anymore
+    m_Catalog->GetDictionary().RemoveKey("AcroForm");
+    m_AcroForm = nullptr;
+}
+
 PdfAcroForm& PdfDocument::GetOrCreateAcroForm(PdfAcroFormDefaulAppearance defaultAppearance)
 {
     if (m_AcroForm != nullptr)
@@ -618,3 +660,280 @@ unique_ptr<PdfXObjectForm> PdfDocument::CreateXObjectForm(const Rect& rect, cons
 {
     return unique_ptr<PdfXObjectForm>(new PdfXObjectForm(*this, rect, prefix));
 }
+
+unique_ptr<PdfImage> PdfDocument::GetOrCreateImage(const string_view& filepath)
+{
+    string digest;
+    {
+        FileStreamDevice input(filepath);
+        digest = getDigest("Image", input);
+    }
+
+    auto cached = findCachedXObject(digest);
+    if (cached != nullptr)
+        return unique_ptr<PdfImage>(new PdfImage(*cached));
+
+    auto image = CreateImage();
+    image->Load(filepath);
+    cacheXObject(digest, image->GetObject());
+    return image;
+}
+
+unique_ptr<PdfImage> PdfDocument::GetOrCreateImageFromBuffer(const bufferview& buffer)
+{
+    SpanStreamDevice input(buffer);
+    auto digest = getDigest("Image", input);
+    auto cached = findCachedXObject(digest);
+    if (cached != nullptr)
+        return unique_ptr<PdfImage>(new PdfImage(*cached));
+
+    auto image = CreateImage();
+    image->LoadFromBuffer(buffer);
+    cacheXObject(digest, image->GetObject());
+    return image;
+}
+
+unique_ptr<PdfImage> PdfDocument::GetOrCreateImage(const bufferview& buffer, unsigned width,
+    unsigned height, PdfPixelFormat format, int rowSize)
+{
+    // NOTE: The same pixels may describe images with
+    // different sizes or formats, so the parameters
+    // are part of the digest
+    SpanStreamDevice input(buffer);
+    auto digest = getDigest(utls::Format("Pixels {} {} {} {}",
+        width, height, (unsigned)format, rowSize), input);
+    auto cached = findCachedXObject(digest);
+    if (cached != nullptr)
+        return unique_ptr<PdfImage>(new PdfImage(*cached));
+
+    auto image = CreateImage();
+    image->SetData(buffer, width, height, format, rowSize);
+    cacheXObject(digest, image->GetObject());
+    return image;
+}
+
+unique_ptr<PdfXObjectForm> PdfDocument::DeduplicateXObjectForm(unique_ptr<PdfXObjectForm> form)
+{
+    if (form == nullptr || &form->GetDocument() != this)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "The form must belong to this document");
+
+    auto& obj = form->GetObject();
+    if (obj.IsImmutable())
+        return form;
+
+    auto digest = getStreamDigest(obj);
+    auto cached = findCachedXObject(digest);
+    if (cached == nullptr || cached == &obj)
+    {
+        m_xobjectCache[digest] = { obj.GetIndirectReference(), digest };
+        return form;
+    }
+
+    // Find the references to the given form. Objects not yet
+    // loaded can't reference it, as it was created afterwards
+    auto ref = obj.GetIndirectReference();
+    vector<PdfObject*> references;
+    for (auto object : m_Objects)
+    {
+        if (object == &obj || !object->IsDelayedLoadDone())
+            continue;
+
+        size_t count = references.size();
+        collectReferences(*object, ref, references);
+        if (object->IsImmutable() && references.size() != count)
+        {
+            // The form is referenced by an object already
+            // written, and the reference can't be redirected
+            return form;
+        }
+    }
+
+    for (auto reference : references)
+        *reference = PdfObject(cached->GetIndirectReference());
+
+    form = nullptr;
+    m_Objects.RemoveObject(ref);
+    return unique_ptr<PdfXObjectForm>(new PdfXObjectForm(*cached));
+}
+
+PdfObject* PdfDocument::findCachedXObject(const string& digest)
+{
+    auto found = m_xobjectCache.find(digest);
+    if (found == m_xobjectCache.end())
+        return nullptr;
+
+    // The cached object may have been removed, or modified after it
+    // was cached. Objects already written can't be modified instead
+    auto obj = m_Objects.GetObject(found->second.Reference);
+    if (obj == nullptr || !obj->HasStream()
+        || (!obj->IsImmutable() && getStreamDigest(*obj) != found->second.ObjectDigest))
+    {
+        m_xobjectCache.erase(found);
+        return nullptr;
+    }
+
+    return obj;
+}
+
+void PdfDocument::cacheXObject(const string& digest, const PdfObject& obj)
+{
+    if (obj.IsImmutable())
+        m_xobjectCache[digest] = { obj.GetIndirectReference(), { } };
+    else
+        m_xobjectCache[digest] = { obj.GetIndirectReference(), getStreamDigest(obj) };
+}
+
+bool isPageTreeObject(const PdfObject& obj)
+{
+    const PdfDictionary* dict;
+    const PdfObject* typeObj;
+    const PdfName* type;
+    if (!obj.TryGetDictionary(dict)
+        || (typeObj = dict->GetKey(PdfName::KeyType)) == nullptr
+        || !typeObj->TryGetName(type))
+    {
+        return false;
+    }
+
+    return *type == "Page" || *type == "Pages" || *type == "Catalog";
+}
+
+// Compute a SHA-256 digest of the stream, of its dictionary
+// and of the objects referenced by them
+string getStreamDigest(const PdfObject& obj)
+{
+    DigestContext context(obj.MustGetDocument().GetObjects());
+    return getObjectDigest(context, obj);
+}
+
+// Compute a SHA-256 digest of the object, with the references
+// numbered in order of appearance and followed by the digests
+// of the referenced objects, so the same objects have the same
+// digest in different documents. The stream, if any, is read
+// in chunks so it's not buffered in memory
+string getObjectDigest(DigestContext& context, const PdfObject& obj)
+{
+    PdfObject copy(obj.GetVariant());
+    if (obj.HasStream())
+    {
+        // NOTE: /Length is written by the serializer, and
+        // it may be an indirect object unique to the stream
+        copy.GetDictionary().RemoveKey(PdfName::KeyLength);
+    }
+
+    vector<PdfReference> refs;
+    unordered_map<PdfReference, unsigned> refIndices;
+    auto renumber = [&](PdfObject& child) {
+        auto inserted = refIndices.insert({ child.GetReference(), (unsigned)refs.size() + 1 });
+        if (inserted.second)
+            refs.push_back(child.GetReference());
+
+        child = PdfObject(PdfReference(inserted.first->second, 0));
+    };
+
+    vector<PdfObject*> containers = { &copy };
+    while (containers.size() != 0)
+    {
+        auto container = containers.back();
+        containers.pop_back();
+        PdfDictionary* dict;
+        PdfArray* arr;
+        if (container->TryGetDictionary(dict))
+        {
+            for (auto& pair : *dict)
+            {
+                if (pair.second.IsReference())
+                    renumber(pair.second);
+                else if (pair.second.IsDictionary() || pair.second.IsArray())
+                    containers.push_back(&pair.second);
+            }
+        }
+        else if (container->TryGetArray(arr))
+        {
+            for (auto& child : *arr)
+            {
+                if (child.IsReference())
+                    renumber(child);
+                else if (child.IsDictionary() || child.IsArray())
+                    containers.push_back(&child);
+            }
+        }
+        else if (container->IsReference())
+        {
+            renumber(*container);
+        }
+    }
+
+    string header;
+    copy.ToString(header);
+    auto& ref = obj.GetIndirectReference();
+    if (ref.IsIndirect())
+        context.Visiting.insert(ref);
+
+    for (auto& childRef : refs)
+        header.append(getReferenceDigest(context, childRef));
+
+    if (ref.IsIndirect())
+        context.Visiting.erase(ref);
+
+    if (obj.HasStream())
+    {
+        auto input = obj.MustGetStream().GetInputStream(true);
+        return getDigest(header, input);
+    }
+    else
+    {
+        SpanStreamDevice input(string_view{ });
+        return getDigest(header, input);
+    }
+}
+
+string getReferenceDigest(DigestContext& context, const PdfReference& ref)
+{
+    // NOTE: The objects being visited are referenced back, eg. by
+    // /Parent keys, and the page tree is not followed, or the digest
+    // would cover the whole document. Neither is cached, since
+    // the digest of a cycle depends on where it's entered
+    if (context.Visiting.find(ref) != context.Visiting.end())
+        return "Cycle";
+
+    auto found = context.Digests.find(ref);
+    if (found != context.Digests.end())
+        return found->second;
+
+    auto obj = context.Objects->GetObject(ref);
+    if (obj == nullptr)
+        return "Null";
+    else if (isPageTreeObject(*obj))
+        return "Page";
+
+    auto digest = getObjectDigest(context, *obj);
+    context.Digests[ref] = digest;
+    return digest;
+}
+
+string getDigest(const string_view& header, InputStream& input)
+{
+    return ssl::ComputeHash(ssl::SHA256(), header, input);
+}
+
+void collectReferences(PdfObject& obj, const PdfReference& ref, vector<PdfObject*>& references)
+{
+    PdfDictionary* dict;
+    PdfArray* arr;
+    if (obj.IsReference())
+    {
+        if (obj.GetReference() == ref)
+            references.push_back(&obj);
+    }
+    else if (obj.TryGetDictionary(dict))
+    {
+        for (auto& pair : *dict)
+            collectReferences(pair.second, ref, references);
+    }
+    else if (obj.TryGetArray(arr))
+    {
+        for (auto& child : *arr)
+            collectReferences(child, ref, references);
+    }
+}
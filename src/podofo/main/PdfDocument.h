@@ -101,6 +101,33 @@ public:
 
     void CollectGarbage();
 
+    /** Flatten the annotations of all the pages. The normal appearance
+     *  of each annotation is drawn into the page contents, and then
+     *  the annotation is removed. Widgets are always flattened and
+     *  the interactive form is removed together with all its fields
+     *  \remarks Annotations other than widgets that have no normal
+     *  appearance are kept. Hidden annotations are removed without
+     *  being drawn. The PdfAcroForm and the PdfField instances
+     *  previously retrieved are invalidated
+     */
+    void FlattenAnnotations(PdfFlattenFlags flags = PdfFlattenFlags::None);
+
+    /** Shrink the images drawn in the pages
+     *
+     * The effective resolution of each image is computed from the
+     * transformation matrices it's drawn with, in the page contents
+     * and in the XObject forms they use. Images with a resolution
+     * higher than PdfImageOptimizeParams::MaxResolution are downsampled.
+     * The images are then encoded with JPEG, if they were JPEG already
+     * or look photographic, or with Flate and PNG predictors otherwise.
+     * The image stream is replaced only if it gets smaller
+     * \remarks Only 8 bits gray and RGB images, optionally JPEG
+     * encoded, are supported. Image masks, color key masked images
+     * and images with a /Decode array are left untouched
+     * \returns the number of images that have been replaced
+     */
+    unsigned OptimizeImages(const PdfImageOptimizeParams& params = { });
+
     /** Constuct a new PdfImage object
      *  \param prefix optional prefix for XObject-name
      */
@@ -108,6 +135,50 @@ public:
 
     std::unique_ptr<PdfXObjectForm> CreateXObjectForm(const Rect& rect, const std::string_view& prefix = { });
 
+    /** Get an image loaded from a file, reusing the image of the
+     *  document previously loaded with the same content
+     *
+     *  Images are cached by the SHA-256 digest of the file content,
+     *  so an image repeated many times, eg. a logo on every page, is
+     *  decoded and stored once
+     *  \remarks CreateImage() and PdfImage::Load() can't use the cache,
+     *      as the image object is created before its content is known.
+     *      A cached image that is modified is not returned anymore
+     *  \see PdfImage::Load
+     */
+    std::unique_ptr<PdfImage> GetOrCreateImage(const std::string_view& filepath);
+
+    /** Get an image loaded from encoded bytes, reusing the image of
+     *  the document previously loaded with the same content
+     *  \see GetOrCreateImage
+     *  \see PdfImage::LoadFromBuffer
+     */
+    std::unique_ptr<PdfImage> GetOrCreateImageFromBuffer(const bufferview& buffer);
+
+    /** Get an image with the given pixels, reusing the image of the
+     *  document previously created with the same pixels and parameters
+     *  \see GetOrCreateImage
+     *  \see PdfImage::SetData
+     */
+    std::unique_ptr<PdfImage> GetOrCreateImage(const bufferview& buffer, unsigned width,
+        unsigned height, PdfPixelFormat format, int rowSize = -1);
+
+    /** Replace the given XObject form with an identical form of the
+     *  document, previously passed to this method
+     *
+     *  Forms are identical when they have the same dictionary and the
+     *  same content. When an identical form is found, the references to
+     *  the given form, eg. from the resources of a canvas where it's
+     *  already drawn, are redirected to the existing form. The object
+     *  of the given form is then removed from the document and the
+     *  existing form is returned, otherwise the given form is cached
+     *  and returned
+     *  \remarks The form should be passed after drawing is finished.
+     *      Forms already written, eg. by PdfStreamedDocument, or
+     *      referenced by objects already written are returned as they are
+     */
+    std::unique_ptr<PdfXObjectForm> DeduplicateXObjectForm(std::unique_ptr<PdfXObjectForm> form);
+
     /** Checks if printing this document is allowed.
      *  Every PDF-consuming application has to adhere to this value!
      *
@@ -302,27 +373,69 @@ protected:
      */
     virtual void SetPdfVersion(PdfVersion version) = 0;
 
+    /** Called after pages of another document have been imported
+     *  \param objects the imported objects that are not referenced
+     *      directly by the pages and won't be further modified
+     *  \remarks The default implementation does nothing
+     */
+    virtual void OnObjectsImported(const std::vector<PdfObject*>& objects);
+
 private:
     // Called by PdfPageCollection
-    void AppendDocumentPages(const PdfDocument& doc);
-    void InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex);
-    void AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount);
+    void AppendDocumentPages(const PdfDocument& doc, PdfImportFlags flags);
+    void InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex, PdfImportFlags flags);
+    void AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount, PdfImportFlags flags);
 
     // Called by PdfXObjectForm
     Rect FillXObjectFromPage(PdfXObjectForm& xobj, const PdfPage& page, bool useTrimBox);
 
 private:
-    void append(const PdfDocument& doc, bool appendAll);
-    /** Recursively changes every PdfReference in the PdfObject and in any child
-     *  that is either an PdfArray or a direct object.
-     *  The reference is changed so that difference is added to the object number
-     *  of the reference.
-     *  \param obj object to change
-     *  \param difference add this value to every reference that is encountered
+    using ReferenceMap = std::unordered_map<PdfReference, PdfReference>;
+
+    /** Import a range of pages of another document, together with
+     *  the objects reachable from them, and the outlines
+     *  \param atIndex the index where to insert the pages
+     */
+    void importPages(const PdfDocument& doc, unsigned atIndex, unsigned pageIndex, unsigned pageCount,
+        PdfImportFlags flags);
+
+    struct ImportContext;
+
+    /** Import all the objects reachable from the given object of this
+     *  document, that is a copy of an object of the source document,
+     *  and change its references to the ones of the imported objects
+     *  \param refMap map of the objects already imported, from
+     *      the source references to the references in this document
+     */
+    void importReferences(const PdfIndirectObjectList& sourceObjects, PdfObject& obj, ReferenceMap& refMap);
+    void importReferences(ImportContext& context, PdfObject& obj);
+
+    /** Change the references in the given object, without following
+     *  other indirect objects, to the ones of the imported objects
      */
-    void fixObjectReferences(PdfObject& obj, int difference);
+    void fixImportedReferences(ImportContext& context, PdfObject& obj);
 
-    void deletePages(unsigned atIndex, unsigned pageCount);
+    /** Import the object with the given reference of the source document
+     *  \returns a reference to the imported object, or a null object
+     *      if the object must not be imported
+     */
+    PdfObject importObject(ImportContext& context, const PdfReference& ref);
+
+    /** Get a cached XObject by the digest of its content
+     *  \returns the XObject or nullptr if it's not cached, or it has
+     *      been removed or modified after it was cached
+     */
+    PdfObject* findCachedXObject(const std::string& digest);
+
+    void cacheXObject(const std::string& digest, const PdfObject& obj);
+
+    /** Import a stream object of the source document, replacing it
+     *  with an identical stream of this document when deduplicating
+     *  \remarks The dictionary of the stream is imported before
+     *      copying the stream, since the stream may be written
+     *      immediately, as in PdfStreamedDocument
+     */
+    PdfReference importStream(ImportContext& context, const PdfObject& sourceObj);
 
 private:
     PdfDocument& operator=(const PdfDocument&) = delete;
@@ -341,6 +454,19 @@ private:
     std::unique_ptr<PdfAcroForm> m_AcroForm;
     std::unique_ptr<PdfOutlines> m_Outlines;
     std::unique_ptr<PdfNameTree> m_NameTree;
+    // Streams of the document by SHA-256 digest of the content, built
+    // on the first import with PdfImportFlags::DeduplicateStreams
+    std::unique_ptr<std::unordered_map<std::string, PdfReference>> m_streamIndex;
+    struct CachedXObject
+    {
+        PdfReference Reference;
+        // The digest of the object stream when it was cached, empty
+        // for objects already written that can't be modified anymore
+        std::string ObjectDigest;
+    };
+    // Images and forms by SHA-256 digest of their source
+    // content and parameters, or of their final content
+    std::unordered_map<std::string, CachedXObject> m_xobjectCache;
 };
 
 };
@@ -0,0 +1,458 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <podofo/private/PdfDeclarationsPrivate.h>
+#include "PdfDocument.h"
+
+#include <unordered_set>
+
+#include "PdfContentStreamReader.h"
+#include "PdfFilter.h"
+#include <podofo/private/ParallelUtils.h>
+#include <podofo/private/ImageUtils.h>
+#include <podofo/auxiliary/StreamDevice.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+namespace
+{
+    struct ImageJob
+    {
+        PdfObject* Object;
+        unique_ptr<PdfImage> Image;
+        // The lowest effective resolution the image is drawn with
+        double Resolution;
+        bool Jpeg;
+        size_t Length;
+
+        // The optimized image
+        bool Replace = false;
+        unsigned Width = 0;
+        unsigned Height = 0;
+        PdfFilterType Filter = PdfFilterType::None;
+        charbuff Data;
+    };
+}
+
+// Map of image objects to their lowest effective resolution
+using ResolutionMap = unordered_map<const PdfObject*, double>;
+
+static void collectImageResolutions(const PdfPage& page, ResolutionMap& resolutions);
+static bool tryCreateImageJob(PdfObject& obj, double resolution, ImageJob& job);
+static void optimizeImage(ImageJob& job, const PdfImageOptimizeParams& params);
+static void downsample(const charbuff& src, unsigned srcWidth, unsigned srcHeight, unsigned srcScanLineSize,
+    unsigned components, charbuff& dst, unsigned dstWidth, unsigned dstHeight);
+static bool isPhotographic(const charbuff& pixels, unsigned components);
+static void encodeFlatePng(const charbuff& pixels, unsigned width, unsigned height,
+    unsigned components, charbuff& output);
+#ifdef PODOFO_HAVE_JPEG_LIB
+static void encodeJpeg(const charbuff& pixels, unsigned width, unsigned height,
+    unsigned components, double quality, charbuff& output);
+#endif // PODOFO_HAVE_JPEG_LIB
+
+unsigned PdfDocument::OptimizeImages(const PdfImageOptimizeParams& params)
+{
+    if (params.TargetResolution <= 0 || params.MaxResolution < params.TargetResolution)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "Invalid image resolutions");
+
+    ResolutionMap resolutions;
+    auto& pages = GetPages();
+    for (unsigned i = 0; i < pages.GetCount(); i++)
+        collectImageResolutions(pages.GetPageAt(i), resolutions);
+
+    // Images are decoded and encoded concurrently, so
+    // the objects and the streams are loaded upfront
+    vector<ImageJob> jobs;
+    for (auto& pair : resolutions)
+    {
+        auto obj = GetObjects().GetObject(pair.first->GetIndirectReference());
+        if (obj == nullptr)
+            continue;
+
+        ImageJob job;
+        if (tryCreateImageJob(*obj, pair.second, job))
+            jobs.push_back(std::move(job));
+    }
+
+    utls::ParallelFor(jobs.size(), params.ThreadCount, [&](size_t i)
+    {
+        optimizeImage(jobs[i], params);
+    });
+
+    unsigned count = 0;
+    for (auto& job : jobs)
+    {
+        if (!job.Replace)
+            continue;
+
+        job.Object->GetOrCreateStream().SetData(job.Data, { job.Filter }, true);
+        auto& dict = job.Object->GetDictionary();
+        dict.AddKey("Width", static_cast<int64_t>(job.Width));
+        dict.AddKey("Height", static_cast<int64_t>(job.Height));
+        dict.AddKey("BitsPerComponent", static_cast<int64_t>(8));
+        if (job.Filter == PdfFilterType::FlateDecode)
+        {
+            dict.AddKey("DecodeParms", utls::CreatePngPredictorParms(
+                job.Image->GetColorSpace().GetType() == PdfColorSpaceType::DeviceGray ? 1 : 3,
+                8, job.Width));
+        }
+        else
+        {
+            dict.RemoveKey("DecodeParms");
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+// Compute the effective resolution of the images drawn in the page,
+// following the CTM through the graphics states and the XObject forms
+void collectImageResolutions(const PdfPage& page, ResolutionMap& resolutions)
+{
+    PdfContentStreamReader reader(page);
+    PdfContent content;
+    vector<Matrix> states = { Matrix() };
+    // Count of the graphics states when each XObject form was entered
+    vector<size_t> formStateCounts;
+    while (reader.TryReadNext(content))
+    {
+        switch (content.Type)
+        {
+            case PdfContentType::Operator:
+            {
+                if ((content.Warnings & PdfContentWarnings::InvalidOperator) != PdfContentWarnings::None)
+                    continue;
+
+                switch (content.Operator)
+                {
+                    case PdfOperator::q:
+                    {
+                        states.push_back(states.back());
+                        break;
+                    }
+                    case PdfOperator::Q:
+                    {
+                        // Ignore unbalanced restores
+                        if (states.size() > (formStateCounts.size() == 0 ? 1 : formStateCounts.back()))
+                            states.pop_back();
+                        break;
+                    }
+                    case PdfOperator::cm:
+                    {
+                        auto& stack = content.Stack;
+                        auto cm = Matrix::FromCoefficients(stack[5].GetReal(), stack[4].GetReal(),
+                            stack[3].GetReal(), stack[2].GetReal(), stack[1].GetReal(), stack[0].GetReal());
+                        states.back() = cm * states.back();
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                break;
+            }
+            case PdfContentType::DoXObject:
+            {
+                if ((content.Warnings & PdfContentWarnings::RecursiveXObject) != PdfContentWarnings::None)
+                    continue;
+
+                if (content.XObject->GetType() == PdfXObjectType::Form)
+                {
+                    formStateCounts.push_back(states.size() + 1);
+                    states.push_back(content.XObject->GetMatrix() * states.back());
+                }
+                else if (content.XObject->GetType() == PdfXObjectType::Image)
+                {
+                    // Images are drawn in the unit square, so the
+                    // CTM scaling gives their size in points
+                    auto& image = static_cast<const PdfImage&>(*content.XObject);
+                    auto scaling = states.back().GetScalingRotation();
+                    double width = (Vector2(1, 0) * scaling).GetLength() / 72;
+                    double height = (Vector2(0, 1) * scaling).GetLength() / 72;
+                    if (width == 0 || height == 0)
+                        break;
+
+                    double resolution = std::min(image.GetWidth() / width, image.GetHeight() / height);
+                    auto inserted = resolutions.emplace(&image.GetObject(), resolution);
+                    if (!inserted.second && resolution < inserted.first->second)
+                        inserted.first->second = resolution;
+                }
+                break;
+            }
+            case PdfContentType::EndXObjectForm:
+            {
+                PODOFO_ASSERT(formStateCounts.size() != 0);
+                states.resize(formStateCounts.back() - 1);
+                formStateCounts.pop_back();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+bool tryCreateImageJob(PdfObject& obj, double resolution, ImageJob& job)
+{
+    auto stream = obj.GetStream();
+    if (stream == nullptr || !PdfXObject::TryCreateFromObject(obj, job.Image))
+        return false;
+
+    auto& dict = obj.GetDictionary();
+    if (dict.FindKeyAs<bool>("ImageMask") || dict.HasKey("Mask") || dict.HasKey("Decode"))
+        return false;
+
+    switch (job.Image->GetColorSpace().GetType())
+    {
+        case PdfColorSpaceType::DeviceGray:
+        case PdfColorSpaceType::DeviceRGB:
+            break;
+        default:
+            return false;
+    }
+
+    // NOTE: This also forces the loading of the stream
+    auto filters = PdfFilterFactory::CreateFilterList(obj);
+    job.Jpeg = filters.size() != 0 && filters.back() == PdfFilterType::DCTDecode;
+    for (auto filter : filters)
+    {
+        switch (filter)
+        {
+            case PdfFilterType::CCITTFaxDecode:
+            case PdfFilterType::JBIG2Decode:
+            case PdfFilterType::JPXDecode:
+            case PdfFilterType::Crypt:
+                return false;
+            default:
+                break;
+        }
+    }
+
+    if (!job.Jpeg && dict.FindKeyAs<int64_t>("BitsPerComponent") != 8)
+        return false;
+
+    job.Object = &obj;
+    job.Resolution = resolution;
+    job.Length = stream->GetLength();
+    return true;
+}
+
+void optimizeImage(ImageJob& job, const PdfImageOptimizeParams& params)
+{
+    auto& image = *job.Image;
+    unsigned width = image.GetWidth();
+    unsigned height = image.GetHeight();
+    if (width == 0 || height == 0)
+        return;
+
+    if (job.Resolution > params.MaxResolution)
+    {
+        double ratio = params.TargetResolution / job.Resolution;
+        width = std::max(1u, (unsigned)std::ceil(width * ratio));
+        height = std::max(1u, (unsigned)std::ceil(height * ratio));
+    }
+    else if (job.Jpeg)
+    {
+        // Re-encoding a JPEG image at the same size doesn't pay off
+        return;
+    }
+
+    bool gray = image.GetColorSpace().GetType() == PdfColorSpaceType::DeviceGray;
+    unsigned components = gray ? 1 : 3;
+    auto format = gray ? PdfPixelFormat::Grayscale : PdfPixelFormat::RGB24;
+
+    // JPEG images can be cheaply decoded at a reduced scale,
+    // as long as it's not smaller than the target size
+    PdfImageScale scale = PdfImageScale::Full;
+    if (job.Jpeg)
+    {
+        for (auto candidate : { PdfImageScale::Eighth, PdfImageScale::Quarter, PdfImageScale::Half })
+        {
+            if (image.GetScaledWidth(candidate) >= width && image.GetScaledHeight(candidate) >= height)
+            {
+                scale = candidate;
+                break;
+            }
+        }
+    }
+
+    charbuff decoded;
+    try
+    {
+        image.DecodeScaledTo(decoded, format, scale);
+    }
+    catch (PdfError& error)
+    {
+        // Leave untouched images that can't be decoded
+        PoDoFo::LogMessage(PdfLogSeverity::Warning, "Image {} can't be decoded: {}",
+            job.Object->GetIndirectReference().ToString(), error.what());
+        return;
+    }
+
+    unsigned srcWidth = image.GetScaledWidth(scale);
+    unsigned srcHeight = image.GetScaledHeight(scale);
+    charbuff pixels;
+    downsample(decoded, srcWidth, srcHeight, (unsigned)(decoded.size() / srcHeight),
+        components, pixels, width, height);
+    decoded.clear();
+    decoded.shrink_to_fit();
+
+    charbuff output;
+#ifdef PODOFO_HAVE_JPEG_LIB
+    if (params.AllowJpeg && (job.Jpeg || isPhotographic(pixels, components)))
+    {
+        encodeJpeg(pixels, width, height, components, params.JpegQuality, output);
+        job.Filter = PdfFilterType::DCTDecode;
+    }
+    else
+#endif // PODOFO_HAVE_JPEG_LIB
+    {
+        encodeFlatePng(pixels, width, height, components, output);
+        job.Filter = PdfFilterType::FlateDecode;
+    }
+
+    if (output.size() >= job.Length)
+        return;
+
+    job.Replace = true;
+    job.Width = width;
+    job.Height = height;
+    job.Data = std::move(output);
+}
+
+// Downsample the image averaging the source pixels covered by each
+// destination pixel. It also removes the source scan line padding
+void downsample(const charbuff& src, unsigned srcWidth, unsigned srcHeight, unsigned srcScanLineSize,
+    unsigned components, charbuff& dst, unsigned dstWidth, unsigned dstHeight)
+{
+    dst.resize((size_t)dstWidth * dstHeight * components);
+    if (srcWidth == dstWidth && srcHeight == dstHeight)
+    {
+        for (unsigned i = 0; i < dstHeight; i++)
+        {
+            std::memcpy(dst.data() + (size_t)i * dstWidth * components,
+                src.data() + (size_t)i * srcScanLineSize, (size_t)dstWidth * components);
+        }
+        return;
+    }
+
+    // Source ranges of the destination columns
+    vector<unsigned> columns(dstWidth + 1);
+    for (unsigned j = 0; j <= dstWidth; j++)
+        columns[j] = (unsigned)((uint64_t)j * srcWidth / dstWidth);
+
+    vector<unsigned> sums((size_t)dstWidth * components);
+    auto dstPixel = (unsigned char*)dst.data();
+    for (unsigned i = 0; i < dstHeight; i++)
+    {
+        unsigned rowBegin = (unsigned)((uint64_t)i * srcHeight / dstHeight);
+        unsigned rowEnd = std::max(rowBegin + 1, (unsigned)((uint64_t)(i + 1) * srcHeight / dstHeight));
+        std::fill(sums.begin(), sums.end(), 0);
+        for (unsigned y = rowBegin; y < rowEnd; y++)
+        {
+            auto srcLine = (const unsigned char*)src.data() + (size_t)y * srcScanLineSize;
+            for (unsigned j = 0; j < dstWidth; j++)
+            {
+                unsigned columnEnd = std::max(columns[j] + 1, columns[j + 1]);
+                for (unsigned x = columns[j]; x < columnEnd; x++)
+                {
+                    for (unsigned k = 0; k < components; k++)
+                        sums[j * components + k] += srcLine[x * components + k];
+                }
+            }
+        }
+
+        for (unsigned j = 0; j < dstWidth; j++)
+        {
+            unsigned count = (rowEnd - rowBegin) * (std::max(columns[j] + 1, columns[j + 1]) - columns[j]);
+            for (unsigned k = 0; k < components; k++)
+                *dstPixel++ = (unsigned char)((sums[j * components + k] + count / 2) / count);
+        }
+    }
+}
+
+// Images with many distinct colors, like photos and scans,
+// compress much better with JPEG than with Flate
+bool isPhotographic(const charbuff& pixels, unsigned components)
+{
+    constexpr size_t MaxPaletteSize = 256;
+    unordered_set<uint32_t> colors;
+    auto data = (const unsigned char*)pixels.data();
+    for (size_t i = 0; i < pixels.size(); i += components)
+    {
+        uint32_t color = data[i];
+        if (components == 3)
+            color |= (uint32_t)data[i + 1] << 8 | (uint32_t)data[i + 2] << 16;
+
+        if (colors.insert(color).second && colors.size() > MaxPaletteSize)
+            return true;
+    }
+
+    return false;
+}
+
+// Encode the pixels with Flate, choosing for each row the PNG
+// predictor with the lowest sum of absolute differences
+void encodeFlatePng(const charbuff& pixels, unsigned width, unsigned height,
+    unsigned components, charbuff& output)
+{
+    unsigned rowSize = width * components;
+    charbuff predicted;
+    predicted.reserve((size_t)(rowSize + 1) * height);
+    BufferStreamDevice stream(predicted);
+    utls::PngPredictorWriter writer(stream, rowSize, components);
+    for (unsigned i = 0; i < height; i++)
+        writer.WriteRow((const unsigned char*)pixels.data() + (size_t)i * rowSize);
+
+    output.clear();
+    PdfFilterFactory::Create(PdfFilterType::FlateDecode)->EncodeTo(output, predicted);
+}
+
+#ifdef PODOFO_HAVE_JPEG_LIB
+
+void encodeJpeg(const charbuff& pixels, unsigned width, unsigned height,
+    unsigned components, double quality, charbuff& output)
+{
+    jpeg_compress_struct ctx;
+    JpegErrorHandler jerr;
+    output.clear();
+    try
+    {
+        InitJpegCompressContext(ctx, jerr);
+
+        JpegBufferDestination jdest;
+        PoDoFo::SetJpegBufferDestination(ctx, output, jdest);
+
+        ctx.image_width = width;
+        ctx.image_height = height;
+        ctx.input_components = (int)components;
+        ctx.in_color_space = components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+
+        jpeg_set_defaults(&ctx);
+        jpeg_set_quality(&ctx, (int)(std::clamp(quality, 0.0, 1.0) * 100), TRUE);
+        jpeg_start_compress(&ctx, TRUE);
+
+        JSAMPROW row_pointer[1];
+        for (unsigned i = 0; i < height; i++)
+        {
+            row_pointer[0] = (JSAMPROW)const_cast<char*>(pixels.data()) + (size_t)i * width * components;
+            (void)jpeg_write_scanlines(&ctx, row_pointer, 1);
+        }
+
+        jpeg_finish_compress(&ctx);
+    }
+    catch (...)
+    {
+        jpeg_destroy_compress(&ctx);
+        throw;
+    }
+
+    jpeg_destroy_compress(&ctx);
+}
+
+#endif // PODOFO_HAVE_JPEG_LIB
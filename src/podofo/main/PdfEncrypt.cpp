@@ -15,6 +15,9 @@
 #include "PdfDictionary.h"
 #include "PdfFilter.h"
 
+#include <atomic>
+#include <podofo/private/ParallelUtils.h>
+
 #ifdef PODOFO_HAVE_LIBIDN
 // AES-256 dependencies :
 // SASL
@@ -26,7 +29,7 @@
 
 #include <openssl/opensslconf.h>
 #include <openssl/md5.h>
-#include <openssl/evp.h>
+#include <podofo/private/OpenSSLInternal.h>
 
 using namespace std;
 using namespace PoDoFo;
@@ -45,129 +48,108 @@ PdfEncryptAlgorithm::RC4V2 |
 PdfEncryptAlgorithm::AESV2;
 #endif // PODOFO_HAVE_LIBIDN
 
-#if OPENSSL_VERSION_MAJOR >= 3
-#include <openssl/provider.h>
-#endif // OPENSSL_VERSION_MAJOR >= 3
-
-class OpenSSLInit
-{
-public:
-    OpenSSLInit()
-    {
-#if OPENSSL_VERSION_MAJOR >= 3
-        m_libCtx = OSSL_LIB_CTX_new();
-        if (m_libCtx == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to create OpenSSL library context");
-
-        // NOTE: Load required legacy providers, such as RC4, together regular ones,
-        // as explained in https://wiki.openssl.org/index.php/OpenSSL_3.0#Providers
-        m_legacyProvider = OSSL_PROVIDER_load(m_libCtx, "legacy");
-        if (m_legacyProvider == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to load legacy providers in OpenSSL >= 3.x.x");
-
-        m_defaultProvider = OSSL_PROVIDER_load(m_libCtx, "default");
-        if (m_defaultProvider == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to load default providers in OpenSSL >= 3.x.x");
-
-        // https://www.openssl.org/docs/man3.0/man7/crypto.html#FETCHING-EXAMPLES
-        Rc4 = EVP_CIPHER_fetch(m_libCtx, "RC4", "provider=legacy");
-        Aes128 = EVP_CIPHER_fetch(m_libCtx, "AES-128-CBC", "provider=default");
-        Aes256 = EVP_CIPHER_fetch(m_libCtx, "AES-256-CBC", "provider=default");
-        MD5 = EVP_MD_fetch(m_libCtx, "MD5", "provider=default");
-        SHA256 = EVP_MD_fetch(m_libCtx, "SHA2-256", "provider=default");
-        SHA384 = EVP_MD_fetch(m_libCtx, "SHA2-384", "provider=default");
-        SHA512 = EVP_MD_fetch(m_libCtx, "SHA2-512", "provider=default");
-
-#else // OPENSSL_VERSION_MAJOR < 3
-        Rc4 = EVP_rc4();
-        Aes128 = EVP_aes_128_cbc();
-        Aes256 = EVP_aes_256_cbc();
-        MD5 = EVP_md5();
-        SHA256 = EVP_sha256();
-        SHA384 = EVP_sha384();
-        SHA512 = EVP_sha512();
-#endif // OPENSSL_VERSION_MAJOR >= 3
-    }
-
-    ~OpenSSLInit()
-    {
-#if OPENSSL_VERSION_MAJOR >= 3
-        OSSL_PROVIDER_unload(m_legacyProvider);
-        OSSL_PROVIDER_unload(m_defaultProvider);
-        OSSL_LIB_CTX_free(m_libCtx);
-#endif // OPENSSL_VERSION_MAJOR >= 3
-    }
-public:
-    const EVP_CIPHER* Rc4;
-    const EVP_CIPHER* Aes128;
-    const EVP_CIPHER* Aes256;
-    const EVP_MD* MD5;
-    const EVP_MD* SHA256;
-    const EVP_MD* SHA384;
-    const EVP_MD* SHA512;
-private:
-#if OPENSSL_VERSION_MAJOR >= 3
-    OSSL_LIB_CTX *m_libCtx;
-    OSSL_PROVIDER *m_legacyProvider;
-    OSSL_PROVIDER *m_defaultProvider;
-#endif // OPENSSL_VERSION_MAJOR >= 3
-} s_SSL;
-
 // Default value for P (permissions) = no permission
 #define PERMS_DEFAULT (PdfPermissions)0xFFFFF0C0
 
 #define AES_IV_LENGTH 16
 #define AES_BLOCK_SIZE 16
+// Size of the blocks encrypted at once by the encryption output streams
+#define ENCRYPTION_CHUNK_SIZE (size_t)16384
 
 namespace PoDoFo
 {
 
-// A class that holds the AES Crypto object
-class AESCryptoEngine
+// Cipher contexts are expensive to create, so they are reused.
+// They are also thread local, so the engines can be used
+// concurrently, eg. when decrypting streams in parallel.
+// NOTE: The contexts are shared by all the PdfEncrypt instances
+// of the thread, so they are reset each time they are fetched
+struct CipherContextDeleter
 {
-public:
-    AESCryptoEngine()
+    void operator()(EVP_CIPHER_CTX* ctx) const
     {
-        aes = EVP_CIPHER_CTX_new();
+        EVP_CIPHER_CTX_free(ctx);
     }
-    
-    EVP_CIPHER_CTX* getEngine()
+};
+
+using CipherContextPtr = unique_ptr<EVP_CIPHER_CTX, CipherContextDeleter>;
+
+static EVP_CIPHER_CTX* getThreadCipherContext(CipherContextPtr& ctx)
+{
+    if (ctx == nullptr)
     {
-        return aes;
+        ctx.reset(EVP_CIPHER_CTX_new());
+        if (ctx == nullptr)
+            PODOFO_RAISE_ERROR(PdfErrorCode::OutOfMemory);
     }
-    
-    ~AESCryptoEngine()
+    else
     {
-        EVP_CIPHER_CTX_free(aes);
+        // Clear the state left by the previous user, eg. the
+        // disabled padding of the AESV3 key decryption
+        EVP_CIPHER_CTX_reset(ctx.get());
     }
 
-private:
-    EVP_CIPHER_CTX *aes;
-};
+    return ctx.get();
+}
 
-// A class that holds the RC4 Crypto object
-// Either CCCrpytor or EVP_CIPHER_CTX
-class RC4CryptoEngine
+#ifdef PODOFO_HAVE_LIBIDN
+
+struct DigestContextDeleter
 {
-public:
+    void operator()(EVP_MD_CTX* ctx) const
+    {
+        EVP_MD_CTX_free(ctx);
+    }
+};
+
+using DigestContextPtr = unique_ptr<EVP_MD_CTX, DigestContextDeleter>;
 
-    RC4CryptoEngine()
+// Digest contexts for the iterated AES-256 password hash. They are
+// thread local, so passwords can be validated concurrently with no
+// allocation for each hash round
+struct HashContexts
+{
+    HashContexts()
+        : SHA256(EVP_MD_CTX_new()), SHA384(EVP_MD_CTX_new()), SHA512(EVP_MD_CTX_new()), AES(EVP_CIPHER_CTX_new())
     {
-        rc4 = EVP_CIPHER_CTX_new();
+        if (SHA256 == nullptr || SHA384 == nullptr || SHA512 == nullptr || AES == nullptr)
+            PODOFO_RAISE_ERROR(PdfErrorCode::OutOfMemory);
     }
 
+    DigestContextPtr SHA256;
+    DigestContextPtr SHA384;
+    DigestContextPtr SHA512;
+    CipherContextPtr AES;
+};
+
+static HashContexts& getThreadHashContexts()
+{
+    thread_local HashContexts contexts;
+    return contexts;
+}
+
+#endif // PODOFO_HAVE_LIBIDN
+
+// A class that holds the AES Crypto object
+class AESCryptoEngine
+{
+public:
     EVP_CIPHER_CTX* getEngine()
     {
-        return rc4;
+        thread_local CipherContextPtr aes;
+        return getThreadCipherContext(aes);
     }
+};
 
-    ~RC4CryptoEngine()
+// A class that holds the RC4 Crypto object
+class RC4CryptoEngine
+{
+public:
+    EVP_CIPHER_CTX* getEngine()
     {
-        EVP_CIPHER_CTX_free(rc4);
+        thread_local CipherContextPtr rc4;
+        return getThreadCipherContext(rc4);
     }
-
-private:
-    EVP_CIPHER_CTX* rc4;
 };
     
 /** A class that can encrypt/decrpyt streamed data block wise
@@ -250,10 +232,33 @@ private:
 
 };
 
+PdfEncryptOutputStream::PdfEncryptOutputStream()
+    : m_finished(false) { }
+
+void PdfEncryptOutputStream::Finish()
+{
+    if (m_finished)
+        return;
+
+    m_finished = true;
+    finish();
+}
+
+void PdfEncryptOutputStream::finish()
+{
+    // Do nothing
+}
+
+void PdfEncryptOutputStream::checkWrite() const
+{
+    if (m_finished)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "The encryption stream is already finished");
+}
+
 /** An OutputStream that encrypt all data written
  *  using the RC4 encryption algorithm
  */
-class PdfRC4OutputStream : public OutputStream
+class PdfRC4OutputStream : public PdfEncryptOutputStream
 {
 public:
     PdfRC4OutputStream(OutputStream& outputStream, unsigned char rc4key[256],
@@ -264,16 +269,23 @@ public:
 
     void writeBuffer(const char* buffer, size_t size) override
     {
-        charbuff outputBuffer(size);
-        std::memcpy(outputBuffer.data(), buffer, size);
-
-        m_stream.Encrypt(outputBuffer.data(), size);
-        m_OutputStream->Write(outputBuffer.data(), size);
+        // Encrypt through a fixed size buffer, so big
+        // writes are encrypted in constant memory
+        while (size != 0)
+        {
+            size_t chunkSize = std::min(size, ENCRYPTION_CHUNK_SIZE);
+            std::memcpy(m_buffer, buffer, chunkSize);
+            m_stream.Encrypt(m_buffer, chunkSize);
+            m_OutputStream->Write(m_buffer, chunkSize);
+            buffer += chunkSize;
+            size -= chunkSize;
+        }
     }
 
 private:
     OutputStream* m_OutputStream;
     PdfRC4Stream m_stream;
+    char m_buffer[ENCRYPTION_CHUNK_SIZE];
 };
 
 /** An InputStream that decrypts all data read
@@ -306,6 +318,85 @@ private:
     PdfRC4Stream m_stream;
 };
 
+static const EVP_CIPHER* getAESCipher(unsigned keyLen)
+{
+    switch (keyLen)
+    {
+        case (unsigned)PdfKeyLength::L128 / 8:
+            return ssl::Aes128();
+#ifdef PODOFO_HAVE_LIBIDN
+        case (unsigned)PdfKeyLength::L256 / 8:
+            return ssl::Aes256();
+#endif
+        default:
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Invalid AES key length");
+    }
+}
+
+/** An OutputStream that encrypts all data written
+ *  using the AES encryption algorithm in CBC mode
+ *
+ *  The initialization vector is written first, then the data
+ *  is encrypted in fixed size chunks carrying the CBC state
+ *  across the writes. The last padded block is written by Finish()
+ */
+class PdfAESOutputStream : public PdfEncryptOutputStream
+{
+public:
+    PdfAESOutputStream(OutputStream& outputStream, const unsigned char* key, unsigned keylen,
+        const unsigned char iv[AES_IV_LENGTH]) :
+        m_OutputStream(&outputStream)
+    {
+        m_ctx = EVP_CIPHER_CTX_new();
+        if (m_ctx == nullptr)
+            PODOFO_RAISE_ERROR(PdfErrorCode::OutOfMemory);
+
+        if (EVP_EncryptInit_ex(m_ctx, getAESCipher(keylen), nullptr, key, iv) != 1)
+        {
+            EVP_CIPHER_CTX_free(m_ctx);
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
+        }
+
+        m_OutputStream->Write((const char*)iv, AES_IV_LENGTH);
+    }
+
+    ~PdfAESOutputStream()
+    {
+        EVP_CIPHER_CTX_free(m_ctx);
+    }
+
+protected:
+    void finish() override
+    {
+        int outlen;
+        if (EVP_EncryptFinal_ex(m_ctx, m_buffer, &outlen) != 1)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error AES-encrypting data final");
+
+        m_OutputStream->Write((const char*)m_buffer, (size_t)outlen);
+    }
+
+    void writeBuffer(const char* buffer, size_t size) override
+    {
+        while (size != 0)
+        {
+            size_t chunkSize = std::min(size, ENCRYPTION_CHUNK_SIZE);
+            int outlen;
+            if (EVP_EncryptUpdate(m_ctx, m_buffer, &outlen, (const unsigned char*)buffer, (int)chunkSize) != 1)
+                PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error AES-encrypting data");
+
+            m_OutputStream->Write((const char*)m_buffer, (size_t)outlen);
+            buffer += chunkSize;
+            size -= chunkSize;
+        }
+    }
+
+private:
+    EVP_CIPHER_CTX* m_ctx;
+    OutputStream* m_OutputStream;
+    // Room for a chunk and the block held back by the cipher
+    unsigned char m_buffer[ENCRYPTION_CHUNK_SIZE + AES_BLOCK_SIZE];
+};
+
 /** A PdfAESInputStream that decrypts all data read
  *  using the AES encryption algorithm
  */
@@ -351,26 +442,7 @@ protected:
             if (read != AES_IV_LENGTH)
                 PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnexpectedEOF, "Can't read enough bytes for AES IV");
 
-            const EVP_CIPHER* cipher;
-            switch (m_keyLen)
-            {
-                case (size_t)PdfKeyLength::L128 / 8:
-                {
-                    cipher = s_SSL.Aes128;
-                    break;
-                }
-#ifdef PODOFO_HAVE_LIBIDN
-                case (size_t)PdfKeyLength::L256 / 8:
-                {
-                    cipher = s_SSL.Aes256;
-                    break;
-                }
-#endif
-                default:
-                    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Invalid AES key length");
-            }
-
-            rc = EVP_DecryptInit_ex(m_ctx, cipher, nullptr, m_key, (unsigned char*)iv);
+            rc = EVP_DecryptInit_ex(m_ctx, getAESCipher(m_keyLen), nullptr, m_key, (unsigned char*)iv);
             if (rc != 1)
                 PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
 
@@ -448,6 +520,30 @@ bool PdfEncrypt::Authenticate(const string_view& password, const PdfString& docu
     return Authenticate(password, documentId.GetRawData());
 }
 
+int PdfEncrypt::FindPassword(const cspan<string_view>& candidates, const PdfString& documentId, unsigned threadCount)
+{
+    int index = FindPasswordIndex(candidates, documentId.GetRawData(), threadCount);
+    if (index != -1 && !Authenticate(candidates[index], documentId.GetRawData()))
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "The matching password failed the authentication");
+
+    return index;
+}
+
+int PdfEncrypt::FindPasswordIndex(const cspan<string_view>& candidates,
+    const string_view& documentId, unsigned threadCount)
+{
+    // Key derivation for MD5 based algorithms is cheap
+    // and it alters the state, so just try them serially
+    (void)threadCount;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        if (Authenticate(candidates[i], documentId))
+            return (int)i;
+    }
+
+    return -1;
+}
+
 PdfEncryptAlgorithm PdfEncrypt::GetEnabledEncryptionAlgorithms()
 {
     return PdfEncrypt::s_EnabledEncryptionAlgorithms;
@@ -645,7 +741,7 @@ PdfEncrypt::PdfEncrypt(const PdfEncrypt& rhs)
     m_EncryptMetadata = rhs.m_EncryptMetadata;
 }
 
-bool PdfEncrypt::CheckKey(unsigned char key1[32], unsigned char key2[32])
+bool PdfEncrypt::CheckKey(const unsigned char key1[32], const unsigned char key2[32]) const
 {
     // Check whether the right password had been given
     bool success = true;
@@ -711,7 +807,7 @@ void PdfEncryptMD5Base::ComputeOwnerKey(const unsigned char userPad[32], const u
     int rc;
 
     unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr)) != 1)
+    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
     rc = EVP_DigestUpdate(ctx.get(), ownerPad, 32);
@@ -727,7 +823,7 @@ void PdfEncryptMD5Base::ComputeOwnerKey(const unsigned char userPad[32], const u
         // only use for the input as many bit as the key consists of
         for (int k = 0; k < 50; ++k)
         {
-            rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr);
+            rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr);
             if (rc != 1)
                 PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
@@ -769,7 +865,7 @@ void PdfEncryptMD5Base::ComputeEncryptionKey(const string_view& documentId,
     int rc;
 
     unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr)) != 1)
+    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
     rc = EVP_DigestUpdate(ctx.get(), userPad, 32);
@@ -823,7 +919,7 @@ void PdfEncryptMD5Base::ComputeEncryptionKey(const string_view& documentId,
     {
         for (k = 0; k < 50; ++k)
         {
-            rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr);
+            rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr);
             if (rc != 1)
                 PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
@@ -838,11 +934,12 @@ void PdfEncryptMD5Base::ComputeEncryptionKey(const string_view& documentId,
     }
 
     std::memcpy(m_encryptionKey, digest, m_keyLength);
+    ClearObjKeys();
 
     // Setup user key
     if (revision == 3 || revision == 4)
     {
-        rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr);
+        rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr);
         if (rc != 1)
             PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
@@ -883,6 +980,17 @@ void PdfEncryptMD5Base::ComputeEncryptionKey(const string_view& documentId,
 
 void PdfEncryptMD5Base::CreateObjKey(unsigned char objkey[16], unsigned& pnKeyLen, const PdfReference& objref) const
 {
+    {
+        std::lock_guard<std::mutex> lock(m_objKeysMutex);
+        auto found = m_objKeys.find(objref);
+        if (found != m_objKeys.end())
+        {
+            std::memcpy(objkey, found->second.Key, MD5_DIGEST_LENGTH);
+            pnKeyLen = found->second.Length;
+            return;
+        }
+    }
+
     const unsigned n = static_cast<unsigned>(objref.ObjectNumber());
     const unsigned g = static_cast<unsigned>(objref.GenerationNumber());
 
@@ -909,6 +1017,18 @@ void PdfEncryptMD5Base::CreateObjKey(unsigned char objkey[16], unsigned& pnKeyLe
 
     GetMD5Binary(nkey, nkeylen, objkey);
     pnKeyLen = (m_keyLength <= 11) ? m_keyLength + 5 : 16;
+
+    ObjKey cached;
+    std::memcpy(cached.Key, objkey, MD5_DIGEST_LENGTH);
+    cached.Length = pnKeyLen;
+    std::lock_guard<std::mutex> lock(m_objKeysMutex);
+    m_objKeys[objref] = cached;
+}
+
+void PdfEncryptMD5Base::ClearObjKeys()
+{
+    std::lock_guard<std::mutex> lock(m_objKeysMutex);
+    m_objKeys.clear();
 }
 
 PdfEncryptRC4Base::PdfEncryptRC4Base()
@@ -935,7 +1055,7 @@ void PdfEncryptRC4Base::RC4(const unsigned char* key, unsigned keylen,
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing RC4 encryption engine");
 
     // Don't set the key because we will modify the parameters
-    int status = EVP_EncryptInit_ex(rc4, s_SSL.Rc4, nullptr, nullptr, nullptr);
+    int status = EVP_EncryptInit_ex(rc4, ssl::Rc4(), nullptr, nullptr, nullptr);
     if (status != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing RC4 encryption engine");
 
@@ -962,7 +1082,7 @@ void PdfEncryptMD5Base::GetMD5Binary(const unsigned char* data, unsigned length,
 {
     int rc;
     unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), s_SSL.MD5, nullptr)) != 1)
+    if (ctx == nullptr || (rc = EVP_DigestInit_ex(ctx.get(), ssl::MD5(), nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing MD5 hashing engine");
 
     rc = EVP_DigestUpdate(ctx.get(), data, length);
@@ -1229,10 +1349,10 @@ void PdfEncryptAESBase::BaseDecrypt(const unsigned char* key, unsigned keyLen, c
 
     int rc;
     if (keyLen == (int)PdfKeyLength::L128 / 8)
-        rc = EVP_DecryptInit_ex(aes, s_SSL.Aes128, nullptr, key, iv);
+        rc = EVP_DecryptInit_ex(aes, ssl::Aes128(), nullptr, key, iv);
 #ifdef PODOFO_HAVE_LIBIDN
     else if (keyLen == (int)PdfKeyLength::L256 / 8)
-        rc = EVP_DecryptInit_ex(aes, s_SSL.Aes256, nullptr, key, iv);
+        rc = EVP_DecryptInit_ex(aes, ssl::Aes256(), nullptr, key, iv);
 #endif
     else
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Invalid AES key length");
@@ -1240,6 +1360,8 @@ void PdfEncryptAESBase::BaseDecrypt(const unsigned char* key, unsigned keyLen, c
     if (rc != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES decryption engine");
 
+    EVP_CIPHER_CTX_set_padding(aes, 1);
+
     int dataOutMoved;
     rc = EVP_DecryptUpdate(aes, textout, &dataOutMoved, textin, (int)textlen);
     outLen = dataOutMoved;
@@ -1261,10 +1383,10 @@ void PdfEncryptAESBase::BaseEncrypt(const unsigned char* key, unsigned keyLen, c
 
     int rc;
     if (keyLen == (int)PdfKeyLength::L128 / 8)
-        rc = EVP_EncryptInit_ex(aes, s_SSL.Aes128, nullptr, key, iv);
+        rc = EVP_EncryptInit_ex(aes, ssl::Aes128(), nullptr, key, iv);
 #ifdef PODOFO_HAVE_LIBIDN
     else if (keyLen == (int)PdfKeyLength::L256 / 8)
-        rc = EVP_EncryptInit_ex(aes, s_SSL.Aes256, nullptr, key, iv);
+        rc = EVP_EncryptInit_ex(aes, ssl::Aes256(), nullptr, key, iv);
 #endif
     else
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Invalid AES key length");
@@ -1272,6 +1394,8 @@ void PdfEncryptAESBase::BaseEncrypt(const unsigned char* key, unsigned keyLen, c
     if (rc != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
 
+    EVP_CIPHER_CTX_set_padding(aes, 1);
+
     int dataOutMoved;
     rc = EVP_EncryptUpdate(aes, textout, &dataOutMoved, textin, (int)textlen);
     if (rc != 1)
@@ -1439,14 +1563,12 @@ unique_ptr<InputStream> PdfEncryptAESV2::CreateEncryptionInputStream(InputStream
     
 unique_ptr<OutputStream> PdfEncryptAESV2::CreateEncryptionOutputStream(OutputStream& outputStream, const PdfReference& objref)
 {
-    (void)outputStream;
-    (void)objref;
-    /*unsigned char objkey[MD5_DIGEST_LENGTH];
-     int keylen;
-
-     this->CreateObjKey( objkey, &keylen );*/
-
-    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "CreateEncryptionOutputStream does not yet support AESV2");
+    unsigned char objkey[MD5_DIGEST_LENGTH];
+    unsigned keylen;
+    this->CreateObjKey(objkey, keylen, objref);
+    unsigned char iv[AES_IV_LENGTH];
+    this->GenerateInitialVector(iv);
+    return unique_ptr<OutputStream>(new PdfAESOutputStream(outputStream, objkey, keylen, iv));
 }
     
 #ifdef PODOFO_HAVE_LIBIDN
@@ -1471,37 +1593,35 @@ PdfEncryptSHABase::PdfEncryptSHABase(const PdfEncrypt& rhs) : PdfEncrypt(rhs)
     std::memcpy(m_oeValue, static_cast<const PdfEncryptSHABase*>(ptr)->m_oeValue, sizeof(unsigned char) * 32);
 }
 
-void PdfEncryptSHABase::ComputeHash(const unsigned char* pswd, unsigned pswdLen, unsigned char salt[8], unsigned char uValue[48], unsigned char hashValue[32])
+void PdfEncryptSHABase::ComputeHash(const unsigned char* pswd, unsigned pswdLen, const unsigned char salt[8],
+    const unsigned char uValue[48], unsigned char hashValue[32]) const
 {
     PODOFO_ASSERT(pswdLen <= 127);
 
+    auto& contexts = getThreadHashContexts();
+    auto sha256 = contexts.SHA256.get();
     int rc;
-    unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> sha256(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-    if (sha256 == nullptr || (rc = EVP_DigestInit_ex(sha256.get(), s_SSL.SHA256, nullptr)) != 1)
+    if ((rc = EVP_DigestInit_ex(sha256, ssl::SHA256(), nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing sha256 hashing engine");
 
     if (pswdLen != 0)
     {
-        rc = EVP_DigestUpdate(sha256.get(), pswd, pswdLen);
+        rc = EVP_DigestUpdate(sha256, pswd, pswdLen);
     }
 
-    rc = EVP_DigestUpdate(sha256.get(), salt, 8);
+    rc = EVP_DigestUpdate(sha256, salt, 8);
     if (uValue != nullptr)
     {
-        rc = EVP_DigestUpdate(sha256.get(), uValue, 48);
+        rc = EVP_DigestUpdate(sha256, uValue, 48);
     }
 
-    rc = EVP_DigestFinal_ex(sha256.get(), hashValue, nullptr);
+    rc = EVP_DigestFinal_ex(sha256, hashValue, nullptr);
 
     if (m_rValue > 5) // AES-256 according to PDF 1.7 Adobe Extension Level 8 (PDF 2.0)
     {
-        unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> sha384(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-        if (sha384 == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing sha384 hashing engine");
-
-        unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> sha512(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-        if (sha512 == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing sha512 hashing engine");
+        auto sha384 = contexts.SHA384.get();
+        auto sha512 = contexts.SHA512.get();
+        auto aes = contexts.AES.get();
 
         unsigned dataLen = 0;
         unsigned blockLen = 32; // Start with current SHA256 hash
@@ -1509,10 +1629,6 @@ void PdfEncryptSHABase::ComputeHash(const unsigned char* pswd, unsigned pswdLen,
         unsigned char block[64];
         std::memcpy(block, hashValue, 32);
 
-        unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> aes(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-        if (aes == nullptr)
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
-
         int dataOutMoved;
         for (unsigned i = 0; i < 64 || i < (unsigned)(32 + data[dataLen - 1]); i++)
         {
@@ -1534,8 +1650,8 @@ void PdfEncryptSHABase::ComputeHash(const unsigned char* pswd, unsigned pswdLen,
             // I'm not 100% sure the conversion is correct, since we don't
             // finalize the context. It may be unecessary because of some
             // preconditions, but these should be clearly stated
-            rc = EVP_EncryptInit_ex(aes.get(), s_SSL.Aes128, nullptr, block, block + 16);
-            rc = EVP_EncryptUpdate(aes.get(), data, &dataOutMoved, data, dataLen);
+            rc = EVP_EncryptInit_ex(aes, ssl::Aes128(), nullptr, block, block + 16);
+            rc = EVP_EncryptUpdate(aes, data, &dataOutMoved, data, dataLen);
             PODOFO_ASSERT((unsigned)dataOutMoved == dataLen);
 
             unsigned sum = 0;
@@ -1545,27 +1661,74 @@ void PdfEncryptSHABase::ComputeHash(const unsigned char* pswd, unsigned pswdLen,
 
             if (blockLen == 32)
             {
-                rc = EVP_DigestInit_ex(sha256.get(), s_SSL.SHA256, nullptr);
-                rc = EVP_DigestUpdate(sha256.get(), data, dataLen);
-                rc = EVP_DigestFinal_ex(sha256.get(), block, nullptr);
+                rc = EVP_DigestInit_ex(sha256, ssl::SHA256(), nullptr);
+                rc = EVP_DigestUpdate(sha256, data, dataLen);
+                rc = EVP_DigestFinal_ex(sha256, block, nullptr);
             }
             else if (blockLen == 48)
             {
-                rc = EVP_DigestInit_ex(sha384.get(), s_SSL.SHA384, nullptr);
-                rc = EVP_DigestUpdate(sha384.get(), data, dataLen);
-                rc = EVP_DigestFinal_ex(sha384.get(), block, nullptr);
+                rc = EVP_DigestInit_ex(sha384, ssl::SHA384(), nullptr);
+                rc = EVP_DigestUpdate(sha384, data, dataLen);
+                rc = EVP_DigestFinal_ex(sha384, block, nullptr);
             }
             else
             {
-                rc = EVP_DigestInit_ex(sha512.get(), s_SSL.SHA512, nullptr);
-                rc = EVP_DigestUpdate(sha512.get(), data, dataLen);
-                rc = EVP_DigestFinal_ex(sha512.get(), block, nullptr);
+                rc = EVP_DigestInit_ex(sha512, ssl::SHA512(), nullptr);
+                rc = EVP_DigestUpdate(sha512, data, dataLen);
+                rc = EVP_DigestFinal_ex(sha512, block, nullptr);
             }
         }
         std::memcpy(hashValue, block, 32);
     }
 }
 
+int PdfEncryptSHABase::FindPasswordIndex(const cspan<string_view>& candidates,
+    const string_view& documentId, unsigned threadCount)
+{
+    (void)documentId;
+
+    // The candidates are validated without altering the state,
+    // so it's safe to validate them concurrently
+    size_t count = candidates.size();
+    atomic<size_t> found(count);
+    utls::ParallelFor(count, threadCount, [&](size_t i)
+    {
+        // Skip candidates after one that already matched
+        if (i > found.load() || !isPasswordValid(candidates[i]))
+            return;
+
+        size_t curr = found.load();
+        while (i < curr && !found.compare_exchange_weak(curr, i))
+            ;
+    });
+
+    size_t index = found.load();
+    return index == count ? -1 : (int)index;
+}
+
+bool PdfEncryptSHABase::isPasswordValid(const string_view& password) const
+{
+    unsigned char pswd_sasl[127];
+    unsigned pswdLen;
+    try
+    {
+        PreprocessPassword(password, pswd_sasl, pswdLen);
+    }
+    catch (PdfError&)
+    {
+        // The password can't be a valid one
+        return false;
+    }
+
+    unsigned char hashValue[32];
+    ComputeHash(pswd_sasl, pswdLen, m_uValue + 32, nullptr, hashValue); // user Validation Salt
+    if (CheckKey(hashValue, m_uValue))
+        return true;
+
+    ComputeHash(pswd_sasl, pswdLen, m_oValue + 32, m_uValue, hashValue); // owner Validation Salt
+    return CheckKey(hashValue, m_oValue);
+}
+
 void PdfEncryptSHABase::ComputeUserKey(const unsigned char* userpswd, unsigned len)
 {
     // Generate User Salts
@@ -1596,7 +1759,7 @@ void PdfEncryptSHABase::ComputeUserKey(const unsigned char* userpswd, unsigned l
 
     int rc;
     unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> aes(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), s_SSL.Aes256, nullptr, hashValue, nullptr)) != 1)
+    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), ssl::Aes256(), nullptr, hashValue, nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
 
     EVP_CIPHER_CTX_set_padding(aes.get(), 0); // disable padding
@@ -1640,7 +1803,7 @@ void PdfEncryptSHABase::ComputeOwnerKey(const unsigned char* ownerpswd, unsigned
 
     int rc;
     unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> aes(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), s_SSL.Aes256, nullptr, hashValue, nullptr)) != 1)
+    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), ssl::Aes256(), nullptr, hashValue, nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
 
     EVP_CIPHER_CTX_set_padding(aes.get(), 0); // disable padding
@@ -1655,7 +1818,7 @@ void PdfEncryptSHABase::ComputeOwnerKey(const unsigned char* ownerpswd, unsigned
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error AES-encrypting data");
 }
 
-void PdfEncryptSHABase::PreprocessPassword(const string_view& password, unsigned char* outBuf, unsigned& len)
+void PdfEncryptSHABase::PreprocessPassword(const string_view& password, unsigned char* outBuf, unsigned& len) const
 {
     char* password_sasl;
     // NOTE: password view may be unterminated. Wrap it for stringprep_profile
@@ -1785,7 +1948,7 @@ void PdfEncryptAESV3::GenerateEncryptionKey(const string_view& documentId)
 
     int rc;
     unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> aes(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), s_SSL.Aes256, nullptr, m_encryptionKey, nullptr)) != 1)
+    if (aes == nullptr || (rc = EVP_EncryptInit_ex(aes.get(), ssl::Aes256(), nullptr, m_encryptionKey, nullptr)) != 1)
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing AES encryption engine");
 
     EVP_CIPHER_CTX_set_padding(aes.get(), 0); // disable padding
@@ -1833,7 +1996,7 @@ bool PdfEncryptAESV3::Authenticate(const string_view& password, const string_vie
             // AES-256 in CBC mode with no padding and an initialization vector of zero.
             // The 32-byte result is the file encryption key"
             EVP_CIPHER_CTX* aes = m_aes->getEngine();
-            EVP_DecryptInit_ex(aes, s_SSL.Aes256, nullptr, hashValue, 0); // iv zero
+            EVP_DecryptInit_ex(aes, ssl::Aes256(), nullptr, hashValue, 0); // iv zero
             EVP_CIPHER_CTX_set_padding(aes, 0); // no padding
             int lOutLen;
             EVP_DecryptUpdate(aes, m_encryptionKey, &lOutLen, m_oeValue, 32);
@@ -1850,7 +2013,7 @@ bool PdfEncryptAESV3::Authenticate(const string_view& password, const string_vie
         // AES-256 in CBC mode with no padding and an initialization vector of zero.
         // The 32-byte result is the file encryption key"
         EVP_CIPHER_CTX* aes = m_aes->getEngine();
-        EVP_DecryptInit_ex(aes, s_SSL.Aes256, nullptr, hashValue, 0); // iv zero
+        EVP_DecryptInit_ex(aes, ssl::Aes256(), nullptr, hashValue, 0); // iv zero
         EVP_CIPHER_CTX_set_padding(aes, 0); // no padding
         int lOutLen;
         EVP_DecryptUpdate(aes, m_encryptionKey, &lOutLen, m_ueValue, 32);
@@ -1970,9 +2133,10 @@ unique_ptr<InputStream> PdfEncryptAESV3::CreateEncryptionInputStream(InputStream
 
 unique_ptr<OutputStream> PdfEncryptAESV3::CreateEncryptionOutputStream(OutputStream& outputStream, const PdfReference& objref)
 {
-    (void)outputStream;
     (void)objref;
-    PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "CreateEncryptionOutputStream does not yet support AESV3");
+    unsigned char iv[AES_IV_LENGTH];
+    this->GenerateInitialVector(iv);
+    return unique_ptr<OutputStream>(new PdfAESOutputStream(outputStream, m_encryptionKey, m_keyLength, iv));
 }
     
 #endif // PODOFO_HAVE_LIBIDN
@@ -1995,7 +2159,15 @@ void PdfEncrypt::DecryptTo(charbuff& out, const bufferview& view, const PdfRefer
     // It was found like this in PdfString and PdfTokenizer
     // Fix it so it will allocate the exact amount of memory
     // needed, including RC4
-    size_t outBufferLen = view.size() - this->CalculateStreamOffset();
+    size_t offset = this->CalculateStreamOffset();
+    if (view.size() <= offset)
+    {
+        // Is empty
+        out.clear();
+        return;
+    }
+
+    size_t outBufferLen = view.size() - offset;
     out.resize(outBufferLen + 16 - (outBufferLen % 16));
     this->Decrypt(view.data(), view.size(), objref, out.data(), outBufferLen);
     out.resize(outBufferLen);
@@ -11,13 +11,16 @@
 #include "PdfString.h"
 #include "PdfReference.h"
 
+#include <mutex>
+
+#include <podofo/auxiliary/OutputStream.h>
+
 namespace PoDoFo
 {
 
 class PdfDictionary;
 class InputStream;
 class PdfObject;
-class OutputStream;
 class AESCryptoEngine;
 class RC4CryptoEngine;
 
@@ -97,6 +100,32 @@ enum class PdfEncryptAlgorithm
 #endif //PODOFO_HAVE_LIBIDN
 };
 
+/** An OutputStream that encrypts all data written to it
+ *  \remarks Finish() must be called after all the data has been
+ *  written, so the trailing data, eg. the last padded AES block,
+ *  is written to the underlying stream
+ */
+class PODOFO_API PdfEncryptOutputStream : public OutputStream
+{
+protected:
+    PdfEncryptOutputStream();
+
+public:
+    /** Write the trailing data to the underlying stream.
+     *  No more data can be written afterwards
+     */
+    void Finish();
+
+    bool IsFinished() const { return m_finished; }
+
+protected:
+    virtual void finish();
+    void checkWrite() const override;
+
+private:
+    bool m_finished;
+};
+
 /** A class that is used to encrypt a PDF file and
  *  set document permissions on the PDF file.
  *
@@ -215,7 +244,10 @@ public:
     /** Create an OutputStream that encrypts all data written to
      *  it using the current settings of the PdfEncrypt object.
      *
-     *  Warning: Currently only RC4 based encryption is supported using output streams!
+     *  The data is encrypted in fixed size chunks, so the memory
+     *  usage doesn't depend on the size of the written data.
+     *  The built-in encryptions return a PdfEncryptOutputStream:
+     *  call PdfEncryptOutputStream::Finish() after writing all the data
      *
      *  \param outputStream the created OutputStream writes all encrypted
      *         data to this output stream.
@@ -234,6 +266,22 @@ public:
      */
     bool Authenticate(const std::string_view& password, const PdfString& documentId);
 
+    /**
+     * Tries to authenticate a user with a list of candidate passwords,
+     * either user or owner ones, stopping at the first one that matches.
+     * On success the object is authenticated with the matching password
+     *
+     * \param candidates the candidate passwords
+     * \param documentId the documentId of the PDF file
+     * \param threadCount number of threads used to validate the candidates.
+     *     0 means hardware concurrency, 1 (default) means serial validation.
+     *     Candidates are validated concurrently only with AES-256 (revision 5 and 6)
+     *     encryption, where the validation of each password is expensive
+     *
+     * \returns the index of the first matching candidate, or -1 if none matches
+     */
+    int FindPassword(const cspan<std::string_view>& candidates, const PdfString& documentId, unsigned threadCount = 1);
+
     /** Get the encryption algorithm of this object.
      * \returns the PdfEncryptAlgorithm of this object
      */
@@ -356,6 +404,7 @@ public:
     void EncryptTo(charbuff& out, const bufferview& view, const PdfReference& objref) const;
 
     /** Decrypt a character span
+     * \remarks It's safe to call it concurrently from multiple threads
      */
     void DecryptTo(charbuff& out, const bufferview& view, const PdfReference& objref) const;
 
@@ -383,8 +432,15 @@ protected:
 
     virtual void GenerateEncryptionKey(const std::string_view& documentId) = 0;
 
+    /** Find the index of the first candidate that is either the user or the owner password
+     * The default implementation authenticates with the candidates serially
+     * \returns the index of the matching candidate, or -1 if none matches
+     */
+    virtual int FindPasswordIndex(const cspan<std::string_view>& candidates,
+        const std::string_view& documentId, unsigned threadCount);
+
     // Check two keys for equality
-    bool CheckKey(unsigned char key1[32], unsigned char key2[32]);
+    bool CheckKey(const unsigned char key1[32], const unsigned char key2[32]) const;
 
     PdfEncryptAlgorithm m_Algorithm;   // The used encryption algorithm
     PdfKeyLength m_eKeyLength;         // The encryption key length, as enum value
@@ -447,8 +503,12 @@ protected:
     // Compute encryption key to be used with AES-256
     void ComputeEncryptionKey();
 
+    int FindPasswordIndex(const cspan<std::string_view>& candidates,
+        const std::string_view& documentId, unsigned threadCount) override;
+
     // Compute hash for password and salt with optional uValue
-    void ComputeHash(const unsigned char* pswd, unsigned pswdLen, unsigned char salt[8], unsigned char uValue[48], unsigned char hashValue[32]);
+    void ComputeHash(const unsigned char* pswd, unsigned pswdLen, const unsigned char salt[8],
+        const unsigned char uValue[48], unsigned char hashValue[32]) const;
 
     // Generate the U and UE entries
     void ComputeUserKey(const unsigned char* userpswd, unsigned len);
@@ -458,8 +518,14 @@ protected:
 
     // Preprocess password for use in EAS-256 Algorithm
     // outBuf needs to be at least 127 bytes long
-    void PreprocessPassword(const std::string_view& password, unsigned char* outBuf, unsigned& len);
+    void PreprocessPassword(const std::string_view& password, unsigned char* outBuf, unsigned& len) const;
 
+private:
+    // Check if the password is either the user or the owner
+    // password, without altering the state of the object
+    bool isPasswordValid(const std::string_view& password) const;
+
+protected:
     unsigned char m_ueValue[32];        // UE entry in pdf document
     unsigned char m_oeValue[32];        // OE entry in pdf document
     unsigned char m_permsValue[16];     // Perms entry in pdf document
@@ -575,9 +641,26 @@ protected:
      */
     void CreateObjKey(unsigned char objkey[16], unsigned& pnKeyLen, const PdfReference& objref) const;
 
+    /** Clear the cached object keys. Must be called when the encryption key changes
+     */
+    void ClearObjKeys();
+
     unsigned char m_rc4key[16];         // last RC4 key
     unsigned char m_rc4last[256];       // last RC4 state table
 
+private:
+    struct ObjKey
+    {
+        unsigned char Key[16];
+        unsigned Length;
+    };
+
+private:
+    // The object keys are derived from the encryption key and the
+    // object reference with a MD5 digest. Strings and streams of
+    // the same object share the key, so they are cached
+    mutable std::mutex m_objKeysMutex;
+    mutable std::unordered_map<PdfReference, ObjKey> m_objKeys;
 };
 
 /** A class that is used to encrypt a PDF file (AES-128)
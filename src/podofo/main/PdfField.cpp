@@ -623,6 +623,12 @@ void PdfField::SetName(nullable<const PdfString&> name)
     {
         GetDictionary().RemoveKey("T");
     }
+
+    // The fully qualified names of the
+    // field and its descendants changed
+    auto acroForm = GetDocument().GetAcroForm();
+    if (acroForm != nullptr)
+        acroForm->invalidateFieldNames();
 }
 
 void PdfField::setName(const PdfString& name)
@@ -7,6 +7,7 @@
 #include <podofo/private/PdfDeclarationsPrivate.h>
 #include "PdfFieldChildrenCollection.h"
 #include "PdfField.h"
+#include "PdfDocument.h"
 #include "PdfArray.h"
 #include "PdfDictionary.h"
 
@@ -63,6 +64,7 @@ void PdfFieldChildrenCollectionBase::RemoveFieldAt(unsigned index)
     m_kidsArray->RemoveAt(index);
     m_Fields.erase(m_Fields.begin() + index);
     fixIndices(index);
+    invalidateFieldNames();
 
     // NOTE: No need to remove the object from the document
     // indirect object list: it will be garbage collected
@@ -80,6 +82,7 @@ void PdfFieldChildrenCollectionBase::RemoveField(const PdfReference& ref)
     m_kidsArray->RemoveAt(index);
     m_fieldMap->erase(found);
     fixIndices(index);
+    invalidateFieldNames();
 
     // NOTE: No need to remove the object from the document
     // indirect object list: it will be garbage collected
@@ -99,21 +102,25 @@ bool PdfFieldChildrenCollectionBase::HasKidsArray() const
 
 PdfFieldChildrenCollectionBase::iterator PdfFieldChildrenCollectionBase::begin()
 {
+    initFields();
     return m_Fields.begin();
 }
 
 PdfFieldChildrenCollectionBase::iterator PdfFieldChildrenCollectionBase::end()
 {
+    initFields();
     return m_Fields.end();
 }
 
 PdfFieldChildrenCollectionBase::const_iterator PdfFieldChildrenCollectionBase::begin() const
 {
+    const_cast<PdfFieldChildrenCollectionBase&>(*this).initFields();
     return m_Fields.begin();
 }
 
 PdfFieldChildrenCollectionBase::const_iterator PdfFieldChildrenCollectionBase::end() const
 {
+    const_cast<PdfFieldChildrenCollectionBase&>(*this).initFields();
     return m_Fields.end();
 }
 
@@ -128,9 +135,17 @@ PdfField& PdfFieldChildrenCollectionBase::AddChild(const shared_ptr<PdfField>& f
     m_kidsArray->AddIndirectSafe(field->GetObject());
     auto ret = field.get();
     m_Fields.push_back(field);
+    invalidateFieldNames();
     return *ret;
 }
 
+void PdfFieldChildrenCollectionBase::invalidateFieldNames()
+{
+    auto acroForm = m_field->GetDocument().GetAcroForm();
+    if (acroForm != nullptr)
+        acroForm->invalidateFieldNames();
+}
+
 PdfArray* PdfFieldChildrenCollectionBase::getKidsArray() const
 {
     auto obj = const_cast<PdfFieldChildrenCollectionBase&>(*this).m_field->GetDictionary().FindKey("Kids");
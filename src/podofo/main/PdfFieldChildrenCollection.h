@@ -77,11 +77,11 @@ namespace PoDoFo
             }
             value_type operator*()
             {
-                return m_iterator.get();
+                return (*m_iterator).get();
             }
             value_type operator->()
             {
-                return m_iterator.get();
+                return (*m_iterator).get();
             }
         private:
             TListIterator m_iterator;
@@ -105,6 +105,7 @@ namespace PoDoFo
         PdfField& getFieldAt(unsigned index) const;
         PdfField& getField(const PdfReference& ref) const;
         void fixIndices(unsigned index);
+        void invalidateFieldNames();
 
     private:
         using FieldMap = std::map<PdfReference, unsigned>;
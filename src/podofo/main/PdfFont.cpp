@@ -18,6 +18,7 @@
 #include "PdfEncodingFactory.h"
 #include <podofo/auxiliary/InputStream.h>
 #include "PdfObjectStream.h"
+#include "PdfFilter.h"
 #include "PdfWriter.h"
 #include "PdfCharCodeMap.h"
 #include "PdfEncodingShim.h"
@@ -242,6 +243,14 @@ void PdfFont::EmbedFont()
     m_IsEmbedded = true;
 }
 
+void PdfFont::PrepareEmbedFont()
+{
+    if (m_IsEmbedded || !m_EmbeddingEnabled || !m_SubsettingEnabled)
+        return;
+
+    prepareEmbedFontSubset();
+}
+
 void PdfFont::embedFont()
 {
     PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "Embedding not implemented for this font type");
@@ -252,6 +261,17 @@ void PdfFont::embedFontSubset()
     PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "Subsetting not implemented for this font type");
 }
 
+void PdfFont::prepareEmbedFontSubset()
+{
+    // Do nothing by default
+}
+
+void PdfFont::PrepareFontFileData(const bufferview& data)
+{
+    m_preparedFontFileData.clear();
+    PdfFilterFactory::Create(PdfFilterType::FlateDecode)->EncodeTo(m_preparedFontFileData, data);
+}
+
 unsigned PdfFont::GetGID(char32_t codePoint, PdfGlyphAccess access) const
 {
     unsigned gid;
@@ -321,9 +341,18 @@ bool PdfFont::TryGetEncodedStringLength(const PdfString& encodedStr, const PdfTe
 }
 
 bool PdfFont::TryScanEncodedString(const PdfString& encodedStr, const PdfTextState& state, string& utf8str, vector<double>& lengths, vector<unsigned>& positions) const
+{
+    bool success = TryScanEncodedString(encodedStr, utf8str, lengths, positions);
+    for (auto& length : lengths)
+        length = getGlyphLength(length, state, false);
+
+    return success;
+}
+
+bool PdfFont::TryScanEncodedString(const PdfString& encodedStr, string& utf8str, vector<double>& rawLengths, vector<unsigned>& positions) const
 {
     utf8str.clear();
-    lengths.clear();
+    rawLengths.clear();
     positions.clear();
 
     if (encodedStr.IsEmpty())
@@ -334,14 +363,12 @@ bool PdfFont::TryScanEncodedString(const PdfString& encodedStr, const PdfTextSta
     PdfCID cid;
     bool success = true;
     unsigned prevOffset = 0;
-    double length;
     while (!context.IsEndOfString())
     {
         if (!context.TryScan(cid, utf8str, codepoints))
             success = false;
 
-        length = getGlyphLength(GetCIDLengthRaw(cid.Id), state, false);
-        lengths.push_back(length);
+        rawLengths.push_back(GetCIDLengthRaw(cid.Id));
         positions.push_back(prevOffset);
         prevOffset = (unsigned)utf8str.length();
     }
@@ -349,6 +376,11 @@ bool PdfFont::TryScanEncodedString(const PdfString& encodedStr, const PdfTextSta
     return success;
 }
 
+double PdfFont::GetGlyphLength(double rawLength, const PdfTextState& state, bool ignoreCharSpacing)
+{
+    return getGlyphLength(rawLength, state, ignoreCharSpacing);
+}
+
 double PdfFont::GetWordSpacingLength(const PdfTextState& state) const
 {
     const_cast<PdfFont&>(*this).initWordSpacingLength();
@@ -577,7 +609,16 @@ void PdfFont::embedFontFileData(PdfObject& descriptor, const PdfName& fontFileNa
     // NOTE: Access to directory is mediated by functor to not crash
     // operations when using PdfStreamedDocument. Do not remove it
     dictWriter(contents.GetDictionary());
-    contents.GetOrCreateStream().SetData(data);
+    if (m_preparedFontFileData.empty())
+    {
+        contents.GetOrCreateStream().SetData(data);
+    }
+    else
+    {
+        // The data was already encoded in the preparation step
+        contents.GetOrCreateStream().SetData(m_preparedFontFileData, { PdfFilterType::FlateDecode }, true);
+        m_preparedFontFileData = charbuff();
+    }
 }
 
 void PdfFont::initWordSpacingLength()
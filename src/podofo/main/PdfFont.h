@@ -181,6 +181,20 @@ public:
     bool TryScanEncodedString(const PdfString& encodedStr, const PdfTextState& state, std::string& utf8str,
         std::vector<double>& lengths, std::vector<unsigned>& positions) const;
 
+    /** Scan string decoding unicode codepoints and obtaining glyphs raw widths
+     * The result doesn't depend on the text state, so it can be cached
+     * \param rawLengths raw widths of the glyphs, in glyph space units
+     * \param positions position of the CIDs in the utf8string
+     * emarks Produces a partial result also in case of failures
+     * \see GetGlyphLength
+     */
+    bool TryScanEncodedString(const PdfString& encodedStr, std::string& utf8str,
+        std::vector<double>& rawLengths, std::vector<unsigned>& positions) const;
+
+    /** Get the length of a glyph from its raw width, in the given state
+     */
+    static double GetGlyphLength(double rawLength, const PdfTextState& state, bool ignoreCharSpacing = false);
+
     /**
      *  \returns The spacing width
      */
@@ -362,6 +376,18 @@ protected:
 
     virtual void embedFontSubset();
 
+    /** Perform the CPU intensive part of the subset embedding,
+     * eg. building the subset font program, without accessing
+     * the document. It may be run concurrently with other fonts.
+     * Default implementation does nothing
+     */
+    virtual void prepareEmbedFontSubset();
+
+    /** Flate encode ahead the font program data that will be
+     * used by the next EmbedFontFile*() call
+     */
+    void PrepareFontFileData(const bufferview& data);
+
 private:
     PdfFont(const PdfFont& rhs) = delete;
 
@@ -370,6 +396,12 @@ private:
      */
     void EmbedFont();
 
+    /** Prepare the pending font for embedding. It doesn't
+     * access the document and it's safe to call concurrently
+     * on different fonts
+     */
+    void PrepareEmbedFont();
+
     /**
      * Perform inititialization tasks for fonts imported or created
      * from scratch
@@ -423,6 +455,7 @@ private:
     UsedGIDsMap m_SubsetGIDs;
     PdfCIDToGIDMapConstPtr m_cidToGidMap;
     double m_WordSpacingLengthRaw;
+    charbuff m_preparedFontFileData;
 
 protected:
     PdfFontMetricsConstPtr m_Metrics;
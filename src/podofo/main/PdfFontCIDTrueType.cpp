@@ -17,7 +17,8 @@ using namespace std;
 using namespace PoDoFo;
 
 PdfFontCIDTrueType::PdfFontCIDTrueType(PdfDocument& doc, const PdfFontMetricsConstPtr& metrics,
-        const PdfEncoding& encoding) : PdfFontCID(doc, metrics, encoding) { }
+        const PdfEncoding& encoding) : PdfFontCID(doc, metrics, encoding),
+    m_subsetPrepared(false) { }
 
 PdfFontType PdfFontCIDTrueType::GetType() const
 {
@@ -32,14 +33,20 @@ void PdfFontCIDTrueType::embedFontSubset()
     createWidths(GetDescendantFont().GetDictionary(), cidToGidMap);
     m_Encoding->ExportToFont(*this);
 
-    // Prepare a gid list to be used for subsetting
-    vector<unsigned> gids;
-    for (auto& pair : cidToGidMap)
-        gids.push_back(pair.second);
-
-    charbuff buffer;
-    PdfFontTrueTypeSubset::BuildFont(buffer, GetMetrics(), gids);
-    EmbedFontFileTrueType(GetDescriptor(), buffer);
+    if (m_subsetPrepared)
+    {
+        // The font program was already built and encoded
+        // in prepareEmbedFontSubset()
+        EmbedFontFileTrueType(GetDescriptor(), m_subsetData);
+        m_subsetData = charbuff();
+        m_subsetPrepared = false;
+    }
+    else
+    {
+        charbuff buffer;
+        buildFontSubset(cidToGidMap, buffer);
+        EmbedFontFileTrueType(GetDescriptor(), buffer);
+    }
 
     // We prepare the /CIDSet content now. NOTE: The CIDSet
     // entry is optional and it's actually deprecated in PDF 2.0
@@ -67,3 +74,22 @@ void PdfFontCIDTrueType::embedFontSubset()
     cidSetObj.GetOrCreateStream().SetData(cidSetData);
     GetDescriptor().GetDictionary().AddKeyIndirect("CIDSet", cidSetObj);
 }
+
+void PdfFontCIDTrueType::prepareEmbedFontSubset()
+{
+    // NOTE: Don't access the document here, this
+    // may be run concurrently with other fonts
+    buildFontSubset(getCIDToGIDMapSubset(GetUsedGIDs()), m_subsetData);
+    PrepareFontFileData(m_subsetData);
+    m_subsetPrepared = true;
+}
+
+void PdfFontCIDTrueType::buildFontSubset(const CIDToGIDMap& cidToGidMap, charbuff& buffer) const
+{
+    // Prepare a gid list to be used for subsetting
+    vector<unsigned> gids;
+    for (auto& pair : cidToGidMap)
+        gids.push_back(pair.second);
+
+    PdfFontTrueTypeSubset::BuildFont(buffer, GetMetrics(), gids);
+}
@@ -34,6 +34,14 @@ public:
 
 protected:
     void embedFontSubset() override;
+    void prepareEmbedFontSubset() override;
+
+private:
+    void buildFontSubset(const CIDToGIDMap& cidToGidMap, charbuff& buffer) const;
+
+private:
+    bool m_subsetPrepared;
+    charbuff m_subsetData;
 };
 
 };
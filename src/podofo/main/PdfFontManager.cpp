@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <podofo/private/FileSystem.h>
+#include <podofo/private/ParallelUtils.h>
 
 #if defined(_WIN32) && defined(PODOFO_HAVE_WIN32GDI)
 #include <podofo/private/WindowsLeanMean.h>
@@ -49,7 +50,7 @@ shared_ptr<PdfFontConfigWrapper> PdfFontManager::m_fontConfig;
 static constexpr unsigned SUBSET_PREFIX_LEN = 6;
 
 PdfFontManager::PdfFontManager(PdfDocument& doc)
-    : m_doc(&doc)
+    : m_doc(&doc), m_embeddingThreadCount(1)
 {
     m_currentPrefix = "AAAAAA+";
 }
@@ -151,6 +152,23 @@ const PdfFont* PdfFontManager::GetLoadedFont(const PdfResources& resources, cons
     }
 }
 
+PdfFont* PdfFontManager::GetDrawingFont(const PdfObject& fontObj)
+{
+    if (!fontObj.IsIndirect())
+        return nullptr;
+
+    auto found = m_fonts.find(fontObj.GetIndirectReference());
+    if (found != m_fonts.end())
+        return found->second.Font.get();
+
+    unique_ptr<PdfFont> font;
+    if (!PdfFont::TryCreateFromObject(const_cast<PdfObject&>(fontObj), font))
+        return nullptr;
+
+    auto inserted = m_fonts.emplace(fontObj.GetIndirectReference(), Storage{ true, std::move(font) });
+    return inserted.first->second.Font.get();
+}
+
 PdfFont* PdfFontManager::SearchFont(const string_view& fontPattern, const PdfFontCreateParams& createParams)
 {
     return SearchFont(fontPattern, PdfFontSearchParams(), createParams);
@@ -441,9 +459,41 @@ PdfFont& PdfFontManager::GetOrCreateFont(FT_Face face, const PdfFontCreateParams
     return getOrCreateFontHashed(metrics, params);
 }
 
+void PdfFontManager::SetEmbeddingThreadCount(unsigned threadCount)
+{
+    m_embeddingThreadCount = threadCount;
+}
+
 void PdfFontManager::EmbedFonts()
 {
-    // Embed all imported fonts
+    if (m_embeddingThreadCount != 1)
+    {
+        vector<PdfFont*> fonts;
+        for (auto& pair : m_cachedQueries)
+        {
+            for (auto& font : pair.second)
+            {
+                if (font->m_IsEmbedded || !font->IsEmbeddingEnabled()
+                    || !font->IsSubsettingEnabled())
+                {
+                    continue;
+                }
+
+                // Ensure lazy loaded font data, that may be shared
+                // between fonts, is loaded before starting workers
+                (void)font->GetMetrics().GetOrLoadFontFileData();
+                fonts.push_back(font);
+            }
+        }
+
+        utls::ParallelFor(fonts.size(), m_embeddingThreadCount, [&fonts](size_t i)
+        {
+            fonts[i]->PrepareEmbedFont();
+        });
+    }
+
+    // Embed all imported fonts. NOTE: This is always serial
+    // since it creates objects, so the output is deterministic
     for (auto& pair : m_cachedQueries)
     {
         for (auto& font : pair.second)
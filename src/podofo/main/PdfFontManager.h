@@ -57,6 +57,7 @@ class PODOFO_API PdfFontManager final
     friend class PdfFont;
     friend class PdfCommon;
     friend class PdfResources;
+    friend class PdfAcroForm;
 
 public:
     /** Get a font from the cache. If the font does not yet
@@ -126,6 +127,19 @@ public:
      */
     void EmbedFonts();
 
+    /** Set the number of threads used to prepare subset fonts
+     * (subset font program building and compression) in EmbedFonts().
+     * Fonts objects are still written to the document serially and in
+     * the same order, so the output is the same as serial embedding.
+     * NOTE: Only CID TrueType fonts are prepared concurrently, as
+     * they are the only fonts that currently support subsetting
+     * \param threadCount number of threads. 0 means hardware
+     *     concurrency, 1 (default) means serial embedding
+     */
+    void SetEmbeddingThreadCount(unsigned threadCount);
+
+    unsigned GetEmbeddingThreadCount() const { return m_embeddingThreadCount; }
+
     // These methods are reserved to use to selected friend classes
 private:
     PdfFontManager(PdfDocument& doc);
@@ -133,6 +147,12 @@ private:
 private:
     const PdfFont* GetLoadedFont(const PdfResources& resources, const std::string_view& name);
 
+    /** Get a font to draw text with from its indirect object,
+     * either created in this session or loaded from the document
+     * \returns the font or nullptr if the font couldn't be loaded
+     */
+    PdfFont* GetDrawingFont(const PdfObject& fontObj);
+
     /**
      * Empty the internal font cache.
      * This should be done when ever a new document
@@ -215,6 +235,7 @@ private:
 private:
     PdfDocument* m_doc;
     std::string m_currentPrefix;
+    unsigned m_embeddingThreadCount;
 
     // Map of cached font queries
     CachedQueries m_cachedQueries;
@@ -26,6 +26,7 @@ extern "C" {
 #include "PdfArray.h"
 #include "PdfColor.h"
 #include "PdfObjectStream.h"
+#include "PdfFilter.h"
 #include <podofo/auxiliary/StreamDevice.h>
 
 // TIFF and JPEG headers already included through "PdfFiltersPrivate.h",
@@ -43,6 +44,34 @@ static void createPngContext(png_structp& png, png_infop& pnginfo);
 
 static void fetchPDFScanLineRGB(unsigned char* dstScanLine,
     unsigned width, const unsigned char* srcScanLine, PdfPixelFormat srcPixelFormat);
+static unsigned getPixelSize(PdfPixelFormat format);
+static unsigned getScanLineSize(PdfPixelFormat format, unsigned width);
+static unsigned getScaledSize(unsigned size, unsigned scaleDenom);
+static charbuff subsampleMask(const charbuff& smaskData, unsigned width, unsigned height, unsigned scaleDenom);
+static bool isPlainJpegDecode(const PdfObject* decodeObj, const bufferview& jpeg);
+static bool hasAdobeMarker(const bufferview& jpeg);
+
+namespace PoDoFo
+{
+    // Write the scan lines of an image straight to its object
+    // stream, Flate compressed with PNG predictors, so the whole
+    // image is never held in memory
+    class PdfImageRowWriter final
+    {
+    public:
+        PdfImageRowWriter(PdfImage& image, const PdfImageInfo& info, unsigned colors);
+
+    public:
+        void WriteRow(const unsigned char* row);
+
+    private:
+        static PdfObjectOutputStream beginRows(PdfImage& image, const PdfImageInfo& info, unsigned colors);
+
+    private:
+        PdfObjectOutputStream m_output;
+        utls::PngPredictorWriter m_writer;
+    };
+}
 
 PdfImage::PdfImage(PdfDocument& doc, const string_view& prefix)
     : PdfXObject(doc, PdfXObjectType::Image, prefix), m_ColorSpace(PdfColorSpaceFactory::GetUnkownInstance()), m_Width(0), m_Height(0), m_BitsPerComponent(0)
@@ -62,8 +91,69 @@ void PdfImage::DecodeTo(const bufferspan& buffer, PdfPixelFormat format, int sca
     DecodeTo(stream, format, scanLineSize);
 }
 
-// TODO: Improve performance and format support
 void PdfImage::DecodeTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize) const
+{
+    decodeTo(stream, format, scanLineSize, 1);
+}
+
+void PdfImage::DecodeScaledTo(charbuff& buffer, PdfPixelFormat format, PdfImageScale scale, int scanLineSize) const
+{
+    unsigned height = GetScaledHeight(scale);
+    if (scanLineSize < 0)
+        buffer.resize((size_t)getScanLineSize(format, GetScaledWidth(scale)) * height);
+    else
+        buffer.resize((size_t)scanLineSize * height);
+
+    SpanStreamDevice stream(buffer);
+    DecodeScaledTo(stream, format, scale, scanLineSize);
+}
+
+void PdfImage::DecodeScaledTo(OutputStream& stream, PdfPixelFormat format, PdfImageScale scale, int scanLineSize) const
+{
+    switch (scale)
+    {
+        case PdfImageScale::Full:
+        case PdfImageScale::Half:
+        case PdfImageScale::Quarter:
+        case PdfImageScale::Eighth:
+            break;
+        default:
+            PODOFO_RAISE_ERROR(PdfErrorCode::InvalidEnumValue);
+    }
+
+    // Only JPEG images can be scaled while decoding
+    auto filters = PdfFilterFactory::CreateFilterList(GetObject());
+    if (scale == PdfImageScale::Full || (filters.size() != 0 && filters.back() == PdfFilterType::DCTDecode))
+        decodeTo(stream, format, scanLineSize, (unsigned)scale);
+    else
+        decodeSubsampledTo(stream, format, scanLineSize, (unsigned)scale);
+}
+
+bool PdfImage::TryGetRawJpegData(charbuff& buff) const
+{
+    auto stream = GetObject().GetStream();
+    if (stream == nullptr)
+        return false;
+
+    auto istream = stream->GetInputStream();
+    auto& mediaFilters = istream.GetMediaFilters();
+    if (mediaFilters.size() != 1 || mediaFilters[0] != PdfFilterType::DCTDecode)
+        return false;
+
+    buff.clear();
+    ContainerStreamDevice device(buff);
+    istream.CopyTo(device);
+    if (!isPlainJpegDecode(GetDictionary().FindKey("Decode"), buff))
+    {
+        buff.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// TODO: Improve performance and format support
+void PdfImage::decodeTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize, unsigned scaleDenom) const
 {
     auto istream = GetObject().MustGetStream().GetInputStream();
     auto& mediaFilters = istream.GetMediaFilters();
@@ -131,9 +221,19 @@ void PdfImage::DecodeTo(OutputStream& stream, PdfPixelFormat format, int scanLin
                         ctx.out_color_space = format == PdfPixelFormat::Grayscale ? JCS_GRAYSCALE : JCS_RGB;
                     }
 
+                    if (scaleDenom != 1)
+                    {
+                        // Let libjpeg scale the image in the DCT domain, which
+                        // skips most of the inverse DCT and upsampling work
+                        ctx.scale_num = 1;
+                        ctx.scale_denom = scaleDenom;
+                        if (smaskData.size() != 0)
+                            smaskData = subsampleMask(smaskData, m_Width, m_Height, scaleDenom);
+                    }
+
                     jpeg_start_decompress(&ctx);
 
-                    utls::FetchImageJPEG(stream, format, scanLineSize, &ctx, m_Width, m_Height, smaskData);
+                    utls::FetchImageJPEG(stream, format, scanLineSize, &ctx, ctx.output_width, ctx.output_height, smaskData);
                 }
                 catch (...)
                 {
@@ -180,6 +280,35 @@ void PdfImage::DecodeTo(OutputStream& stream, PdfPixelFormat format, int scanLin
     }
 }
 
+void PdfImage::decodeSubsampledTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize, unsigned scaleDenom) const
+{
+    charbuff imageData;
+    DecodeTo(imageData, format);
+
+    unsigned pixelSize = getPixelSize(format);
+    unsigned srcScanLineSize = getScanLineSize(format, m_Width);
+    unsigned width = getScaledSize(m_Width, scaleDenom);
+    unsigned height = getScaledSize(m_Height, scaleDenom);
+    unsigned dstScanLineSize = getScanLineSize(format, width);
+    if (scanLineSize >= 0)
+    {
+        if (scanLineSize < (int)dstScanLineSize)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "The buffer row size is too small");
+
+        dstScanLineSize = (unsigned)scanLineSize;
+    }
+
+    charbuff scanLine(dstScanLineSize);
+    for (unsigned i = 0; i < height; i++)
+    {
+        auto srcScanLine = imageData.data() + (size_t)i * scaleDenom * srcScanLineSize;
+        for (unsigned j = 0; j < width; j++)
+            std::memcpy(scanLine.data() + j * pixelSize, srcScanLine + j * scaleDenom * pixelSize, pixelSize);
+
+        stream.Write(scanLine.data(), scanLine.size());
+    }
+}
+
 charbuff PdfImage::GetDecodedCopy(PdfPixelFormat format)
 {
     charbuff buffer;
@@ -299,6 +428,9 @@ void PdfImage::SetData(InputStream& stream, unsigned width, unsigned height, Pdf
     dict.AddKey("ColorSpace", PdfName(PoDoFo::ColorSpaceToNameRaw(colorSpace)));
     // Remove possibly existing /Decode array
     dict.RemoveKey("Decode");
+    m_ColorSpace = colorSpace == PdfColorSpaceType::DeviceGray
+        ? PdfColorSpaceFactory::GetDeviceGrayInstace()
+        : PdfColorSpaceFactory::GetDeviceRGBInstace();
 }
 
 void PdfImage::SetDataRaw(const bufferview& buffer, const PdfImageInfo& info)
@@ -308,6 +440,15 @@ void PdfImage::SetDataRaw(const bufferview& buffer, const PdfImageInfo& info)
 }
 
 void PdfImage::SetDataRaw(InputStream& stream, const PdfImageInfo& info)
+{
+    setImageInfo(info);
+    if (info.Filters.has_value())
+        GetObject().GetOrCreateStream().SetData(stream, *info.Filters, true);
+    else
+        GetObject().GetOrCreateStream().SetData(stream);
+}
+
+void PdfImage::setImageInfo(const PdfImageInfo& info)
 {
     m_ColorSpace = info.ColorSpace;
     m_Width = info.Width;
@@ -333,11 +474,28 @@ void PdfImage::SetDataRaw(InputStream& stream, const PdfImageInfo& info)
 
     PdfObject colorSpace = info.ColorSpace->GetExportObject(GetDocument().GetObjects());
     dict.AddKey("ColorSpace", colorSpace);
+}
 
-    if (info.Filters.has_value())
-        GetObject().GetOrCreateStream().SetData(stream, *info.Filters, true);
-    else
-        GetObject().GetOrCreateStream().SetData(stream);
+PdfImageRowWriter::PdfImageRowWriter(PdfImage& image, const PdfImageInfo& info, unsigned colors)
+    : m_output(beginRows(image, info, colors)),
+    m_writer(m_output, (info.Width * colors * info.BitsPerComponent + 7) / 8,
+        (colors * info.BitsPerComponent + 7) / 8)
+{
+}
+
+void PdfImageRowWriter::WriteRow(const unsigned char* row)
+{
+    m_writer.WriteRow(row);
+}
+
+PdfObjectOutputStream PdfImageRowWriter::beginRows(PdfImage& image, const PdfImageInfo& info, unsigned colors)
+{
+    // NOTE: The dictionary must be complete before the stream
+    // is opened, as it may be written immediately
+    image.setImageInfo(info);
+    image.GetDictionary().AddKey("DecodeParms",
+        utls::CreatePngPredictorParms(colors, info.BitsPerComponent, info.Width));
+    return image.GetObject().GetOrCreateStream().GetOutputStream({ PdfFilterType::FlateDecode });
 }
 
 void PdfImage::Load(const string_view& filepath)
@@ -429,6 +587,10 @@ void PdfImage::ExportTo(charbuff& buff, PdfExportFormat format, PdfArray args) c
             PODOFO_RAISE_ERROR(PdfErrorCode::NotImplemented);
         case PdfExportFormat::Jpeg:
 #ifdef PODOFO_HAVE_JPEG_LIB
+            // Export the JPEG data as it is, if no quality was requested
+            if (args.GetSize() == 0 && TryGetRawJpegData(buff))
+                break;
+
             exportToJpeg(buff, args);
 #else
             PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "Missing jpeg support");
@@ -552,7 +714,10 @@ void PdfImage::loadFromJpegInfo(jpeg_decompress_struct& ctx, PdfImageInfo& info)
         PODOFO_RAISE_ERROR(PdfErrorCode::UnexpectedEOF);
     }
 
-    jpeg_start_decompress(&ctx);
+    // NOTE: Only the output dimensions are needed. Starting the
+    // decompression would allocate the full coefficient buffers
+    // of progressive images, which is huge for large scans
+    jpeg_calc_output_dimensions(&ctx);
 
     info.Width = ctx.output_width;
     info.Height = ctx.output_height;
@@ -752,22 +917,21 @@ void PdfImage::loadFromTiffHandle(void* handle)
         }
     }
 
-    size_t scanlineSize = TIFFScanlineSize(hInTiffHandle);
-    size_t bufferSize = scanlineSize * height;
-    charbuff buffer(bufferSize);
+    // Stream the scan lines to the image, one at a time
+    charbuff scanline((size_t)TIFFScanlineSize(hInTiffHandle));
+    PdfImageRowWriter writer(*this, info, samplesPerPixel);
     for (row = 0; row < height; row++)
     {
         if (TIFFReadScanline(hInTiffHandle,
-            &buffer[row * scanlineSize],
+            scanline.data(),
             row) == (-1))
         {
             TIFFClose(hInTiffHandle);
             PODOFO_RAISE_ERROR(PdfErrorCode::UnsupportedImageFormat);
         }
-    }
 
-    SpanStreamDevice input(buffer);
-    SetDataRaw(input, info);
+        writer.WriteRow((const unsigned char*)scanline.data());
+    }
 }
 
 void PdfImage::loadFromTiff(const string_view& filename)
@@ -1076,128 +1240,153 @@ void loadFromPngContent(PdfImage& image, png_structp png, png_infop pnginfo)
         &color_type, &interlace, NULL, NULL);
     // End
 
-    // Read the file
-    size_t rowLen = png_get_rowbytes(png, pnginfo);
-    size_t len = rowLen * height;
-    charbuff buffer(len);
+    PdfImageInfo info;
+    info.Width = (unsigned)width;
+    info.Height = (unsigned)height;
+    info.BitsPerComponent = (unsigned char)depth;
+    unsigned colors;
+    // Set color space
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+    {
+        png_color* paletteColors;
+        int colorCount;
+        png_get_PLTE(png, pnginfo, &paletteColors, &colorCount);
 
-    unique_ptr<png_bytep[]> rows(new png_bytep[height]);
-    for (unsigned int y = 0; y < height; y++)
+        charbuff data(colorCount * 3);
+        for (int i = 0; i < colorCount; i++, paletteColors++)
+        {
+            data[3 * i + 0] = paletteColors->red;
+            data[3 * i + 1] = paletteColors->green;
+            data[3 * i + 2] = paletteColors->blue;
+        }
+
+        info.ColorSpace.reset(new PdfColorSpaceIndexed(PdfColorSpaceFactory::GetDeviceRGBInstace(), colorCount, std::move(data)));
+        colors = 1;
+    }
+    else if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
     {
-        rows[y] = reinterpret_cast<png_bytep>(buffer.data() + y * rowLen);
+        info.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
+        colors = 1;
+    }
+    else
+    {
+        info.ColorSpace = PdfColorSpaceFactory::GetDeviceRGBInstace();
+        colors = 3;
     }
-
-    png_read_image(png, rows.get());
 
     png_bytep paletteTrans = nullptr;
     int numTransColors = 0;
-    if (color_type & PNG_COLOR_MASK_ALPHA
+    bool hasAlpha = color_type & PNG_COLOR_MASK_ALPHA
         || (color_type == PNG_COLOR_TYPE_PALETTE
             && png_get_valid(png, pnginfo, PNG_INFO_tRNS)
-            && png_get_tRNS(png, pnginfo, &paletteTrans, &numTransColors, NULL)))
+            && png_get_tRNS(png, pnginfo, &paletteTrans, &numTransColors, NULL));
+
+    // Interlaced images are decoded in multiple passes over
+    // the whole image, so only these are fully buffered.
+    // Other images are read and written one row at a time
+    size_t rowLen = png_get_rowbytes(png, pnginfo);
+    charbuff buffer;
+    unique_ptr<png_bytep[]> rows;
+    if (interlace == PNG_INTERLACE_NONE)
     {
-        // Handle alpha channel and create smask
-        charbuff smask((size_t)width * height);
-        png_uint_32 smaskIndex = 0;
-        if (color_type == PNG_COLOR_TYPE_PALETTE)
+        buffer.resize(rowLen);
+    }
+    else
+    {
+        buffer.resize(rowLen * height);
+        rows.reset(new png_bytep[height]);
+        for (unsigned int y = 0; y < height; y++)
+            rows[y] = reinterpret_cast<png_bytep>(buffer.data() + y * rowLen);
+
+        png_read_image(png, rows.get());
+    }
+
+    // The soft mask is Flate compressed in memory while the rows are
+    // read, and it's set after the image data is written
+    unique_ptr<PdfImage> smaskImage;
+    charbuff smaskData;
+    unique_ptr<OutputStream> smaskStream;
+    unique_ptr<utls::PngPredictorWriter> smaskWriter;
+    charbuff colorRow;
+    charbuff alphaRow;
+    if (hasAlpha)
+    {
+        smaskImage = image.GetDocument().CreateImage();
+        image.SetSoftMask(*smaskImage);
+        smaskStream = PdfFilterFactory::CreateEncodeStream(
+            std::make_shared<BufferStreamDevice>(smaskData), { PdfFilterType::FlateDecode });
+        smaskWriter.reset(new utls::PngPredictorWriter(*smaskStream, (unsigned)width, 1));
+        colorRow.resize((size_t)width * colors);
+        alphaRow.resize(width);
+    }
+
+    {
+        PdfImageRowWriter writer(image, info, colors);
+        for (png_uint_32 r = 0; r < height; r++)
         {
-            for (png_uint_32 r = 0; r < height; r++)
+            png_bytep row;
+            if (rows == nullptr)
             {
-                png_bytep row = rows[r];
-                for (png_uint_32 c = 0; c < width; c++)
-                {
-                    png_byte color;
-                    switch (depth)
-                    {
-                        case 8:
-                            color = row[c];
-                            break;
-                        case 4:
-                            color = c % 2 ? row[c / 2] >> 4 : row[c / 2] & 0xF;
-                            break;
-                        case 2:
-                            color = (row[c / 4] >> c % 4 * 2) & 3;
-                            break;
-                        case 1:
-                            color = (row[c / 4] >> c % 8) & 1;
-                            break;
-                        default:
-                            PODOFO_RAISE_ERROR(PdfErrorCode::InvalidEnumValue);
-                    }
+                row = reinterpret_cast<png_bytep>(buffer.data());
+                png_read_row(png, row, nullptr);
+            }
+            else
+            {
+                row = rows[r];
+            }
 
-                    smask[smaskIndex++] = color < numTransColors ? paletteTrans[color] : 0xFF;
-                }
+            if (!hasAlpha)
+            {
+                writer.WriteRow(row);
+                continue;
             }
-        }
-        else if (color_type == PNG_COLOR_TYPE_RGB_ALPHA)
-        {
-            for (png_uint_32 r = 0; r < height; r++)
+
+            // Handle alpha channel and split the smask
+            if (color_type == PNG_COLOR_TYPE_PALETTE)
             {
-                png_bytep row = rows[r];
+                unsigned colorMask = (1u << depth) - 1;
                 for (png_uint_32 c = 0; c < width; c++)
                 {
-                    memmove(buffer.data() + 3 * smaskIndex, row + 4 * c, 3); // 3 byte for rgb
-                    smask[smaskIndex++] = row[c * 4 + 3]; // 4th byte for alpha
+                    // Packed palette indices are stored most significant bits first
+                    unsigned bitOffset = c * depth;
+                    png_byte color = (png_byte)((row[bitOffset / 8] >> (8 - depth - bitOffset % 8)) & colorMask);
+                    alphaRow[c] = color < numTransColors ? paletteTrans[color] : 0xFF;
                 }
+
+                writer.WriteRow(row);
             }
-            len = 3 * (size_t)width * height;
-        }
-        else if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-        {
-            for (png_uint_32 r = 0; r < height; r++)
+            else
             {
-                png_bytep row = rows[r];
+                // The alpha is the last byte of each pixel
                 for (png_uint_32 c = 0; c < width; c++)
                 {
-                    buffer[smaskIndex] = row[c * 2]; // 1 byte for gray
-                    smask[smaskIndex++] = row[c * 2 + 1]; // 2nd byte for alpha
+                    memcpy(colorRow.data() + c * colors, row + c * (colors + 1), colors);
+                    alphaRow[c] = row[c * (colors + 1) + colors];
                 }
-            }
-            len = (size_t)width * height;
-        }
-        PdfImageInfo smaksInfo;
-        smaksInfo.Width = (unsigned)width;
-        smaksInfo.Height = (unsigned)height;
-        smaksInfo.BitsPerComponent = (unsigned char)depth;
-        smaksInfo.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
-
-        auto smakeImage = image.GetDocument().CreateImage();
-        smakeImage->SetDataRaw(smask, smaksInfo);
-        image.SetSoftMask(*smakeImage);
-    }
 
-    PdfImageInfo info;
-    info.Width = (unsigned)width;
-    info.Height = (unsigned)height;
-    info.BitsPerComponent = (unsigned char)depth;
-    // Set color space
-    if (color_type == PNG_COLOR_TYPE_PALETTE)
-    {
-        png_color* colors;
-        int colorCount;
-        png_get_PLTE(png, pnginfo, &colors, &colorCount);
+                writer.WriteRow((const unsigned char*)colorRow.data());
+            }
 
-        charbuff data(colorCount * 3);
-        for (int i = 0; i < colorCount; i++, colors++)
-        {
-            data[3 * i + 0] = colors->red;
-            data[3 * i + 1] = colors->green;
-            data[3 * i + 2] = colors->blue;
+            smaskWriter->WriteRow((const unsigned char*)alphaRow.data());
         }
-
-        info.ColorSpace.reset(new PdfColorSpaceIndexed(PdfColorSpaceFactory::GetDeviceRGBInstace(), colorCount, std::move(data)));
     }
-    else if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-    {
-        info.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
-    }
-    else
+
+    if (hasAlpha)
     {
-        info.ColorSpace = PdfColorSpaceFactory::GetDeviceRGBInstace();
+        // Dispose the encoder to flush the compressed data
+        smaskWriter = nullptr;
+        smaskStream = nullptr;
+
+        PdfImageInfo smaskInfo;
+        smaskInfo.Width = (unsigned)width;
+        smaskInfo.Height = (unsigned)height;
+        smaskInfo.BitsPerComponent = 8;
+        smaskInfo.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
+        smaskInfo.Filters = { PdfFilterType::FlateDecode };
+        smaskImage->GetDictionary().AddKey("DecodeParms",
+            utls::CreatePngPredictorParms(1, 8, (unsigned)width));
+        smaskImage->SetDataRaw(smaskData, smaskInfo);
     }
-
-    // Set the image data and flate compress it
-    image.SetDataRaw(buffer, info);
 }
 
 void createPngContext(png_structp& png, png_infop& pnginfo)
@@ -1255,7 +1444,48 @@ unsigned PdfImage::GetHeight() const
     return m_Height;
 }
 
+unsigned PdfImage::GetScaledWidth(PdfImageScale scale) const
+{
+    return getScaledSize(m_Width, (unsigned)scale);
+}
+
+unsigned PdfImage::GetScaledHeight(PdfImageScale scale) const
+{
+    return getScaledSize(m_Height, (unsigned)scale);
+}
+
 unsigned PdfImage::getBufferSize(PdfPixelFormat format) const
+{
+    return getScanLineSize(format, m_Width) * m_Height;
+}
+
+void fetchPDFScanLineRGB(unsigned char* dstScanLine, unsigned width, const unsigned char* srcScanLine, PdfPixelFormat srcPixelFormat)
+{
+    static const signed char BGR[] = { 2, 1, 0 };
+    static const signed char ABGR[] = { 3, 2, 1 };
+    switch (srcPixelFormat)
+    {
+        case PdfPixelFormat::BGR24:
+        {
+            utls::ConvertScanLine(dstScanLine, 3, srcScanLine, 3, BGR, width);
+            break;
+        }
+        case PdfPixelFormat::BGRA:
+        {
+            utls::ConvertScanLine(dstScanLine, 3, srcScanLine, 4, BGR, width);
+            break;
+        }
+        case PdfPixelFormat::ABGR:
+        {
+            utls::ConvertScanLine(dstScanLine, 3, srcScanLine, 4, ABGR, width);
+            break;
+        }
+        default:
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
+    }
+}
+
+unsigned getPixelSize(PdfPixelFormat format)
 {
     switch (format)
     {
@@ -1263,43 +1493,117 @@ unsigned PdfImage::getBufferSize(PdfPixelFormat format) const
         case PdfPixelFormat::BGRA:
         case PdfPixelFormat::ARGB:
         case PdfPixelFormat::ABGR:
-            return 4 * m_Width * m_Height;
+            return 4;
         case PdfPixelFormat::RGB24:
         case PdfPixelFormat::BGR24:
-            return 4 * ((3 * m_Width + 3) / 4) * m_Height;
+            return 3;
         case PdfPixelFormat::Grayscale:
-            return 4 * ((m_Width + 3) / 4) * m_Height;
+            return 1;
         default:
             PODOFO_RAISE_ERROR(PdfErrorCode::InvalidEnumValue);
     }
 }
 
-void fetchPDFScanLineRGB(unsigned char* dstScanLine, unsigned width, const unsigned char* srcScanLine, PdfPixelFormat srcPixelFormat)
+unsigned getScanLineSize(PdfPixelFormat format, unsigned width)
 {
-    switch (srcPixelFormat)
+    // Scan lines are padded to 4 bytes
+    return 4 * ((getPixelSize(format) * width + 3) / 4);
+}
+
+unsigned getScaledSize(unsigned size, unsigned scaleDenom)
+{
+    // Same rounding used by libjpeg for scaled output
+    return (size + scaleDenom - 1) / scaleDenom;
+}
+
+charbuff subsampleMask(const charbuff& smaskData, unsigned width, unsigned height, unsigned scaleDenom)
+{
+    unsigned scaledWidth = getScaledSize(width, scaleDenom);
+    unsigned scaledHeight = getScaledSize(height, scaleDenom);
+    charbuff ret((size_t)scaledWidth * scaledHeight);
+    for (unsigned i = 0; i < scaledHeight; i++)
     {
-        case PdfPixelFormat::BGR24:
-        case PdfPixelFormat::BGRA:
+        auto srcLine = smaskData.data() + (size_t)i * scaleDenom * width;
+        auto dstLine = ret.data() + (size_t)i * scaledWidth;
+        for (unsigned j = 0; j < scaledWidth; j++)
+            dstLine[j] = srcLine[j * scaleDenom];
+    }
+
+    return ret;
+}
+
+bool isPlainJpegDecode(const PdfObject* decodeObj, const bufferview& jpeg)
+{
+    if (decodeObj == nullptr)
+        return true;
+
+    // Accept only the inverted /Decode array written for Adobe
+    // CMYK JPEG images, that JPEG decoders handle natively. The
+    // inversion is implied only when the Adobe marker is present
+    if (!hasAdobeMarker(jpeg))
+        return false;
+
+    const PdfArray* decodeArr;
+    if (!decodeObj->TryGetArray(decodeArr) || decodeArr->GetSize() != 8)
+        return false;
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        double value;
+        if (!(*decodeArr)[i].TryGetReal(value) || value != (i % 2 == 0 ? 1 : 0))
+            return false;
+    }
+
+    return true;
+}
+
+bool hasAdobeMarker(const bufferview& jpeg)
+{
+    // Walk the marker segments up to the start of scan,
+    // looking for an APP14 segment with the "Adobe" identifier
+    auto data = (const unsigned char*)jpeg.data();
+    if (jpeg.size() < 2 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+
+    size_t offset = 2;
+    while (offset + 4 <= jpeg.size())
+    {
+        if (data[offset] != 0xFF)
+            return false;
+
+        unsigned char marker = data[offset + 1];
+        if (marker == 0xFF)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * 3 + 2];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * 3 + 1];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * 3 + 0];
-            }
-            break;
+            // Fill byte
+            offset++;
+            continue;
         }
-        case PdfPixelFormat::ABGR:
+
+        if (marker == 0xDA || marker == 0xD9)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * 3 + 3];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * 3 + 2];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * 3 + 1];
-            }
-            break;
+            // Start of scan or end of image
+            return false;
         }
-        default:
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
+
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            // Markers without a length
+            offset += 2;
+            continue;
+        }
+
+        size_t length = (size_t)(data[offset + 2] << 8 | data[offset + 3]);
+        if (length < 2 || offset + 2 + length > jpeg.size())
+            return false;
+
+        if (marker == 0xEE && length >= 7
+            && std::memcmp(data + offset + 4, "Adobe", 5) == 0)
+        {
+            return true;
+        }
+
+        offset += 2 + length;
     }
+
+    return false;
 }
@@ -31,6 +31,40 @@ struct PdfImageInfo
     std::vector<double> DecodeArray;
 };
 
+/** Parameters for PdfDocument::OptimizeImages
+ */
+struct PdfImageOptimizeParams
+{
+    /** Images displayed with an effective resolution, in DPI,
+     * higher than this are downsampled
+     */
+    double MaxResolution = 225;
+    /** The resolution, in DPI, oversized images are downsampled to
+     */
+    double TargetResolution = 150;
+    /** Allow encoding photographic images with JPEG. When false
+     * all images are encoded with Flate and PNG predictors
+     */
+    bool AllowJpeg = true;
+    /** The JPEG quality, in range [0, 1]
+     */
+    double JpegQuality = 0.8;
+    /** The number of threads used to decode and encode the images.
+     * 0 means hardware concurrency, 1 (default) means serial processing
+     */
+    unsigned ThreadCount = 1;
+};
+
+/** Downscale factor for PdfImage::DecodeScaledTo
+ */
+enum class PdfImageScale : uint8_t
+{
+    Full = 1,       ///< Decode at full resolution
+    Half = 2,       ///< Decode at 1/2 of the size
+    Quarter = 4,    ///< Decode at 1/4 of the size
+    Eighth = 8,     ///< Decode at 1/8 of the size
+};
+
 /** A PdfImage object is needed when ever you want to embedd an image
  *  file into a PDF document.
  *  The PdfImage object is embedded once and can be drawn as often
@@ -43,6 +77,7 @@ class PODOFO_API PdfImage final : public PdfXObject
 {
     friend class PdfXObject;
     friend class PdfDocument;
+    friend class PdfImageRowWriter;
 
 private:
     /** Constuct a new PdfImage object
@@ -58,6 +93,28 @@ public:
     void DecodeTo(const bufferspan& buff, PdfPixelFormat format, int scanLineSize = -1) const;
     void DecodeTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize = -1) const;
 
+    /** Decode the image downscaled by the given factor
+     *
+     * The output image is GetScaledWidth(scale) x GetScaledHeight(scale)
+     * pixels. DCTDecode images are scaled by libjpeg directly in the
+     * DCT domain, which costs a fraction of a full decode. Other
+     * images are decoded at full resolution and then subsampled
+     */
+    void DecodeScaledTo(charbuff& buff, PdfPixelFormat format, PdfImageScale scale, int scanLineSize = -1) const;
+    void DecodeScaledTo(OutputStream& stream, PdfPixelFormat format, PdfImageScale scale, int scanLineSize = -1) const;
+
+    /** Try to get the encoded JPEG data of the image, unchanged
+     *
+     * This succeeds only when the DCTDecode filter is the only
+     * image filter and the JPEG data can be used as it is, without
+     * a /Decode transform. The inverted /Decode array of Adobe CMYK
+     * JPEG images is accepted only if the data has the Adobe APP14
+     * marker. Other non image filters, eg. FlateDecode, are still decoded
+     * \remarks the /SMask of the image, if any, is not included
+     * \returns true if the image data is a JPEG that can be used as it is
+     */
+    bool TryGetRawJpegData(charbuff& buff) const;
+
     charbuff GetDecodedCopy(PdfPixelFormat format);
 
     /** Set an ICC profile for this image.
@@ -87,6 +144,14 @@ public:
      */
     unsigned GetHeight() const;
 
+    /** Get the width in pixels of the image decoded with the given scale
+     */
+    unsigned GetScaledWidth(PdfImageScale scale) const;
+
+    /** Get the height in pixels of the image decoded with the given scale
+     */
+    unsigned GetScaledHeight(PdfImageScale scale) const;
+
     /** Set the actual image data from a buffer
      *
      *  \param buffer buffer supplying image data
@@ -132,6 +197,12 @@ public:
      */
     void LoadFromBuffer(const bufferview& buffer);
 
+    /** Export the image to the given format
+     * \param args for PdfExportFormat::Jpeg the first argument is the quality in
+     *     range [0, 1]. When it's not specified and the image is already a plain
+     *     JPEG the encoded data is exported as it is, without recompression
+     * \see TryGetRawJpegData
+     */
     void ExportTo(charbuff& buff, PdfExportFormat format, PdfArray args = {}) const;
 
     /** Set an color/chroma-key mask on an image.
@@ -166,7 +237,10 @@ private:
      */
     PdfImage(PdfObject& obj);
 
+    void decodeTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize, unsigned scaleDenom) const;
+    void decodeSubsampledTo(OutputStream& stream, PdfPixelFormat format, int scanLineSize, unsigned scaleDenom) const;
     unsigned getBufferSize(PdfPixelFormat format) const;
+    void setImageInfo(const PdfImageInfo& info);
 
 #ifdef PODOFO_HAVE_JPEG_LIB
     void loadFromJpegInfo(jpeg_decompress_struct& ctx, PdfImageInfo& info);
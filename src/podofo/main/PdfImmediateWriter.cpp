@@ -9,6 +9,7 @@
 
 #include "PdfStreamedObjectStream.h"
 #include "PdfMemoryObjectStream.h"
+#include "PdfDictionary.h"
 #include "PdfObject.h"
 #include "PdfXRefStream.h"
 
@@ -33,8 +34,10 @@ PdfImmediateWriter::PdfImmediateWriter(PdfIndirectObjectList& objects, const Pdf
     // Setup encryption
     if (encrypt != nullptr)
     {
-        this->SetEncrypt(*encrypt);
+        // NOTE: Generate the key before setting the encrypt,
+        // since the writer stores a copy of it
         encrypt->GenerateEncryptionKey(GetIdentifier());
+        this->SetEncrypt(*encrypt);
     }
 
     // Start with writing the header
@@ -74,6 +77,32 @@ void PdfImmediateWriter::finish()
     m_xRef->Write(*m_Device, m_buffer);
 }
 
+void PdfImmediateWriter::WriteObjects(const vector<PdfObject*>& objects)
+{
+    PODOFO_ASSERT(!m_OpenStream);
+    auto encrypt = GetEncrypt();
+    for (auto obj : objects)
+    {
+        if (obj->HasStream())
+        {
+            // The stream object itself is kept until
+            // the end, as all the written objects
+            auto lengthObj = obj->GetDictionary().GetKey(PdfName::KeyLength);
+            if (lengthObj == nullptr || !lengthObj->IsReference()
+                || (obj = GetObjects().GetObject(lengthObj->GetReference())) == nullptr)
+            {
+                continue;
+            }
+        }
+
+        m_xRef->AddInUseObject(obj->GetIndirectReference(), m_Device->GetPosition());
+        obj->WriteFinal(*m_Device, this->GetWriteFlags(), encrypt, m_buffer);
+        (void)GetObjects().RemoveObject(obj->GetIndirectReference(), false);
+    }
+
+    m_Device->Flush();
+}
+
 unique_ptr<PdfObjectStreamProvider> PdfImmediateWriter::CreateStream()
 {
     return unique_ptr<PdfObjectStreamProvider>(new PdfStreamedObjectStream(*m_Device));
@@ -121,8 +150,9 @@ void PdfImmediateWriter::BeginAppendStream(PdfObjectStream& stream)
 
 void PdfImmediateWriter::EndAppendStream(PdfObjectStream& stream)
 {
-    (void)stream;
     PODOFO_ASSERT(m_OpenStream);
+    auto& streamedObjectStream = dynamic_cast<PdfStreamedObjectStream&>(stream.GetProvider());
+    streamedObjectStream.FinishOutput();
     m_Device->Write("\nendstream\nendobj\n");
     m_Device->Flush();
     m_OpenStream = false;
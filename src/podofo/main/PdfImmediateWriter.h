@@ -24,6 +24,8 @@ class PODOFO_API PdfImmediateWriter final : private PdfWriter,
     private PdfIndirectObjectList::Observer,
     private PdfIndirectObjectList::StreamFactory
 {
+    friend class PdfStreamedDocument;
+
 public:
     /** Create a new PdfWriter that writes objects with streams immediately to an OutputStreamDevice
      *
@@ -51,6 +53,14 @@ public:
 public:
     PdfVersion GetPdfVersion() const;
 
+private:
+    /** Write the given objects immediately and remove them from
+     *  the object list. Objects with streams are already written,
+     *  and their /Length object is written instead
+     *  \remarks The objects must not be modified anymore
+     */
+    void WriteObjects(const std::vector<PdfObject*>& objects);
+
 private:
     void finish();
     void BeginAppendStream(PdfObjectStream& stream) override;
@@ -16,6 +16,7 @@
 #include "PdfReference.h"
 #include "PdfObjectStream.h"
 #include "PdfDocument.h"
+#include "PdfParserObject.h"
 
 using namespace std;
 using namespace PoDoFo;
@@ -41,6 +42,44 @@ public:
     }
 };
 
+// An object lazily copied from the same object of a forked list
+// \remarks The source object must be already loaded, so copying
+// it only reads it and can be done concurrently with other reads
+class ForkedObject final : public PdfObject
+{
+public:
+    ForkedObject(PdfDocument& doc, const PdfObject& source)
+        : PdfObject(PdfVariant(), source.GetIndirectReference(), false),
+        m_source(&source)
+    {
+        SetDocument(&doc);
+        EnableDelayedLoading();
+        EnableDelayedLoadingStream();
+    }
+
+protected:
+    void DelayedLoadImpl() override
+    {
+        m_Variant = m_source->GetVariant();
+    }
+
+    void DelayedLoadStreamImpl() override
+    {
+        auto stream = m_source->GetStream();
+        if (stream == nullptr)
+            return;
+
+        // Copying the stream is not a modification
+        bool dirty = IsDirty();
+        getOrCreateStream() = *stream;
+        if (!dirty)
+            resetDirty();
+    }
+
+private:
+    const PdfObject* m_source;
+};
+
 //RG: 1) Should this class not be moved to the header file
 class ObjectsComparator
 {
@@ -287,7 +326,7 @@ void PdfIndirectObjectList::AddFreeObject(const PdfReference& reference)
     if (it.first != it.second && !m_FreeObjects.empty())
     {
         // Be sure that no reference is added twice to free list
-        PoDoFo::LogMessage(PdfLogSeverity::Debug, "Adding {} to free list, is already contained in it!", reference.ObjectNumber());
+        PODOFO_LOG(PdfLogSeverity::Debug, "Adding {} to free list, is already contained in it!", reference.ObjectNumber());
         return;
     }
     else
@@ -312,6 +351,43 @@ void PdfIndirectObjectList::addNewObject(PdfObject* obj)
     PushObject(obj);
 }
 
+void PdfIndirectObjectList::Fork(const PdfIndirectObjectList& rhs, const shared_ptr<PdfEncrypt>& encrypt)
+{
+    PODOFO_ASSERT(m_Objects.size() == 0);
+    m_CanReuseObjectNumbers = rhs.m_CanReuseObjectNumbers;
+    m_ObjectCount = rhs.m_ObjectCount;
+    m_FreeObjects = rhs.m_FreeObjects;
+    m_unavailableObjects = rhs.m_unavailableObjects;
+    m_objectStreams = rhs.m_objectStreams;
+
+    // NOTE: Objects are iterated in order, so
+    // they can be always inserted at the end
+    PdfObject* forked;
+    for (auto obj : rhs.m_Objects)
+    {
+        auto parserObj = dynamic_cast<const PdfParserObject*>(obj);
+        if (parserObj != nullptr && !parserObj->IsDelayedLoadDone())
+        {
+            // Objects not yet loaded are parsed again by the fork,
+            // so the source objects are never loaded by the forks
+            auto newObj = new PdfParserObject(*m_Document, obj->GetIndirectReference(),
+                *parserObj->m_device, (ssize_t)parserObj->GetOffset());
+            if (parserObj->m_Encrypt != nullptr)
+                newObj->SetEncrypt(encrypt);
+
+            forked = newObj;
+        }
+        else
+        {
+            // Load the stream now, so the forks only read the source object
+            (void)obj->GetStream();
+            forked = new ForkedObject(*m_Document, *obj);
+        }
+
+        m_Objects.insert(m_Objects.end(), forked);
+    }
+}
+
 void PdfIndirectObjectList::PushObject(PdfObject* obj)
 {
     obj->SetDocument(m_Document);
@@ -14,6 +14,7 @@
 namespace PoDoFo {
 
 class PdfObjectStreamProvider;
+class PdfEncrypt;
 using ReferenceList = std::deque<PdfReference>;
 
 /** A list of PdfObjects that constitutes the indirect object list
@@ -35,6 +36,7 @@ class PODOFO_API PdfIndirectObjectList final
     friend class PdfParser;
     friend class PdfObjectStreamParser;
     friend class PdfImmediateWriter;
+    friend class PdfMemDocument;
 
 private:
     // Comparator to enable heterogeneous lookup with
@@ -315,6 +317,14 @@ private:
      */
     void CollectGarbage();
 
+    /** Fill this empty list with objects that are copied from
+     *  the same objects of the given list when first accessed.
+     *  The objects of the given list not yet loaded are parsed
+     *  again from the input device instead
+     *  \param encrypt the encryption of the objects parsed again
+     */
+    void Fork(const PdfIndirectObjectList& rhs, const std::shared_ptr<PdfEncrypt>& encrypt);
+
 private:
     void pushObject(const ObjectList::const_iterator& hintpos, ObjectList::node_type& node, PdfObject* obj);
 
@@ -80,6 +80,7 @@ void PdfMemDocument::clear()
     m_PrevXRefOffset = -1;
     m_Encrypt = nullptr;
     m_device = nullptr;
+    m_deviceMutex = nullptr;
 }
 
 void PdfMemDocument::initFromParser(PdfParser& parser)
@@ -140,6 +141,7 @@ void PdfMemDocument::LoadFromDevice(const shared_ptr<InputStreamDevice>& device,
 void PdfMemDocument::loadFromDevice(const shared_ptr<InputStreamDevice>& device, const string_view& password)
 {
     m_device = device;
+    m_deviceMutex = std::make_shared<recursive_mutex>();
 
     // Call parse file instead of using the constructor
     // so that m_Parser is initialized for encrypted documents
@@ -149,6 +151,24 @@ void PdfMemDocument::loadFromDevice(const shared_ptr<InputStreamDevice>& device,
     initFromParser(parser);
 }
 
+unique_ptr<PdfMemDocument> PdfMemDocument::Fork() const
+{
+    unique_ptr<PdfMemDocument> ret(new PdfMemDocument(true));
+    ret->m_Version = m_Version;
+    ret->m_InitialVersion = m_InitialVersion;
+    ret->m_HasXRefStream = m_HasXRefStream;
+    ret->m_PrevXRefOffset = m_PrevXRefOffset;
+    if (m_Encrypt != nullptr)
+        ret->m_Encrypt = PdfEncrypt::CreateFromEncrypt(*m_Encrypt);
+
+    ret->m_device = m_device;
+    ret->m_deviceMutex = m_deviceMutex;
+    ret->GetObjects().Fork(GetObjects(), ret->m_Encrypt);
+    ret->SetTrailer(std::make_unique<PdfObject>(GetTrailer().GetObject()));
+    ret->Init();
+    return ret;
+}
+
 void PdfMemDocument::AddPdfExtension(const PdfName& ns, int64_t level)
 {
     if (!this->HasPdfExtension(ns, level))
@@ -346,6 +366,19 @@ void PdfMemDocument::FreeObjectMemory(PdfObject* obj, bool force)
     parserObject->FreeObjectMemory(force);
 }
 
+void PdfMemDocument::LoadStreams(unsigned threadCount)
+{
+    vector<PdfParserObject*> objects;
+    for (auto obj : GetObjects())
+    {
+        auto parserObject = dynamic_cast<PdfParserObject*>(obj);
+        if (parserObject != nullptr)
+            objects.push_back(parserObject);
+    }
+
+    PdfParserObject::ParseStreams(objects, threadCount);
+}
+
 const PdfEncrypt* PdfMemDocument::GetEncrypt() const
 {
     return m_Encrypt.get();
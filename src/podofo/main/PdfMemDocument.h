@@ -7,6 +7,8 @@
 #ifndef PDF_MEM_DOCUMENT_H
 #define PDF_MEM_DOCUMENT_H
 
+#include <mutex>
+
 #include "PdfDocument.h"
 #include "PdfExtension.h"
 #include <podofo/auxiliary/InputDevice.h>
@@ -37,6 +39,7 @@ class PdfWriter;
 class PODOFO_API PdfMemDocument final : public PdfDocument
 {
     friend class PdfWriter;
+    friend class PdfParserObject;
 
 public:
     /** Construct a new PdfMemDocument
@@ -214,6 +217,39 @@ public:
      */
     void FreeObjectMemory(PdfObject* obj, bool force = false);
 
+    /** Load all the streams of the document that are not loaded yet
+     *
+     *  The raw stream data is read serially from the input device,
+     *  while the streams of encrypted documents are decrypted concurrently.
+     *  It's useful to pay the decryption cost upfront when most of
+     *  the streams of a loaded document will be accessed
+     *
+     *  \param threadCount number of threads used to decrypt the streams.
+     *      0 (default) means hardware concurrency, 1 means serial decryption
+     */
+    void LoadStreams(unsigned threadCount = 0);
+
+    /** Create a lightweight fork of this document
+     *
+     *  The loaded objects of the fork are copied from this document
+     *  only when first accessed, together with their streams, while
+     *  the objects not yet loaded are parsed by the fork from the
+     *  input device. Producing many variants of a template document
+     *  then costs in proportion to the objects each variant reads or
+     *  edits, rather than to the size of the template. Forks keep the
+     *  template incremental update state, so SaveUpdate() only writes
+     *  the edited objects
+     *
+     *  \remarks This document must outlive its forks and must not be
+     *  modified while forks exist, but it can be read concurrently
+     *  with them. The reads from the shared input device are
+     *  serialized, and each fork decrypts with its own copy of the
+     *  encryption. Fork() itself must not run concurrently with other
+     *  accesses to this document, as it loads the streams of the
+     *  objects already loaded
+     */
+    std::unique_ptr<PdfMemDocument> Fork() const;
+
     const PdfEncrypt* GetEncrypt() const override;
 
 protected:
@@ -254,6 +290,8 @@ private:
     int64_t m_PrevXRefOffset;
     std::shared_ptr<PdfEncrypt> m_Encrypt;
     std::shared_ptr<InputStreamDevice> m_device;
+    // Serializes the reads from the input device, shared with the forks
+    std::shared_ptr<std::recursive_mutex> m_deviceMutex;
 };
 
 };
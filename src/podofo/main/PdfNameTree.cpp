@@ -352,7 +352,7 @@ PdfObject* PdfNameTree::GetKeyValue(PdfObject& obj, const PdfString& key) const
             auto childObj = this->GetObject().GetDocument()->GetObjects().GetObject(child.GetReference());
             if (childObj == nullptr)
             {
-                PoDoFo::LogMessage(PdfLogSeverity::Debug, "Object {} {} R is child of nametree but was not found!",
+                PODOFO_LOG(PdfLogSeverity::Debug, "Object {} {} R is child of nametree but was not found!",
                     child.GetReference().ObjectNumber(),
                     child.GetReference().GenerationNumber());
             }
@@ -426,7 +426,7 @@ PdfNameLimits PdfNameTree::CheckLimits(const PdfObject& obj, const PdfString& ke
     }
     else
     {
-        PoDoFo::LogMessage(PdfLogSeverity::Debug, "Name tree object {} {} R does not have a limits key!",
+        PODOFO_LOG(PdfLogSeverity::Debug, "Name tree object {} {} R does not have a limits key!",
             obj.GetIndirectReference().ObjectNumber(),
             obj.GetIndirectReference().GenerationNumber());
     }
@@ -453,7 +453,7 @@ void PdfNameTree::AddToDictionary(PdfObject& obj, PdfDictionary& dict)
             auto childObj = this->GetObject().GetDocument()->GetObjects().GetObject(child.GetReference());
             if (childObj == nullptr)
             {
-                PoDoFo::LogMessage(PdfLogSeverity::Debug, "Object {} {} R is child of nametree but was not found!",
+                PODOFO_LOG(PdfLogSeverity::Debug, "Object {} {} R is child of nametree but was not found!",
                     child.GetReference().ObjectNumber(),
                     child.GetReference().GenerationNumber());
             }
@@ -477,7 +477,7 @@ void PdfNameTree::AddToDictionary(PdfObject& obj, PdfDictionary& dict)
             it++;
             if (it == names.end())
             {
-                PoDoFo::LogMessage(PdfLogSeverity::Warning,
+                PODOFO_LOG(PdfLogSeverity::Warning,
                     "No reference in /Names array last element in "
                     "object {} {} R, possible exploit attempt!",
                     obj.GetIndirectReference().ObjectNumber(),
@@ -18,7 +18,9 @@
 using namespace std;
 using namespace PoDoFo;
 
-PdfObject PdfObject::Null = PdfVariant::Null;
+// NOTE: Don't initialize from PdfVariant::Null, which
+// may be not initialized yet in this translation unit
+PdfObject PdfObject::Null = PdfVariant();
 
 PdfObject::PdfObject()
     : PdfObject(PdfDictionary(), PdfReference(), false) { }
@@ -416,6 +416,12 @@ public:
      */
     inline bool IsDelayedLoadDone() const { return m_IsDelayedLoadDone; }
 
+    /**
+     * Returns true if delayed loading of the stream is disabled, or
+     * if it is enabled and loading has completed
+     */
+    inline bool IsDelayedLoadStreamDone() const { return m_IsDelayedLoadStreamDone; }
+
     const PdfObjectStream* GetStream() const;
     PdfObjectStream* GetStream();
 
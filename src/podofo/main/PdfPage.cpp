@@ -14,11 +14,14 @@
 #include "PdfColor.h"
 #include "PdfDocument.h"
 #include "PdfPageCollection.h"
+#include "PdfPainter.h"
 
 using namespace std;
 using namespace PoDoFo;
 
 static int normalize(int value, int start, int end);
+static PdfObject* getNormalAppearance(PdfAnnotation& annot);
+static void drawAppearance(PdfPainter& painter, const PdfAnnotation& annot, const PdfXObjectForm& form);
 
 PdfPage::PdfPage(PdfDocument& parent, const Rect& size) :
     PdfDictionaryElement(parent, "Page"),
@@ -342,6 +345,74 @@ void PdfPage::FlattenStructure()
     m_parents.clear();
 }
 
+void PdfPage::flattenAnnotations(PdfFlattenFlags flags)
+{
+    if (m_Annotations.GetCount() == 0)
+        return;
+
+    // Draw all the appearances with a single painter, so the
+    // page contents are appended once, then remove all the
+    // flattened annotations at once
+    PdfPainter painter;
+    vector<unsigned> removedIndices;
+    unordered_set<PdfReference> removedRefs;
+    for (unsigned i = 0; i < m_Annotations.m_Annots.size(); i++)
+    {
+        auto annot = m_Annotations.m_Annots[i].get();
+        // The annotation may be invalid
+        if (annot == nullptr)
+            continue;
+
+        bool isWidget = annot->GetType() == PdfAnnotationType::Widget;
+        if ((!isWidget && (flags & PdfFlattenFlags::WidgetsOnly) != PdfFlattenFlags::None)
+            || annot->GetType() == PdfAnnotationType::Popup)
+        {
+            // Popups are removed together with their parent below
+            continue;
+        }
+
+        if ((annot->GetFlags() & (PdfAnnotationFlags::Hidden | PdfAnnotationFlags::NoView)) == PdfAnnotationFlags::None)
+        {
+            auto appearance = getNormalAppearance(*annot);
+            if (appearance != nullptr)
+            {
+                // NOTE: Appearance streams often miss the /Type key,
+                // so they are not accepted by PdfXObject::TryCreateFromObject()
+                PdfXObjectForm form(*appearance);
+                if (painter.GetCanvas() == nullptr)
+                    painter.SetCanvas(*this);
+
+                drawAppearance(painter, *annot, form);
+            }
+            else if (!isWidget)
+            {
+                // Keep the annotations that can't be drawn. Widgets
+                // are removed anyway, together with their fields
+                continue;
+            }
+        }
+
+        removedIndices.push_back(i);
+        removedRefs.insert(annot->GetObject().GetIndirectReference());
+    }
+
+    painter.FinishDrawing();
+
+    for (unsigned i = 0; i < m_Annotations.m_Annots.size(); i++)
+    {
+        auto annot = m_Annotations.m_Annots[i].get();
+        if (annot == nullptr || annot->GetType() != PdfAnnotationType::Popup)
+            continue;
+
+        auto parent = annot->GetDictionary().FindKey("Parent");
+        if (parent != nullptr && removedRefs.find(parent->GetIndirectReference()) != removedRefs.end())
+            removedIndices.push_back(i);
+    }
+
+    std::sort(removedIndices.begin(), removedIndices.end());
+    m_Annotations.removeAnnotsAt(removedIndices);
+}
+
 void PdfPage::EnsureResourcesCreated()
 {
     ensureResourcesCreated();
@@ -601,3 +672,61 @@ int normalize(int value, int start, int end)
     // + start to reset back to start of original range
     return offsetValue - (offsetValue / width) * width + start;
 }
+
+// Get the normal appearance of the annotation, selecting
+// the current state when it has many
+PdfObject* getNormalAppearance(PdfAnnotation& annot)
+{
+    auto obj = annot.GetAppearanceStream(PdfAppearanceType::Normal);
+    if (obj == nullptr)
+        return nullptr;
+
+    if (!obj->HasStream())
+    {
+        const PdfName* state;
+        auto stateObj = annot.GetDictionary().FindKey("AS");
+        if (stateObj == nullptr || !stateObj->TryGetName(state)
+            || (obj = annot.GetAppearanceStream(PdfAppearanceType::Normal, *state)) == nullptr
+            || !obj->HasStream())
+        {
+            return nullptr;
+        }
+    }
+
+    return obj;
+}
+
+// ISO 32000-2:2020 12.5.5 "Appearance streams": the form bounding box,
+// transformed by the form matrix, is mapped to the annotation rectangle.
+// The form matrix is then applied by the "Do" operator itself
+void drawAppearance(PdfPainter& painter, const PdfAnnotation& annot, const PdfXObjectForm& form)
+{
+    auto bbox = form.GetRect();
+    if (bbox.Width == 0 || bbox.Height == 0)
+        return;
+
+    auto matrix = form.GetMatrix();
+    Vector2 corners[] = {
+        Vector2(bbox.X, bbox.Y) * matrix,
+        Vector2(bbox.GetRight(), bbox.Y) * matrix,
+        Vector2(bbox.X, bbox.GetTop()) * matrix,
+        Vector2(bbox.GetRight(), bbox.GetTop()) * matrix,
+    };
+
+    double left = corners[0].X;
+    double bottom = corners[0].Y;
+    double right = corners[0].X;
+    double top = corners[0].Y;
+    for (unsigned i = 1; i < std::size(corners); i++)
+    {
+        left = std::min(left, corners[i].X);
+        bottom = std::min(bottom, corners[i].Y);
+        right = std::max(right, corners[i].X);
+        top = std::max(top, corners[i].Y);
+    }
+
+    auto rect = annot.GetRectRaw();
+    double scaleX = rect.Width / (right - left);
+    double scaleY = rect.Height / (top - bottom);
+    painter.DrawXObject(form, rect.X - left * scaleX, rect.Y - bottom * scaleY, scaleX, scaleY);
+}
@@ -23,6 +23,8 @@ class PdfDocument;
 class PdfDictionary;
 class PdfIndirectObjectList;
 class InputStream;
+class PdfTextExtractSession;
+class PdfFont;
 
 struct PdfTextEntry final
 {
@@ -32,12 +34,25 @@ struct PdfTextEntry final
     double Y;
     double Length;
     nullable<Rect> BoundingBox;
+    const PdfFont* Font = nullptr;  ///< The font active at the beginning of the entry, if available
+    double FontSize = 0;
 };
 
+/** Handler receiving each text entry as soon as it is finalized
+ */
+using PdfTextEntryHandler = std::function<void(PdfTextEntry&& entry)>;
+
 struct PdfTextExtractParams
 {
     nullable<Rect> ClipRect;
     PdfTextExtractFlags Flags;
+    /** Regions, in page raw coordinates as ClipRect, to restrict
+     * the extraction to. Text strings whose bounding box doesn't
+     * intersect any of the regions are skipped without being decoded
+     * \remarks Text outside the regions may split entries that
+     * would be otherwise extracted as one
+     */
+    std::vector<Rect> ClipRegions;
 };
 
 /** PdfPage is one page in the pdf document.
@@ -49,6 +64,7 @@ class PODOFO_API PdfPage final : public PdfDictionaryElement, public PdfCanvas
     PODOFO_UNIT_TEST(PdfPageTest);
     friend class PdfPageCollection;
     friend class PdfDocument;
+    friend class PdfTextExtractSession;
 
 private:
     /** Create a new PdfPage object.
@@ -76,6 +92,14 @@ public:
         const std::string_view& pattern = { },
         const PdfTextExtractParams& params = { }) const;
 
+    /** Extract text pushing each entry to the given handler
+     * as soon as it is finalized, without accumulating
+     * the entries of the whole page
+     */
+    void ExtractTextTo(const PdfTextEntryHandler& handler,
+        const std::string_view& pattern = { },
+        const PdfTextExtractParams& params = { }) const;
+
     Rect GetRect() const;
 
     Rect GetRectRaw() const override;
@@ -217,6 +241,8 @@ public:
 private:
     // To be called by PdfPageCollection
     void FlattenStructure();
+    // To be called by PdfDocument
+    void flattenAnnotations(PdfFlattenFlags flags);
     void SetIndex(unsigned index) { m_Index = index; }
 
     void EnsureResourcesCreated() override;
@@ -254,6 +280,9 @@ private:
 
     void setPageBox(const std::string_view& inBox, const Rect& rect, bool raw);
 
+    void extractTextTo(const PdfTextEntryHandler& handler, const std::string_view& pattern,
+        const PdfTextExtractParams& params, PdfTextExtractSession* session) const;
+
 private:
     PdfElement& GetElement() = delete;
     const PdfElement& GetElement() const = delete;
@@ -160,19 +160,21 @@ void PdfPageCollection::CreatePagesAt(unsigned atIndex, unsigned count, const Re
     InsertPagesAt(atIndex, pages);
 }
 
-void PdfPageCollection::AppendDocumentPages(const PdfDocument& doc)
+void PdfPageCollection::AppendDocumentPages(const PdfDocument& doc, PdfImportFlags flags)
 {
-    return GetDocument().AppendDocumentPages(doc);
+    return GetDocument().AppendDocumentPages(doc, flags);
 }
 
-void PdfPageCollection::AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount)
+void PdfPageCollection::AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount,
+    PdfImportFlags flags)
 {
-    return GetDocument().AppendDocumentPages(doc, pageIndex, pageCount);
+    return GetDocument().AppendDocumentPages(doc, pageIndex, pageCount, flags);
 }
 
-void PdfPageCollection::InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex)
+void PdfPageCollection::InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex,
+    PdfImportFlags flags)
 {
-    return GetDocument().InsertDocumentPageAt(atIndex, doc, pageIndex);
+    return GetDocument().InsertDocumentPageAt(atIndex, doc, pageIndex, flags);
 }
 
 void PdfPageCollection::RemovePageAt(unsigned atIndex)
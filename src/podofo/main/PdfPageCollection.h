@@ -99,21 +99,25 @@ public:
     /** Appends another PdfDocument to this document.
      *  \param doc the document to append
      */
-    void AppendDocumentPages(const PdfDocument& doc);
+    void AppendDocumentPages(const PdfDocument& doc, PdfImportFlags flags = PdfImportFlags::None);
 
     /** Copies one or more pages from another PdfMemDocument to this document
      *  \param doc the document to append
      *  \param atIndex the first page number to copy (0-based)
      *  \param pageCount the number of pages to copy
+     *  \remarks Only the objects reachable from the copied pages
+     *  are copied, the other pages of the document are not
      */
-    void AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount);
+    void AppendDocumentPages(const PdfDocument& doc, unsigned pageIndex, unsigned pageCount,
+        PdfImportFlags flags = PdfImportFlags::None);
 
     /** Inserts existing page from another PdfDocument to this document.
      *  \param atIndex index at which to add the page in this document
      *  \param doc the document to append from
      *  \param pageIndex index of page to append from doc
      */
-    void InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex);
+    void InsertDocumentPageAt(unsigned atIndex, const PdfDocument& doc, unsigned pageIndex,
+        PdfImportFlags flags = PdfImportFlags::None);
 
     /**  Delete the specified page object from the internal pages tree.
      *   It does NOT remove any PdfObjects from memory - just the reference from the tree
@@ -19,6 +19,7 @@
 #include "PdfXObjectForm.h"
 #include "PdfContentStreamReader.h"
 #include "PdfFont.h"
+#include "PdfTextExtractSession.h"
 
 #include <podofo/private/outstringstream.h>
 #include <podofo/auxiliary/StateStack.h>
@@ -66,17 +67,20 @@ public:
     StatefulString GetTrimmedEnd() const;
     double GetLengthRaw() const;
     double GetLength() const;
-private:
-    vector<double> computeLengths(const vector<double>& rawLengths);
+    // The lengths are lazily computed, since they
+    // are not needed when extracting text only
+    const vector<double>& GetLengths() const;
 public:
     const string String;
     const TextState State;
     const vector<double> RawLengths;
-    const vector<double> Lengths;
     // Glyph position in the string
     const vector<unsigned> StringPositions;
     const Vector2 Position;
     const bool IsWhiteSpace;
+private:
+    mutable vector<double> m_lengths;
+    mutable bool m_lengthsComputed;
 };
 
 struct EntryOptions
@@ -89,6 +93,21 @@ struct EntryOptions
     bool ComputeBoundingBox;
     bool RawCoordinates;
     bool ExtractSubstring;
+    bool TextOnly;
+};
+
+// Index of the clip regions, sorted by bottom coordinate,
+// to quickly test text bounding boxes intersection
+class RegionIndex
+{
+public:
+    RegionIndex(const vector<Rect>& regions);
+public:
+    bool Intersects(const Rect& rect) const;
+    bool IsEmpty() const { return m_regions.empty(); }
+private:
+    vector<Rect> m_regions;
+    double m_maxHeight;
 };
 
 using StringChunk = list<StatefulString>;
@@ -106,8 +125,8 @@ struct XObjectState
 struct ExtractionContext
 {
 public:
-    ExtractionContext(vector<PdfTextEntry> &entries, const PdfPage &page, const string_view &pattern,
-        PdfTextExtractFlags flags, const nullable<Rect> &clipRect);
+    ExtractionContext(const PdfTextEntryHandler& handler, const PdfPage &page, const string_view &pattern,
+        const PdfTextExtractParams& params, PdfTextExtractSession* session);
 public:
     void BeginText();
     void EndText();
@@ -118,9 +137,11 @@ public:
     void AdvanceSpace(double ty);
     void TStar_Operator();
 public:
+    bool TrySkipString(const PdfString& str);
     void PushString(const StatefulString &str, bool pushchunk = false);
     void TryPushChunk();
     void TryAddLastEntry();
+    PdfTextExtractSession* GetSession() const { return m_session; }
 private:
     bool areChunksSpaced(double& distance);
     void pushChunk();
@@ -130,13 +151,15 @@ private:
     const StatefulString& getPreviouString() const;
 private:
     const PdfPage& m_page;
+    PdfTextExtractSession* m_session;
 public:
     const int PageIndex;
     const string Pattern;
     const EntryOptions Options;
     const nullable<Rect> ClipRect;
+    const RegionIndex ClipRegions;
     unique_ptr<Matrix> Rotation;
-    vector<PdfTextEntry> &Entries;
+    const PdfTextEntryHandler& Handler;
     StringChunkPtr Chunk = std::make_unique<StringChunk>();
     StringChunkList Chunks;
     TextStateStack States;
@@ -152,27 +175,30 @@ struct GlyphAddress
     unsigned GlyphIndex;
 };
 
-static bool decodeString(const PdfString &str, TextState &state, string &decoded,
-    vector<double> &lengths, vector<unsigned>& positions);
+static bool decodeString(const PdfString &str, ExtractionContext& context,
+    string &decoded, vector<double> &lengths, vector<unsigned>& positions);
+static void mergeGlyphRuns(const string& str, vector<double>& lengths, vector<unsigned>& positions);
 static bool areEqual(double lhs, double rhs);
 static bool isWhiteSpaceChunk(const StringChunk &chunk);
 static void splitChunkBySpaces(vector<StringChunkPtr> &splittedChunks, const StringChunk &chunk);
 static void splitStringBySpaces(vector<StatefulString> &separatedStrings, const StatefulString &string);
 static void trimSpacesBegin(StringChunk &chunk);
 static void trimSpacesEnd(StringChunk &chunk);
-static void addEntry(vector<PdfTextEntry> &textEntries, StringChunkList &strings,
+static void addEntry(const PdfTextEntryHandler& handler, StringChunkList &strings,
     const string_view &pattern, const EntryOptions &options, const nullable<Rect> &clipRect,
     int pageIndex, const Matrix* rotation);
-static void addEntryChunk(vector<PdfTextEntry> &textEntries, StringChunkList &strings,
+static void addEntryChunk(const PdfTextEntryHandler& handler, StringChunkList &strings,
     const string_view &pattern, const EntryOptions& options, const nullable<Rect> &clipRect,
     int pageIndex, const Matrix* rotation);
 static void processChunks(const StringChunkList& chunks, string& destString,
     vector<unsigned>& positions, vector<const StatefulString*>& strings,
     vector<GlyphAddress>& glyphAddresses);
+static void concatenateChunks(const StringChunkList& chunks, string& destString);
 static double computeLength(const vector<const StatefulString*>& strings, const vector<GlyphAddress>& glyphAddresses,
     unsigned lowerIndex, unsigned upperIndex);
 static bool isMatchWholeWordSubstring(const string_view& str, const string_view& pattern, size_t& matchPos);
 static Rect computeBoundingBox(const TextState& textState, double boxWidth);
+static Rect computeStringBox(const TextState& textState, double length);
 static void read(const PdfVariantStack& stack, double &tx, double &ty);
 static void read(const PdfVariantStack& stack, double &a, double &b, double &c, double &d, double &e, double &f);
 static void getSubstringIndices(const vector<unsigned>& positions, unsigned lowerPos, unsigned upperLimitPos,
@@ -187,7 +213,21 @@ void PdfPage::ExtractTextTo(vector<PdfTextEntry>& entries, const PdfTextExtractP
 void PdfPage::ExtractTextTo(vector<PdfTextEntry>& entries, const string_view& pattern,
     const PdfTextExtractParams& params) const
 {
-    ExtractionContext context(entries, *this, pattern, params.Flags, params.ClipRect);
+    extractTextTo([&entries](PdfTextEntry&& entry) {
+        entries.push_back(std::move(entry));
+    }, pattern, params, nullptr);
+}
+
+void PdfPage::ExtractTextTo(const PdfTextEntryHandler& handler, const string_view& pattern,
+    const PdfTextExtractParams& params) const
+{
+    extractTextTo(handler, pattern, params, nullptr);
+}
+
+void PdfPage::extractTextTo(const PdfTextEntryHandler& handler, const string_view& pattern,
+    const PdfTextExtractParams& params, PdfTextExtractSession* session) const
+{
+    ExtractionContext context(handler, *this, pattern, params, session);
 
     // Look FIGURE 4.1 Graphics objects
     PdfContentStreamReader reader(*this);
@@ -301,7 +341,8 @@ void PdfPage::ExtractTextTo(vector<PdfTextEntry>& entries, const string_view& pa
                             context.States.Current->PdfState.WordSpacing = content.Stack[2].GetReal();
                         }
 
-                        if (decodeString(str, *context.States.Current, decoded, lengths, positions)
+                        if (!context.TrySkipString(str)
+                            && decodeString(str, context, decoded, lengths, positions)
                             && decoded.length() != 0)
                         {
                             context.PushString(StatefulString(std::move(decoded), *context.States.Current,
@@ -329,7 +370,8 @@ void PdfPage::ExtractTextTo(vector<PdfTextEntry>& entries, const string_view& pa
                             auto& obj = array[i];
                             if (obj.TryGetString(str))
                             {
-                                if (decodeString(*str, *context.States.Current, decoded, lengths, positions)
+                                if (!context.TrySkipString(*str)
+                                    && decodeString(*str, context, decoded, lengths, positions)
                                     && decoded.length() != 0)
                                 {
                                     context.PushString(StatefulString(std::move(decoded), *context.States.Current,
@@ -427,7 +469,7 @@ void PdfPage::ExtractTextTo(vector<PdfTextEntry>& entries, const string_view& pa
     context.TryAddLastEntry();
 }
 
-void addEntry(vector<PdfTextEntry> &textEntries, StringChunkList &chunks, const string_view &pattern,
+void addEntry(const PdfTextEntryHandler& handler, StringChunkList &chunks, const string_view &pattern,
     const EntryOptions &options, const nullable<Rect> &clipRect, int pageIndex, const Matrix* rotation)
 {
     if (options.TokenizeWords)
@@ -481,18 +523,18 @@ void addEntry(vector<PdfTextEntry> &textEntries, StringChunkList &chunks, const
 
         for (auto& batch : batches)
         {
-            addEntryChunk(textEntries, *batch, pattern, options,
+            addEntryChunk(handler, *batch, pattern, options,
                 clipRect, pageIndex, rotation);
         }
     }
     else
     {
-        addEntryChunk(textEntries, chunks, pattern, options,
+        addEntryChunk(handler, chunks, pattern, options,
             clipRect, pageIndex, rotation);
     }
 }
 
-void addEntryChunk(vector<PdfTextEntry> &textEntries, StringChunkList &chunks, const string_view &pattern,
+void addEntryChunk(const PdfTextEntryHandler& handler, StringChunkList &chunks, const string_view &pattern,
     const EntryOptions& options, const nullable<Rect> &clipRect, int pageIndex, const Matrix* rotation)
 {
     if (options.TrimSpaces)
@@ -543,7 +585,11 @@ void addEntryChunk(vector<PdfTextEntry> &textEntries, StringChunkList &chunks, c
     vector<unsigned> positions;
     vector<const StatefulString*> strings;
     vector<GlyphAddress> glyphAddresses;
-    processChunks(chunks, str, positions, strings, glyphAddresses);
+    if (options.TextOnly)
+        concatenateChunks(chunks, str);
+    else
+        processChunks(chunks, str, positions, strings, glyphAddresses);
+
     unsigned lowerIndex = 0;
     unsigned upperIndexLimit = (unsigned)glyphAddresses.size();
     auto textState = firstStr.State;
@@ -628,27 +674,24 @@ void addEntryChunk(vector<PdfTextEntry> &textEntries, StringChunkList &chunks, c
         }
     }
 
-    double strLength = computeLength(strings, glyphAddresses, lowerIndex, upperIndexLimit - 1);
+    double strLength = 0;
+    if (!options.TextOnly)
+        strLength = computeLength(strings, glyphAddresses, lowerIndex, upperIndexLimit - 1);
+
     nullable<Rect> bbox;
     if (options.ComputeBoundingBox)
         bbox = computeBoundingBox(textState, strLength);
 
     // Rotate to canonical frame
     auto strPosition = textState.T_rm.GetTranslationVector();
-    if (rotation == nullptr || options.RawCoordinates)
-    {
-        textEntries.push_back(PdfTextEntry{ str, pageIndex,
-            strPosition.X, strPosition.Y, strLength, bbox });
-    }
-    else
-    {
-        Vector2 rawp(strPosition.X, strPosition.Y);
-        auto p_1 = rawp * (*rotation);
-        textEntries.push_back(PdfTextEntry{ str, pageIndex,
-            p_1.X, p_1.Y, strLength, bbox });
-    }
+    if (!(rotation == nullptr || options.RawCoordinates))
+        strPosition = strPosition * (*rotation);
 
+    // NOTE: Clear the chunks before invoking the handler,
+    // as the string must not be referenced anymore
     chunks.clear();
+    handler(PdfTextEntry{ std::move(str), pageIndex, strPosition.X, strPosition.Y,
+        strLength, bbox, textState.PdfState.Font, textState.PdfState.FontSize });
 }
 
 void read(const PdfVariantStack& tokens, double & tx, double & ty)
@@ -667,9 +710,10 @@ void read(const PdfVariantStack& tokens, double & a, double & b, double & c, dou
     a = tokens[5].GetReal();
 }
 
-bool decodeString(const PdfString &str, TextState &state, string &decoded,
-    vector<double>& lengths, vector<unsigned>& positions)
+bool decodeString(const PdfString &str, ExtractionContext& context,
+    string &decoded, vector<double>& lengths, vector<unsigned>& positions)
 {
+    auto& state = *context.States.Current;
     if (state.PdfState.Font == nullptr)
     {
         if (!str.IsHex())
@@ -691,19 +735,62 @@ bool decodeString(const PdfString &str, TextState &state, string &decoded,
         return false;
     }
 
-    state.ScanString(str, decoded, lengths, positions);
+    auto session = context.GetSession();
+    if (session == nullptr)
+        state.ScanString(str, decoded, lengths, positions);
+    else
+        (void)session->ScanString(*state.PdfState.Font, str, state.PdfState, decoded, lengths, positions);
+
+    if (context.Options.TextOnly)
+        mergeGlyphRuns(decoded, lengths, positions);
+
     return true;
 }
 
+// Merge the glyphs in runs of white space and non white space glyphs,
+// which are the only boundaries needed when extracting text only, to
+// trim spaces or to tokenize words. The glyph class is the one of its
+// first code point, and glyphs with no code points join the previous run
+void mergeGlyphRuns(const string& str, vector<double>& lengths, vector<unsigned>& positions)
+{
+    unsigned count = 0;
+    bool prevWhiteSpace = false;
+    for (unsigned i = 0; i < positions.size(); i++)
+    {
+        bool whiteSpace = false;
+        if (positions[i] < str.length())
+        {
+            auto it = str.begin() + positions[i];
+            whiteSpace = utls::IsWhiteSpace((char32_t)utf8::next(it, str.end()));
+        }
+
+        bool emptyGlyph = i + 1 < positions.size() ? positions[i] == positions[i + 1]
+            : positions[i] == str.length();
+        if (count != 0 && (emptyGlyph || whiteSpace == prevWhiteSpace))
+        {
+            lengths[count - 1] += lengths[i];
+            continue;
+        }
+
+        lengths[count] = lengths[i];
+        positions[count] = positions[i];
+        prevWhiteSpace = whiteSpace;
+        count++;
+    }
+
+    lengths.resize(count);
+    positions.resize(count);
+}
+
 StatefulString::StatefulString(string&& str, const TextState& state,
         vector<double>&& lengths, vector<unsigned>&& positions) :
     String(std::move(str)),
     State(state),
     RawLengths(std::move(lengths)),
-    Lengths(computeLengths(RawLengths)),
     StringPositions(std::move(positions)),
     Position(state.T_rm.GetTranslationVector()),
-    IsWhiteSpace(utls::IsStringEmptyOrWhiteSpace(String))
+    IsWhiteSpace(utls::IsStringEmptyOrWhiteSpace(String)),
+    m_lengthsComputed(false)
 {
     PODOFO_ASSERT(String.length() != 0);
     PODOFO_ASSERT(RawLengths.size() != 0);
@@ -741,7 +828,7 @@ StatefulString StatefulString::GetTrimmedBegin() const
                 break;
             }
 
-            length += Lengths[i];
+            length += GetLengths()[i];
         }
 
         state.T_m.Apply<Tx>(length);
@@ -804,8 +891,9 @@ StatefulString StatefulString::GetTrimmedEnd() const
             }
         }
     }
+    auto& lengths = GetLengths();
     return StatefulString(std::move(trimmedStr), State,
-        { Lengths.begin(), Lengths.begin() + positionIndexLimit },
+        { lengths.begin(), lengths.begin() + positionIndexLimit },
         { StringPositions.begin(), StringPositions.begin() + positionIndexLimit });
 }
 
@@ -820,33 +908,39 @@ double StatefulString::GetLengthRaw() const
 
 double StatefulString::GetLength() const
 {
+    auto& lengths = GetLengths();
     double length = 0;
-    for (unsigned i = 0; i < Lengths.size(); i++)
-        length += Lengths[i];
+    for (unsigned i = 0; i < lengths.size(); i++)
+        length += lengths[i];
 
     return length;
 }
 
-vector<double> StatefulString::computeLengths(const vector<double>& rawLengths)
+const vector<double>& StatefulString::GetLengths() const
 {
+    if (m_lengthsComputed)
+        return m_lengths;
+
     // NOTE: the lengths are transformed accordingly to text state but
     // are not CTM transformed
-    vector<double> ret;
-    ret.reserve(rawLengths.size());
-    for (unsigned i = 0; i < rawLengths.size(); i++)
-        ret.push_back((Vector2(rawLengths[i], 0) * State.CTM.GetScalingRotation()).GetLength());
+    m_lengths.reserve(RawLengths.size());
+    for (unsigned i = 0; i < RawLengths.size(); i++)
+        m_lengths.push_back((Vector2(RawLengths[i], 0) * State.CTM.GetScalingRotation()).GetLength());
 
-    return ret;
+    m_lengthsComputed = true;
+    return m_lengths;
 }
 
-ExtractionContext::ExtractionContext(vector<PdfTextEntry>& entries, const PdfPage& page, const string_view& pattern,
-    PdfTextExtractFlags flags , const nullable<Rect>& clipRect) :
+ExtractionContext::ExtractionContext(const PdfTextEntryHandler& handler, const PdfPage& page, const string_view& pattern,
+    const PdfTextExtractParams& params, PdfTextExtractSession* session) :
     m_page(page),
+    m_session(session),
     PageIndex(page.GetPageNumber() - 1),
     Pattern(pattern),
-    Options(optionsFromFlags(flags)),
-    ClipRect(clipRect),
-    Entries(entries)
+    Options(optionsFromFlags(params.Flags)),
+    ClipRect(params.ClipRect),
+    ClipRegions(params.ClipRegions),
+    Handler(handler)
 {
     if (Options.ExtractSubstring && pattern.empty())
         PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "Unsupported ExtractSubstring flag with empty pattern");
@@ -879,7 +973,14 @@ void ExtractionContext::Tf_Operator(const PdfName &fontname, double fontsize)
     auto resources = getActualCanvas().GetResources();
     double spacingLengthRaw = 0;
     States.Current->PdfState.FontSize = fontsize;
-    if (resources == nullptr || (States.Current->PdfState.Font = resources->GetFont(fontname)) == nullptr)
+    if (resources == nullptr)
+        States.Current->PdfState.Font = nullptr;
+    else if (m_session == nullptr)
+        States.Current->PdfState.Font = resources->GetFont(fontname);
+    else
+        States.Current->PdfState.Font = m_session->GetFont(*resources, fontname);
+
+    if (States.Current->PdfState.Font == nullptr)
         PoDoFo::LogMessage(PdfLogSeverity::Warning, "Unable to find font object {}", fontname.GetString());
     else
         spacingLengthRaw = States.Current->GetWordSpacingLength();
@@ -930,6 +1031,32 @@ void ExtractionContext::AdvanceSpace(double tx)
     States.Current->ComputeDependentState();
 }
 
+bool ExtractionContext::TrySkipString(const PdfString& str)
+{
+    if (ClipRegions.IsEmpty())
+        return false;
+
+    // NOTE: Without a font the string can't be
+    // measured, so it must be decoded anyway
+    auto& state = *States.Current;
+    if (state.PdfState.Font == nullptr)
+        return false;
+
+    // Measuring the string just requires the conversion to CIDs,
+    // which is way cheaper than the full unicode decoding
+    double length;
+    if (!state.PdfState.Font->TryGetEncodedStringLength(str, state.PdfState, length)
+        || ClipRegions.Intersects(computeStringBox(state, length)))
+    {
+        return false;
+    }
+
+    // Advance the position as if the string was shown
+    state.T_m.Apply<Tx>(length);
+    state.ComputeT_rm();
+    return true;
+}
+
 void ExtractionContext::PushString(const StatefulString &str, bool pushchunk)
 {
     PODOFO_ASSERT(str.String.length() != 0);
@@ -998,7 +1125,7 @@ const StatefulString& ExtractionContext::getPreviouString() const
 
 void ExtractionContext::addEntry()
 {
-    ::addEntry(Entries, Chunks, Pattern, Options, ClipRect, PageIndex, Rotation.get());
+    ::addEntry(Handler, Chunks, Pattern, Options, ClipRect, PageIndex, Rotation.get());
 }
 
 void ExtractionContext::tryAddEntry(const StatefulString& currStr)
@@ -1106,11 +1233,12 @@ void splitStringBySpaces(vector<StatefulString> &separatedStrings, const Statefu
     unsigned lowerPosIndex;
     unsigned upperPosLimIndex;
     
+    auto& lengths = str.GetLengths();
     auto pushString = [&]() {
         getSubstringIndices(str.StringPositions, lowerPos, upperPosLim, lowerPosIndex, upperPosLimIndex);
         double length = 0;
         for (unsigned i = lowerPosIndex; i < upperPosLimIndex; i++)
-            length += str.Lengths[i];
+            length += lengths[i];
 
         // Fixed string positions after split
         auto positions = vector<unsigned>(str.StringPositions.begin() + lowerPosIndex, str.StringPositions.begin() + upperPosLimIndex);
@@ -1118,7 +1246,7 @@ void splitStringBySpaces(vector<StatefulString> &separatedStrings, const Statefu
             positions[i] -= lowerPos;
 
         separatedStrings.push_back(StatefulString(std::move(separatedStr), state,
-            { str.Lengths.begin() + lowerPosIndex, str.Lengths.begin() + upperPosLimIndex },
+            { lengths.begin() + lowerPosIndex, lengths.begin() + upperPosLimIndex },
             std::move(positions)));
         lowerPos = previousPos;
         upperPosLim = (unsigned)str.String.length();
@@ -1260,6 +1388,16 @@ void processChunks(const StringChunkList& chunks, string& destString,
     }
 }
 
+// Concatenate all strings, without keeping track of glyphs
+void concatenateChunks(const StringChunkList& chunks, string& destString)
+{
+    for (auto& chunk : chunks)
+    {
+        for (auto& str : *chunk)
+            destString.append(str.String.data(), str.String.length());
+    }
+}
+
 // TODO: Handle vertical scritps
 double computeLength(const vector<const StatefulString*>& strings, const vector<GlyphAddress>& glyphAddresses,
     unsigned lowerIndex, unsigned upperIndex)
@@ -1273,7 +1411,7 @@ double computeLength(const vector<const StatefulString*>& strings, const vector<
         auto str = strings[fromAddr.StringIndex];
         double length = 0;
         for (unsigned i = 0; i <= toAddr.GlyphIndex; i++)
-            length += str->Lengths[i];
+            length += str->GetLengths()[i];
 
         return length;
     }
@@ -1285,12 +1423,12 @@ double computeLength(const vector<const StatefulString*>& strings, const vector<
         // Advance the position before the first glyph
         auto fromPosition = fromStr->Position;
         for (unsigned i = 0; i < fromAddr.GlyphIndex; i++)
-            fromPosition += Vector2(fromStr->Lengths[i], 0);
+            fromPosition += Vector2(fromStr->GetLengths()[i], 0);
 
         // NOTE: Include the last glyph
         auto toPosition = toStr->Position;
         for (unsigned i = 0; i <= toAddr.GlyphIndex; i++)
-            toPosition += Vector2(toStr->Lengths[i], 0);
+            toPosition += Vector2(toStr->GetLengths()[i], 0);
 
         return (fromPosition - toPosition).GetLength();
     }
@@ -1361,6 +1499,64 @@ Rect computeBoundingBox(const TextState& textState, double boxWidth)
     return Rect(position.X, position.Y - descend, boxWidth, descend + ascent);
 }
 
+// Compute a conservative bounding box of the string in raw
+// page coordinates, as the glyphs extents are not known
+Rect computeStringBox(const TextState& textState, double length)
+{
+    double height = std::abs(textState.PdfState.FontSize);
+    Vector2 corners[4] = {
+        Vector2(0, -height) * textState.T_rm,
+        Vector2(length, -height) * textState.T_rm,
+        Vector2(0, height) * textState.T_rm,
+        Vector2(length, height) * textState.T_rm,
+    };
+
+    double left = corners[0].X;
+    double bottom = corners[0].Y;
+    double right = corners[0].X;
+    double top = corners[0].Y;
+    for (unsigned i = 1; i < 4; i++)
+    {
+        left = std::min(left, corners[i].X);
+        bottom = std::min(bottom, corners[i].Y);
+        right = std::max(right, corners[i].X);
+        top = std::max(top, corners[i].Y);
+    }
+
+    return Rect(left, bottom, right - left, top - bottom);
+}
+
+RegionIndex::RegionIndex(const vector<Rect>& regions)
+    : m_regions(regions), m_maxHeight(0)
+{
+    std::sort(m_regions.begin(), m_regions.end(), [](const Rect& lhs, const Rect& rhs) {
+        return lhs.Y < rhs.Y;
+    });
+
+    for (auto& region : m_regions)
+        m_maxHeight = std::max(m_maxHeight, region.Height);
+}
+
+bool RegionIndex::Intersects(const Rect& rect) const
+{
+    // Only the regions with bottom coordinate in the range
+    // [rect.Bottom - max height, rect.Top] may intersect
+    auto it = std::lower_bound(m_regions.begin(), m_regions.end(), rect.Y - m_maxHeight,
+        [](const Rect& region, double y) {
+            return region.Y < y;
+        });
+
+    double top = rect.GetTop();
+    double right = rect.GetRight();
+    for (; it != m_regions.end() && it->Y <= top; it++)
+    {
+        if (it->GetTop() >= rect.Y && it->X <= right && it->GetRight() >= rect.X)
+            return true;
+    }
+
+    return false;
+}
+
 void getSubstringIndices(const vector<unsigned>& positions, unsigned lowerPos, unsigned upperPosLim,
     unsigned& lowerPosIndex, unsigned& upperPosLimIndex)
 {
@@ -1397,6 +1593,7 @@ EntryOptions optionsFromFlags(PdfTextExtractFlags flags)
     ret.ComputeBoundingBox = (flags & PdfTextExtractFlags::ComputeBoundingBox) != PdfTextExtractFlags::None;
     ret.RawCoordinates = (flags & PdfTextExtractFlags::RawCoordinates) != PdfTextExtractFlags::None;
     ret.ExtractSubstring = (flags & PdfTextExtractFlags::ExtractSubstring) != PdfTextExtractFlags::None;
+    ret.TextOnly = (flags & PdfTextExtractFlags::TextOnly) != PdfTextExtractFlags::None;
 
     if (ret.RegexPattern)
     {
@@ -1407,5 +1604,14 @@ EntryOptions optionsFromFlags(PdfTextExtractFlags flags)
             PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "RegexPattern is currently unsupported with ExtractSubstring");
     }
 
+    if (ret.TextOnly)
+    {
+        if (ret.ComputeBoundingBox)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "TextOnly is incompatible with ComputeBoundingBox flag");
+
+        if (ret.ExtractSubstring)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::NotImplemented, "TextOnly is incompatible with ExtractSubstring flag");
+    }
+
     return ret;
 }
@@ -708,7 +708,7 @@ void PdfParser::readObjectsInternal(InputStreamDevice& device)
                         {
                             if (m_IgnoreBrokenObjects)
                             {
-                                PoDoFo::LogMessage(PdfLogSeverity::Error, "Error while loading object {} {} R, Offset={}, Index={}",
+                                PODOFO_LOG(PdfLogSeverity::Error, "Error while loading object {} {} R, Offset={}, Index={}",
                                     obj->GetIndirectReference().ObjectNumber(),
                                     obj->GetIndirectReference().GenerationNumber(),
                                     entry.Offset, i);
@@ -738,7 +738,7 @@ void PdfParser::readObjectsInternal(InputStreamDevice& device)
                         }
                         else
                         {
-                            PoDoFo::LogMessage(PdfLogSeverity::Warning,
+                            PODOFO_LOG(PdfLogSeverity::Warning,
                                 "Treating object {} 0 R as a free object", i);
                             m_Objects->AddFreeObject(PdfReference(i, 1));
                         }
@@ -814,7 +814,7 @@ void PdfParser::readCompressedObjectFromStream(uint32_t objNo, const cspan<int64
     {
         if (m_IgnoreBrokenObjects)
         {
-            PoDoFo::LogMessage(PdfLogSeverity::Error, "Loading of object {} 0 R failed!", objNo);
+            PODOFO_LOG(PdfLogSeverity::Error, "Loading of object {} 0 R failed!", objNo);
             return;
         }
         else
@@ -7,12 +7,14 @@
 #include <podofo/private/PdfDeclarationsPrivate.h>
 #include "PdfParserObject.h"
 
-#include "PdfDocument.h"
+#include "PdfMemDocument.h"
 #include "PdfArray.h"
 #include "PdfDictionary.h"
 #include "PdfEncrypt.h"
 #include <podofo/auxiliary/InputDevice.h>
 #include <podofo/auxiliary/InputStream.h>
+#include <podofo/auxiliary/StreamDevice.h>
+#include <podofo/private/ParallelUtils.h>
 #include "PdfParser.h"
 #include "PdfObjectStream.h"
 #include "PdfVariant.h"
@@ -73,6 +75,7 @@ void PdfParserObject::ParseStream()
 
 void PdfParserObject::DelayedLoadImpl()
 {
+    auto lock = lockDevice();
     PdfTokenizer tokenizer;
     m_device->Seek(m_Offset);
     if (!m_IsTrailer)
@@ -90,6 +93,7 @@ void PdfParserObject::DelayedLoadStreamImpl()
     {
         try
         {
+            auto lock = lockDevice();
             parseStream();
         }
         catch (PdfError& e)
@@ -113,6 +117,7 @@ PdfReference PdfParserObject::ReadReference(PdfTokenizer& tokenizer)
 // or PdfObject method calls here.
 void PdfParserObject::Parse(PdfTokenizer& tokenizer)
 {
+    IncrementCounter(PdfInstrumentationCounter::ParsedObjects);
     PdfStatefulEncrypt encrypt;
     if (m_Encrypt != nullptr)
         encrypt = PdfStatefulEncrypt(*m_Encrypt, GetIndirectReference());
@@ -158,6 +163,59 @@ void PdfParserObject::Parse(PdfTokenizer& tokenizer)
 }
 
 
+void PdfParserObject::ParseStreams(const cspan<PdfParserObject*>& objects, unsigned threadCount)
+{
+    // Reading from the device is not thread safe, so the raw
+    // data is read upfront and only the decryption is concurrent
+    vector<PdfParserObject*> toDecrypt;
+    vector<charbuff> buffers;
+    for (auto obj : objects)
+    {
+        obj->DelayedLoad();
+        if (obj->IsDelayedLoadStreamDone())
+            continue;
+
+        if (!obj->HasStreamToParse() || obj->m_Encrypt == nullptr)
+        {
+            obj->ParseStream();
+            continue;
+        }
+
+        charbuff buffer;
+        {
+            auto lock = obj->lockDevice();
+            size_t size = obj->seekStreamData();
+            if (obj->m_Encrypt != nullptr)
+            {
+                buffer.resize(size);
+                obj->m_device->Read(buffer.data(), size);
+            }
+        }
+
+        if (obj->m_Encrypt == nullptr)
+        {
+            // The stream is not encrypted, see seekStreamData()
+            obj->ParseStream();
+            continue;
+        }
+
+        toDecrypt.push_back(obj);
+        buffers.push_back(std::move(buffer));
+    }
+
+    utls::ParallelFor(toDecrypt.size(), threadCount, [&](size_t i)
+    {
+        auto& obj = *toDecrypt[i];
+        auto decrypted = std::make_unique<charbuff>();
+        obj.m_Encrypt->DecryptTo(*decrypted, buffers[i], obj.GetIndirectReference());
+        obj.m_decryptedStream = std::move(decrypted);
+        buffers[i] = charbuff();
+    });
+
+    for (auto obj : toDecrypt)
+        obj->ParseStream();
+}
+
 // Only called during delayed loading. Must be careful to avoid
 // triggering recursive delay loading due to use of accessors of
 // PdfVariant or PdfObject.
@@ -165,6 +223,35 @@ void PdfParserObject::parseStream()
 {
     PODOFO_ASSERT(IsDelayedLoadDone());
 
+    if (m_decryptedStream != nullptr)
+    {
+        // The stream was already read and decrypted, see ParseStreams()
+        SpanStreamDevice input(*m_decryptedStream);
+        getOrCreateStream().InitData(input, m_decryptedStream->size(), PdfFilterFactory::CreateFilterList(*this));
+        m_decryptedStream = nullptr;
+        m_Encrypt = nullptr;
+        return;
+    }
+
+    size_t size = seekStreamData();
+
+    // Set stream raw data without marking the object dirty
+    if (m_Encrypt != nullptr)
+    {
+        auto input = m_Encrypt->CreateEncryptionInputStream(*m_device, size, GetIndirectReference());
+        getOrCreateStream().InitData(*input, static_cast<ssize_t>(size), PdfFilterFactory::CreateFilterList(*this));
+        // Release the encrypt object after loading the stream.
+        // It's not needed for serialization here
+        m_Encrypt = nullptr;
+    }
+    else
+    {
+        getOrCreateStream().InitData(*m_device, static_cast<ssize_t>(size), PdfFilterFactory::CreateFilterList(*this));
+    }
+}
+
+size_t PdfParserObject::seekStreamData()
+{
     int64_t size = -1;
     char ch;
 
@@ -235,19 +322,7 @@ ReadStream:
         }
     }
 
-    // Set stream raw data without marking the object dirty
-    if (m_Encrypt != nullptr)
-    {
-        auto input = m_Encrypt->CreateEncryptionInputStream(*m_device, static_cast<size_t>(size), GetIndirectReference());
-        getOrCreateStream().InitData(*input, static_cast<ssize_t>(size), PdfFilterFactory::CreateFilterList(*this));
-        // Release the encrypt object after loading the stream.
-        // It's not needed for serialization here
-        m_Encrypt = nullptr;
-    }
-    else
-    {
-        getOrCreateStream().InitData(*m_device, static_cast<ssize_t>(size), PdfFilterFactory::CreateFilterList(*this));
-    }
+    return static_cast<size_t>(size);
 }
 
 void PdfParserObject::checkReference(PdfTokenizer& tokenizer)
@@ -255,7 +330,7 @@ void PdfParserObject::checkReference(PdfTokenizer& tokenizer)
     auto reference = readReference(tokenizer);
     if (GetIndirectReference() != reference)
     {
-        PoDoFo::LogMessage(PdfLogSeverity::Warning,
+        PODOFO_LOG(PdfLogSeverity::Warning,
             "Found object with reference {} different than reported {} in XRef sections",
             reference.ToString(), GetIndirectReference().ToString());
     }
@@ -299,3 +374,12 @@ void PdfParserObject::FreeObjectMemory(bool force)
         EnableDelayedLoadingStream();
     }
 }
+
+unique_lock<recursive_mutex> PdfParserObject::lockDevice()
+{
+    auto doc = dynamic_cast<PdfMemDocument*>(GetDocument());
+    if (doc == nullptr || doc->m_deviceMutex == nullptr)
+        return { };
+
+    return unique_lock<recursive_mutex>(*doc->m_deviceMutex);
+}
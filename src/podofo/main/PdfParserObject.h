@@ -7,6 +7,8 @@
 #ifndef PDF_PARSER_OBJECT_H
 #define PDF_PARSER_OBJECT_H
 
+#include <mutex>
+
 #include "PdfDeclarations.h"
 #include "PdfObject.h"
 #include "PdfTokenizer.h"
@@ -22,6 +24,8 @@ class PdfEncrypt;
 class PODOFO_API PdfParserObject : public PdfObject
 {
     friend class PdfParser;
+    friend class PdfMemDocument;
+    friend class PdfIndirectObjectList;
 
 private:
     /** Parse the object data from the given file handle starting at
@@ -108,12 +112,28 @@ private:
      */
     void parseStream();
 
+    /** Seek the device to the beginning of the stream data
+     * \returns the length of the raw stream data
+     */
+    size_t seekStreamData();
+
+    /** Load the streams of the given objects, decrypting them concurrently
+     * \param threadCount number of threads. 0 means hardware concurrency
+     */
+    static void ParseStreams(const cspan<PdfParserObject*>& objects, unsigned threadCount);
+
     PdfReference readReference(PdfTokenizer& tokenizer);
 
     void checkReference(PdfTokenizer& tokenizer);
 
+    /** Lock the input device, which may be shared by the forks
+     *  of the document, see PdfMemDocument::Fork()
+     */
+    std::unique_lock<std::recursive_mutex> lockDevice();
+
 private:
     std::shared_ptr<PdfEncrypt> m_Encrypt;
+    std::unique_ptr<charbuff> m_decryptedStream;
     InputStreamDevice* m_device;
     size_t m_Offset;
     size_t m_StreamOffset;
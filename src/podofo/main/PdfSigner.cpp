@@ -8,6 +8,9 @@
 #include "PdfSigner.h"
 #include "PdfDictionary.h"
 #include <podofo/auxiliary/StreamDevice.h>
+#include <podofo/private/ParallelUtils.h>
+
+#include <openssl/evp.h>
 
 using namespace std;
 using namespace PoDoFo;
@@ -15,11 +18,73 @@ using namespace PoDoFo;
 constexpr const char* ByteRangeBeacon = "[ 0 1234567890 1234567890 1234567890]";
 constexpr size_t BufferSize = 65536;
 
-static size_t readForSignature(StreamDevice& device,
-    size_t conentsBeaconOffset, size_t conentsBeaconSize,
-    char* buffer, size_t size);
-static void adjustByteRange(StreamDevice& device, size_t byteRangeOffset,
-    size_t conentsBeaconOffset, size_t conentsBeaconSize, charbuff& buffer);
+namespace
+{
+    // Output device that feeds the signer with the document data
+    // as soon as it's written, skipping the /Contents beacon. The
+    // final /ByteRange is known only when the whole document has
+    // been written, so the data starting from its beacon, which is
+    // usually just the tail of the incremental update, is kept
+    // aside to be fed after it has been adjusted
+    class SignerOutputDevice final : public OutputStreamDevice
+    {
+    public:
+        SignerOutputDevice(StreamDevice& device, PdfSigner& signer, const PdfSignatureBeacons& beacons);
+
+    public:
+        /** Adjust the /ByteRange, both on the device and on the
+         * data kept aside, and feed the remaining data to the signer
+         */
+        void FinishData();
+
+        size_t GetLength() const override { return m_device->GetLength(); }
+        size_t GetPosition() const override { return m_device->GetPosition(); }
+        bool CanSeek() const override { return m_device->CanSeek(); }
+        bool Eof() const override { return m_device->Eof(); }
+
+    protected:
+        void writeBuffer(const char* buffer, size_t size) override;
+        void flush() override;
+        void seek(ssize_t offset, SeekDirection direction) override;
+
+    private:
+        void appendData(size_t offset, const char* buffer, size_t size);
+
+    private:
+        StreamDevice* m_device;
+        PdfSigner* m_signer;
+        const PdfSignatureBeacons* m_beacons;
+        charbuff m_tail;
+        size_t m_tailOffset;
+    };
+
+    // Signer that just computes the digest of the document
+    class DigestSigner final : public PdfSigner
+    {
+    public:
+        DigestSigner(const PdfDeferredSigningParams& params);
+
+    public:
+        void Reset() override;
+        void AppendData(const bufferview& data) override;
+        void ComputeSignature(charbuff& buffer, bool dryrun) override;
+        string GetSignatureFilter() const override;
+        string GetSignatureSubFilter() const override;
+        string GetSignatureType() const override;
+
+    private:
+        const PdfDeferredSigningParams* m_params;
+        unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> m_ctx;
+    };
+}
+
+static void prepareDocument(PdfMemDocument& doc, PdfSigner& signer, PdfSignature& signature,
+    size_t beaconSize, PdfSignatureBeacons& beacons);
+static void saveDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner& signer,
+    const PdfSignatureBeacons& beacons, PdfSaveOptions opts);
+static void finishSigning(StreamDevice& device, PdfSigner& signer, charbuff& signatureBuf,
+    size_t beaconSize, const PdfSignatureBeacons& beacons);
+static void hashDeviceData(StreamDevice& device, PdfSigner& signer);
 static void setSignature(StreamDevice& device, const string_view& sigData,
     size_t conentsBeaconOffset, charbuff& buffer);
 static void prepareBeaconsData(size_t signatureSize, string& contentsBeacon, string& byteRangeBeacon);
@@ -44,6 +109,145 @@ void PoDoFo::SignDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner&
     signer.ComputeSignature(signatureBuf, true);
     size_t beaconSize = signatureBuf.size();
     PdfSignatureBeacons beacons;
+    prepareDocument(doc, signer, signature, beaconSize, beacons);
+    saveDocument(doc, device, signer, beacons, opts);
+
+    if (!signer.SkipBufferClear())
+        signatureBuf.clear();
+
+    finishSigning(device, signer, signatureBuf, beaconSize, beacons);
+}
+
+void PoDoFo::SignDocuments(const vector<PdfSigningJob>& jobs, const PdfSignerFactory& signerFactory,
+    PdfSaveOptions opts, unsigned threadCount)
+{
+    PdfSigningContext context(signerFactory, threadCount);
+    context.SignDocuments(jobs, opts);
+}
+
+PdfSigningContext::PdfSigningContext(const PdfSignerFactory& signerFactory, unsigned threadCount)
+    : m_signerFactory(signerFactory), m_threadCount(threadCount), m_beaconSize(0)
+{
+    if (signerFactory == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "The signer factory must be not null");
+}
+
+void PdfSigningContext::SignDocument(PdfMemDocument& doc, StreamDevice& device,
+    PdfSignature& signature, PdfSaveOptions opts)
+{
+    SignDocuments({ PdfSigningJob{ &doc, &device, &signature } }, opts);
+}
+
+void PdfSigningContext::SignDocuments(const vector<PdfSigningJob>& jobs, PdfSaveOptions opts)
+{
+    if (jobs.size() == 0)
+        return;
+
+    for (unsigned i = 0; i < jobs.size(); i++)
+    {
+        auto& job = jobs[i];
+        if (job.Document == nullptr || job.Device == nullptr || job.Signature == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Invalid signing job {}", i);
+    }
+
+    // Each document of a batch needs its own signer, while it's
+    // hashed, until its signature is computed
+    unsigned batchSize = utls::GetWorkerCount(m_threadCount, jobs.size());
+    ensureSigners(batchSize);
+
+    charbuff signatureBuf;
+    if (m_beaconSize == 0)
+    {
+        // The signers share the same configuration, so
+        // the signature size is inferred just once
+        m_signers[0]->ComputeSignature(signatureBuf, true);
+        m_beaconSize = signatureBuf.size();
+    }
+
+    vector<PdfSignatureBeacons> beacons(batchSize);
+    for (size_t batchIndex = 0; batchIndex < jobs.size(); batchIndex += batchSize)
+    {
+        size_t count = std::min(jobs.size() - batchIndex, (size_t)batchSize);
+
+        // Documents are independent, so they can be prepared,
+        // saved and hashed concurrently
+        utls::ParallelFor(count, m_threadCount, [&](size_t i)
+        {
+            auto& job = jobs[batchIndex + i];
+            auto& signer = *m_signers[i];
+            beacons[i] = { };
+            prepareDocument(*job.Document, signer, *job.Signature, m_beaconSize, beacons[i]);
+            saveDocument(*job.Document, *job.Device, signer, beacons[i], opts);
+        });
+
+        // Compute the signatures, which usually involve the
+        // private key operations, one after the other
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& signer = *m_signers[i];
+            signatureBuf.clear();
+
+            // The signer expects the buffer left by its own dry run
+            if (signer.SkipBufferClear())
+                signer.ComputeSignature(signatureBuf, true);
+
+            finishSigning(*jobs[batchIndex + i].Device, signer, signatureBuf, m_beaconSize, beacons[i]);
+        }
+    }
+}
+
+void PdfSigningContext::ensureSigners(unsigned count)
+{
+    while (m_signers.size() < count)
+    {
+        auto signer = m_signerFactory();
+        if (signer == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "The signer factory returned a null signer");
+
+        m_signers.push_back(std::move(signer));
+    }
+}
+
+PdfDeferredSigningState PoDoFo::PrepareDeferredSigning(PdfMemDocument& doc, StreamDevice& device,
+    PdfSignature& signature, const PdfDeferredSigningParams& params, charbuff& digest,
+    PdfSaveOptions opts)
+{
+    if (params.SignatureSize == 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "The signature size must be greater than zero");
+
+    DigestSigner signer(params);
+    PdfSignatureBeacons beacons;
+    prepareDocument(doc, signer, signature, params.SignatureSize, beacons);
+    saveDocument(doc, device, signer, beacons, opts);
+    signer.ComputeSignature(digest, false);
+
+    PdfDeferredSigningState ret;
+    ret.ContentsOffset = *beacons.ContentsOffset;
+    ret.SignatureSize = params.SignatureSize;
+    return ret;
+}
+
+void PoDoFo::FinishDeferredSigning(StreamDevice& device, const PdfDeferredSigningState& state,
+    const bufferview& signature)
+{
+    if (state.ContentsOffset == 0 || state.SignatureSize == 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Invalid deferred signing state");
+
+    if (signature.size() > state.SignatureSize)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::ValueOutOfRange, "The signature size {} is bigger than the reserved size {}",
+            signature.size(), state.SignatureSize);
+
+    // Fill all the space reserved for the /Contents
+    charbuff signatureBuf(state.SignatureSize);
+    std::memcpy(signatureBuf.data(), signature.data(), signature.size());
+    charbuff buffer;
+    setSignature(device, signatureBuf, state.ContentsOffset, buffer);
+    device.Flush();
+}
+
+void prepareDocument(PdfMemDocument& doc, PdfSigner& signer, PdfSignature& signature,
+    size_t beaconSize, PdfSignatureBeacons& beacons)
+{
     prepareBeaconsData(beaconSize, beacons.ContentsBeacon, beacons.ByteRangeBeacon);
     signature.PrepareForSigning(signer.GetSignatureFilter(), signer.GetSignatureSubFilter(),
         signer.GetSignatureType(), beacons);
@@ -61,29 +265,24 @@ void PoDoFo::SignDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner&
         // remore the key just in case it's present (defaults to false)
         acroForm->GetDictionary().RemoveKey("NeedAppearances");
     }
+}
 
-    doc.SaveUpdate(device, opts);
-    device.Flush();
-
-    charbuff buffer;
-    adjustByteRange(device, *beacons.ByteRangeOffset, *beacons.ContentsOffset,
-        beacons.ContentsBeacon.size(), buffer);
-    device.Flush();
-
-    // Read data from the device to prepare the signature
+void saveDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner& signer,
+    const PdfSignatureBeacons& beacons, PdfSaveOptions opts)
+{
+    // Feed the signer with the data already present in the device, then
+    // with the incremental update while it's being written
     signer.Reset();
-    device.Seek(0);
-    size_t readBytes;
-    buffer.resize(BufferSize);
-    while ((readBytes = readForSignature(device, *beacons.ContentsOffset, beacons.ContentsBeacon.size(),
-        buffer.data(), BufferSize)) != 0)
-    {
-        signer.AppendData({ buffer.data(), readBytes });
-    }
-
-    if (!signer.SkipBufferClear())
-        signatureBuf.clear();
+    hashDeviceData(device, signer);
+    SignerOutputDevice signerDevice(device, signer, beacons);
+    doc.SaveUpdate(signerDevice, opts);
+    signerDevice.FinishData();
+    device.Flush();
+}
 
+void finishSigning(StreamDevice& device, PdfSigner& signer, charbuff& signatureBuf,
+    size_t beaconSize, const PdfSignatureBeacons& beacons)
+{
     signer.ComputeSignature(signatureBuf, false);
     if (signatureBuf.size() > beaconSize)
         throw runtime_error("Actual signature size bigger than beacon size");
@@ -92,61 +291,181 @@ void PoDoFo::SignDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner&
     // beacon size previously cached to fill all
     // available reserved space for the /Contents
     signatureBuf.resize(beaconSize);
+    charbuff buffer;
     setSignature(device, signatureBuf, *beacons.ContentsOffset, buffer);
     device.Flush();
 }
 
-size_t readForSignature(StreamDevice& device, size_t conentsBeaconOffset, size_t conentsBeaconSize,
-    char* buffer, size_t bufferSize)
+void hashDeviceData(StreamDevice& device, PdfSigner& signer)
 {
-    if (device.Eof())
-        return 0;
+    size_t length = device.GetLength();
+    charbuff buffer(std::min(length, BufferSize));
+    device.Seek(0);
+    while (length != 0)
+    {
+        size_t readSize = std::min(length, BufferSize);
+        device.Read(buffer.data(), readSize);
+        signer.AppendData({ buffer.data(), readSize });
+        length -= readSize;
+    }
+}
 
-    size_t pos = device.GetPosition();
-    size_t readSize = 0;
-    // Check if we are before beacon
-    if (pos < conentsBeaconOffset)
+SignerOutputDevice::SignerOutputDevice(StreamDevice& device, PdfSigner& signer,
+        const PdfSignatureBeacons& beacons) :
+    m_device(&device),
+    m_signer(&signer),
+    m_beacons(&beacons),
+    m_tailOffset(0)
+{
+}
+
+void SignerOutputDevice::FinishData()
+{
+    size_t byteRangeOffset = *m_beacons->ByteRangeOffset;
+    size_t contentsOffset = *m_beacons->ContentsOffset;
+    size_t contentsSize = m_beacons->ContentsBeacon.size();
+    if (byteRangeOffset == 0 || contentsOffset == 0)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "The signature beacons were not written");
+
+    size_t fileEnd = m_device->GetLength();
+    PdfArray arr;
+    arr.Add(PdfObject(static_cast<int64_t>(0)));
+    arr.Add(PdfObject(static_cast<int64_t>(contentsOffset)));
+    arr.Add(PdfObject(static_cast<int64_t>(contentsOffset + contentsSize)));
+    arr.Add(PdfObject(static_cast<int64_t>(fileEnd - (contentsOffset + contentsSize))));
+
+    charbuff buffer;
+    charbuff byteRange;
+    BufferStreamDevice byteRangeDevice(byteRange);
+    arr.Write(byteRangeDevice, PdfWriteFlags::None, { }, buffer);
+    if (byteRange.size() > m_beacons->ByteRangeBeacon.size())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "The /ByteRange doesn't fit the beacon");
+
+    m_device->Seek(byteRangeOffset);
+    m_device->Write(byteRange.data(), byteRange.size());
+
+    // The data kept aside starts exactly at the /ByteRange beacon
+    if (m_tailOffset != byteRangeOffset || m_tail.size() < byteRange.size())
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "The data kept aside doesn't match the /ByteRange beacon");
+
+    std::memcpy(m_tail.data(), byteRange.data(), byteRange.size());
+    appendData(m_tailOffset, m_tail.data(), m_tail.size());
+    m_tail.clear();
+}
+
+void SignerOutputDevice::writeBuffer(const char* buffer, size_t size)
+{
+    size_t offset = m_device->GetPosition();
+    m_device->Write(buffer, size);
+    if (*m_beacons->ByteRangeOffset == 0)
     {
-        readSize = std::min(bufferSize, conentsBeaconOffset - pos);
-        if (readSize > 0)
-        {
-            device.Read(buffer, readSize);
-            buffer += readSize;
-            bufferSize -= readSize;
-            if (bufferSize == 0)
-                return readSize;
-        }
+        appendData(offset, buffer, size);
     }
+    else
+    {
+        if (m_tail.size() == 0)
+            m_tailOffset = offset;
 
-    // shift at the end of beacon
-    if ((pos + readSize) >= conentsBeaconOffset
-        && pos < (conentsBeaconOffset + conentsBeaconSize))
+        m_tail.append(buffer, size);
+    }
+}
+
+void SignerOutputDevice::flush()
+{
+    m_device->Flush();
+}
+
+void SignerOutputDevice::seek(ssize_t offset, SeekDirection direction)
+{
+    m_device->Seek(offset, direction);
+}
+
+// Feed the signer with the given data, skipping the /Contents beacon
+void SignerOutputDevice::appendData(size_t offset, const char* buffer, size_t size)
+{
+    size_t contentsOffset = *m_beacons->ContentsOffset;
+    if (contentsOffset == 0)
     {
-        device.Seek(conentsBeaconOffset + conentsBeaconSize);
+        // The /Contents beacon has not been written yet
+        m_signer->AppendData({ buffer, size });
+        return;
     }
 
-    // read after beacon
-    bufferSize = std::min(bufferSize, device.GetLength() - device.GetPosition());
-    if (bufferSize == 0)
-        return readSize;
+    size_t contentsEnd = contentsOffset + m_beacons->ContentsBeacon.size();
+    size_t end = offset + size;
+    if (offset < contentsOffset)
+    {
+        size_t beforeEnd = std::min(end, contentsOffset);
+        m_signer->AppendData({ buffer, beforeEnd - offset });
+    }
 
-    device.Read(buffer, bufferSize);
-    return readSize + bufferSize;
+    if (end > contentsEnd)
+    {
+        size_t afterOffset = std::max(offset, contentsEnd);
+        m_signer->AppendData({ buffer + (afterOffset - offset), end - afterOffset });
+    }
 }
 
-void adjustByteRange(StreamDevice& device, size_t byteRangeOffset,
-    size_t conentsBeaconOffset, size_t conentsBeaconSize, charbuff& buffer)
+DigestSigner::DigestSigner(const PdfDeferredSigningParams& params) :
+    m_params(&params),
+    m_ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free)
 {
-    // Get final position
-    size_t fileEnd = device.GetLength();
-    PdfArray arr;
-    arr.Add(PdfObject(static_cast<int64_t>(0)));
-    arr.Add(PdfObject(static_cast<int64_t>(conentsBeaconOffset)));
-    arr.Add(PdfObject(static_cast<int64_t>(conentsBeaconOffset + conentsBeaconSize)));
-    arr.Add(PdfObject(static_cast<int64_t>(fileEnd - (conentsBeaconOffset + conentsBeaconSize))));
+    if (m_ctx == nullptr)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::OutOfMemory, "Unable to create the hashing context");
+}
+
+void DigestSigner::Reset()
+{
+    const EVP_MD* md = nullptr;
+    switch (m_params->Hashing)
+    {
+        case PdfHashingAlgorithm::SHA256:
+            md = EVP_sha256();
+            break;
+        case PdfHashingAlgorithm::SHA384:
+            md = EVP_sha384();
+            break;
+        case PdfHashingAlgorithm::SHA512:
+            md = EVP_sha512();
+            break;
+        default:
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidEnumValue, "Unsupported hashing algorithm");
+    }
+
+    if (EVP_DigestInit_ex(m_ctx.get(), md, nullptr) != 1)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing the hashing engine");
+}
+
+void DigestSigner::AppendData(const bufferview& data)
+{
+    if (EVP_DigestUpdate(m_ctx.get(), data.data(), data.size()) != 1)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error hashing the document data");
+}
+
+void DigestSigner::ComputeSignature(charbuff& buffer, bool dryrun)
+{
+    (void)dryrun;
+    unsigned size;
+    buffer.resize(EVP_MAX_MD_SIZE);
+    if (EVP_DigestFinal_ex(m_ctx.get(), (unsigned char*)buffer.data(), &size) != 1)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error computing the document digest");
 
-    device.Seek(byteRangeOffset);
-    arr.Write(device, PdfWriteFlags::None, { }, buffer);
+    buffer.resize(size);
+}
+
+string DigestSigner::GetSignatureFilter() const
+{
+    return m_params->SignatureFilter;
+}
+
+string DigestSigner::GetSignatureSubFilter() const
+{
+    return m_params->SignatureSubFilter;
+}
+
+string DigestSigner::GetSignatureType() const
+{
+    return m_params->SignatureType;
 }
 
 void setSignature(StreamDevice& device, const string_view& contentsData,
@@ -16,6 +16,14 @@ namespace PoDoFo
 {
     class StreamDevice;
 
+    enum class PdfHashingAlgorithm : uint8_t
+    {
+        Unknown = 0,
+        SHA256,
+        SHA384,
+        SHA512,
+    };
+
     class PODOFO_API PdfSigner
     {
     public:
@@ -73,6 +81,130 @@ namespace PoDoFo
      */
     PODOFO_API void SignDocument(PdfMemDocument& doc, StreamDevice& device, PdfSigner& signer,
         PdfSignature& signature, PdfSaveOptions saveOptions = PdfSaveOptions::None);
+
+    /** A document to be signed with SignDocuments
+     */
+    struct PdfSigningJob final
+    {
+        PdfMemDocument* Document = nullptr;
+        StreamDevice* Device = nullptr;     ///< The input/output device where the document will be saved
+        PdfSignature* Signature = nullptr;  ///< The signature field where the signature will be applied
+    };
+
+    /** Factory of signers sharing the same configuration, eg. the
+     * same certificate and private key, but hashing different documents
+     */
+    using PdfSignerFactory = std::function<std::unique_ptr<PdfSigner>()>;
+
+    /** A signing context, reused across many signatures
+     *
+     * It keeps the signers and the signature size, which is inferred
+     * just once with a dry run of the first signer, across all the
+     * signatures. The signers are created lazily with the factory, one
+     * for each document that is signed concurrently, and they are reset
+     * before hashing each document. Signers that skip the buffer clear
+     * perform their own dry run before computing each signature
+     * \remarks The context itself is not thread safe
+     */
+    class PODOFO_API PdfSigningContext final
+    {
+    public:
+        /**
+         * \param signerFactory factory of the signers
+         * \param threadCount number of threads used to save and hash
+         *     the documents. 0 means hardware concurrency
+         */
+        PdfSigningContext(const PdfSignerFactory& signerFactory, unsigned threadCount = 0);
+
+    public:
+        /** Sign the document on the given signature field
+         */
+        void SignDocument(PdfMemDocument& doc, StreamDevice& device,
+            PdfSignature& signature, PdfSaveOptions saveOptions = PdfSaveOptions::None);
+
+        /** Sign many documents
+         *
+         * The documents are saved and hashed concurrently, in batches
+         * as big as the number of threads, while the final signatures of
+         * each batch are computed one after the other on the calling thread
+         * \param jobs the documents to be signed. The documents and
+         *     the devices must be all distinct
+         */
+        void SignDocuments(const std::vector<PdfSigningJob>& jobs,
+            PdfSaveOptions saveOptions = PdfSaveOptions::None);
+
+        /** Get the number of signers created so far
+         */
+        unsigned GetSignerCount() const { return (unsigned)m_signers.size(); }
+
+    private:
+        PdfSigningContext(const PdfSigningContext&) = delete;
+        PdfSigningContext& operator=(const PdfSigningContext&) = delete;
+
+    private:
+        void ensureSigners(unsigned count);
+
+    private:
+        PdfSignerFactory m_signerFactory;
+        unsigned m_threadCount;
+        std::vector<std::unique_ptr<PdfSigner>> m_signers;
+        size_t m_beaconSize;
+    };
+
+    /** Sign many documents with signers sharing the same configuration
+     *
+     * It's a shorthand for signing the documents with a PdfSigningContext
+     * \see PdfSigningContext::SignDocuments
+     * \param signerFactory factory invoked once for each document
+     *     that is signed concurrently
+     * \param threadCount number of threads used to save and hash the
+     *     documents. 0 means hardware concurrency
+     */
+    PODOFO_API void SignDocuments(const std::vector<PdfSigningJob>& jobs, const PdfSignerFactory& signerFactory,
+        PdfSaveOptions saveOptions = PdfSaveOptions::None, unsigned threadCount = 0);
+
+    /** Parameters of a deferred signing
+     */
+    struct PdfDeferredSigningParams final
+    {
+        std::string SignatureFilter = "Adobe.PPKLite";
+        std::string SignatureSubFilter = "ETSI.CAdES.detached";
+        std::string SignatureType = "Sig";
+        size_t SignatureSize = 16384;   ///< Space reserved for the signature, eg. a CMS blob
+        PdfHashingAlgorithm Hashing = PdfHashingAlgorithm::SHA256;
+    };
+
+    /** State of a document prepared for a deferred signing
+     *
+     * It holds no reference to the document or to the device,
+     * so it can be kept aside, or persisted, while the
+     * signature is computed elsewhere
+     */
+    struct PdfDeferredSigningState final
+    {
+        size_t ContentsOffset = 0;      ///< Offset of the /Contents placeholder in the device
+        size_t SignatureSize = 0;       ///< Maximum size of the signature fitting the placeholder
+    };
+
+    /** Prepare the document for a deferred signing on the given signature field
+     *
+     * The document is saved on the device, reserving the space for the
+     * signature, and the data covered by the /ByteRange is hashed
+     * \param digest the digest of the data covered by the /ByteRange
+     * \returns the state to be passed to FinishDeferredSigning
+     * \see FinishDeferredSigning
+     */
+    PODOFO_API PdfDeferredSigningState PrepareDeferredSigning(PdfMemDocument& doc, StreamDevice& device,
+        PdfSignature& signature, const PdfDeferredSigningParams& params, charbuff& digest,
+        PdfSaveOptions saveOptions = PdfSaveOptions::None);
+
+    /** Write the signature, eg. a CMS blob computed on the digest returned
+     * by PrepareDeferredSigning, in the space reserved in the document
+     * \param device the device with the document prepared for signing,
+     *     which can be also reopened in the meantime
+     */
+    PODOFO_API void FinishDeferredSigning(StreamDevice& device, const PdfDeferredSigningState& state,
+        const bufferview& signature);
 }
 
 #endif // PDF_SIGNER_H
@@ -48,6 +48,11 @@ void PdfStreamedDocument::SetPdfVersion(PdfVersion version)
     PODOFO_RAISE_ERROR(PdfErrorCode::NotImplemented);
 }
 
+void PdfStreamedDocument::OnObjectsImported(const vector<PdfObject*>& objects)
+{
+    m_Writer->WriteObjects(objects);
+}
+
 const PdfEncrypt* PdfStreamedDocument::GetEncrypt() const
 {
     return m_Encrypt;
@@ -43,6 +43,21 @@ namespace PoDoFo {
  *  painter.TextState.SetFont(*font, 18);
  *  painter.DrawText("Hello World!", 56.69, page.GetRect().Height - 56.69);
  *  painter.FinishDrawing();
+ *
+ *  Pages imported from other documents, eg. with
+ *  PdfPageCollection::AppendDocumentPages(), are written
+ *  immediately together with the objects reachable from them,
+ *  while only the pages, the objects referenced directly by them
+ *  and the annotations are kept in memory. Many documents can be
+ *  merged by loading and importing them one at a time:
+ *
+ *  PdfStreamedDocument output("merged.pdf");
+ *  for (auto& path : inputs)
+ *  {
+ *      PdfMemDocument input;
+ *      input.Load(path);
+ *      output.GetPages().AppendDocumentPages(input, PdfImportFlags::DeduplicateStreams);
+ *  }
  */
 class PODOFO_API PdfStreamedDocument final : public PdfDocument
 {
@@ -90,6 +105,8 @@ protected:
 
     void SetPdfVersion(PdfVersion version) override;
 
+    void OnObjectsImported(const std::vector<PdfObject*>& objects) override;
+
 private:
     /** Initialize the PdfStreamedDocument with an output device
      *  \param device write to this device
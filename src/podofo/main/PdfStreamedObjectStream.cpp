@@ -19,41 +19,61 @@ using namespace PoDoFo;
 class PdfStreamedObjectStream::ObjectOutputStream : public OutputStream
 {
 public:
-    ObjectOutputStream(PdfStreamedObjectStream& stream, OutputStreamDevice& outputStream) :
+    ObjectOutputStream(PdfStreamedObjectStream& stream, OutputStreamDevice& device, const PdfReference& objref) :
         m_objectStream(&stream),
-        m_outputStream(&outputStream)
-    {
-    }
-
-    ObjectOutputStream(PdfStreamedObjectStream& stream, unique_ptr<OutputStream> outputStream) :
-        m_objectStream(&stream),
-        m_outputStream(outputStream.get()),
-        m_outputStreamStore(std::move(outputStream))
+        m_device(&device),
+        m_objref(objref),
+        m_outputStream(nullptr)
     {
     }
 
     ~ObjectOutputStream()
     {
-        Flush(*m_outputStream);
-        m_objectStream->FinishOutput();
+        // NOTE: The encryption stream is finished by the
+        // object stream, when the stream append is ended
+        Flush(getOutputStream());
     }
 
 protected:
-    virtual void writeBuffer(const char* buffer, size_t size)
+    void writeBuffer(const char* buffer, size_t size) override
     {
-        WriteBuffer(*m_outputStream, buffer, size);
+        WriteBuffer(getOutputStream(), buffer, size);
         m_objectStream->m_Length += size;
     }
 
-    virtual void flush()
+    void flush() override
+    {
+        Flush(getOutputStream());
+    }
+
+private:
+    OutputStream& getOutputStream()
     {
-        Flush(*m_outputStream);
+        if (m_outputStream == nullptr)
+        {
+            // NOTE: The encryption stream is created lazily, since the
+            // encryption is set and the object header is written only
+            // after the output stream has been requested
+            auto encrypt = m_objectStream->m_CurrEncrypt;
+            if (encrypt == nullptr)
+            {
+                m_outputStream = m_device;
+            }
+            else
+            {
+                m_objectStream->m_EncryptStream = encrypt->CreateEncryptionOutputStream(*m_device, m_objref);
+                m_outputStream = m_objectStream->m_EncryptStream.get();
+            }
+        }
+
+        return *m_outputStream;
     }
 
 private:
     PdfStreamedObjectStream* m_objectStream;
+    OutputStreamDevice* m_device;
+    PdfReference m_objref;
     OutputStream* m_outputStream;
-    std::unique_ptr<OutputStream> m_outputStreamStore;
 };
 
 PdfStreamedObjectStream::PdfStreamedObjectStream(OutputStreamDevice& device) :
@@ -64,6 +84,8 @@ PdfStreamedObjectStream::PdfStreamedObjectStream(OutputStreamDevice& device) :
 {
 }
 
+PdfStreamedObjectStream::~PdfStreamedObjectStream() { }
+
 void PdfStreamedObjectStream::Init(PdfObject& obj)
 {
     // Prepare a /Length indirect object that will be set
@@ -98,15 +120,7 @@ unique_ptr<InputStream> PdfStreamedObjectStream::GetInputStream(PdfObject& obj)
 
 unique_ptr<OutputStream> PdfStreamedObjectStream::GetOutputStream(PdfObject& obj)
 {
-    if (m_CurrEncrypt == nullptr)
-    {
-        return std::make_unique<ObjectOutputStream>(*this, *m_Device);
-    }
-    else
-    {
-        return std::make_unique<ObjectOutputStream>(*this,
-            m_CurrEncrypt->CreateEncryptionOutputStream(*m_Device, obj.GetIndirectReference()));
-    }
+    return std::make_unique<ObjectOutputStream>(*this, *m_Device, obj.GetIndirectReference());
 }
 
 void PdfStreamedObjectStream::Write(OutputStream& stream, const PdfStatefulEncrypt& encrypt)
@@ -123,6 +137,18 @@ size_t PdfStreamedObjectStream::GetLength() const
 
 void PdfStreamedObjectStream::FinishOutput()
 {
+    if (m_EncryptStream != nullptr)
+    {
+        // Write the trailing encrypted data, eg. the last padded
+        // AES block. Streams of encryptions not deriving
+        // PdfEncryptOutputStream finish when disposed
+        auto encryptStream = dynamic_cast<PdfEncryptOutputStream*>(m_EncryptStream.get());
+        if (encryptStream != nullptr)
+            encryptStream->Finish();
+
+        m_EncryptStream = nullptr;
+    }
+
     if (m_CurrEncrypt != nullptr)
         m_Length = m_CurrEncrypt->CalculateStreamLength(m_Length);
 
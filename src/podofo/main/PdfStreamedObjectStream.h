@@ -13,6 +13,7 @@
 namespace PoDoFo {
 
 class OutputStreamDevice;
+class OutputStream;
 
 /** A PDF stream can be appended to any PdfObject
  *  and can contain arbitrary data.
@@ -44,6 +45,8 @@ private:
     PdfStreamedObjectStream(OutputStreamDevice& device);
 
 public:
+    ~PdfStreamedObjectStream();
+
     void Init(PdfObject& obj) override;
 
     void Clear() override;
@@ -68,11 +71,15 @@ private:
      */
     void SetEncrypted(PdfEncrypt& encrypt);
 
+    /** Finish the encryption, if any, and set the /Length
+     *  of the stream. Called when the stream append is ended
+     */
     void FinishOutput();
 
 private:
     OutputStreamDevice* m_Device;
     PdfEncrypt* m_CurrEncrypt;
+    std::unique_ptr<OutputStream> m_EncryptStream;
     size_t m_Length;
     PdfObject* m_LengthObj;
 };
@@ -0,0 +1,296 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <podofo/private/PdfDeclarationsPrivate.h>
+#include "PdfTextExtractSession.h"
+
+#include <podofo/private/ParallelUtils.h>
+
+#include "PdfDocument.h"
+#include "PdfFont.h"
+#include "PdfXObjectForm.h"
+
+using namespace std;
+using namespace PoDoFo;
+
+// Longer strings are rarely shown again, don't cache them
+static constexpr size_t MAX_CACHED_STRING_LENGTH = 256;
+
+static void preloadObject(const PdfObject& obj, unordered_set<const PdfObject*>& visited);
+static void preloadFont(const PdfFont& font);
+
+PdfTextExtractSession::PdfTextExtractSession(const PdfDocument& doc)
+    : m_doc(&doc), m_threadCount(1)
+{
+}
+
+void PdfTextExtractSession::ExtractTextTo(vector<PdfTextEntry>& entries,
+    unsigned pageIndex, unsigned pageCount, const string_view& pattern,
+    const PdfTextExtractParams& params)
+{
+    ExtractTextTo([&entries](PdfTextEntry&& entry) {
+        entries.push_back(std::move(entry));
+    }, pageIndex, pageCount, pattern, params);
+}
+
+void PdfTextExtractSession::ExtractTextTo(vector<PdfTextEntry>& entries,
+    const string_view& pattern, const PdfTextExtractParams& params)
+{
+    ExtractTextTo(entries, 0, m_doc->GetPages().GetCount(), pattern, params);
+}
+
+void PdfTextExtractSession::ExtractTextTo(const PdfTextEntryHandler& handler,
+    unsigned pageIndex, unsigned pageCount, const string_view& pattern,
+    const PdfTextExtractParams& params)
+{
+    auto& pages = m_doc->GetPages();
+    if (pageIndex + pageCount > pages.GetCount() || pageIndex + pageCount < pageIndex)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::PageNotFound, "Page range {}-{} out of range", pageIndex, pageIndex + pageCount);
+
+    if (m_threadCount == 1 || pageCount < 2)
+    {
+        for (unsigned i = 0; i < pageCount; i++)
+            pages.GetPageAt(pageIndex + i).extractTextTo(handler, pattern, params, this);
+
+        return;
+    }
+
+    // Pages, lazily loaded objects and fonts are not safe to be
+    // loaded concurrently, so we load what's needed upfront
+    vector<const PdfPage*> pagesToExtract(pageCount);
+    ObjectSet visited;
+    for (unsigned i = 0; i < pageCount; i++)
+    {
+        auto& page = pages.GetPageAt(pageIndex + i);
+        preloadPage(page, visited);
+        pagesToExtract[i] = &page;
+    }
+
+    vector<vector<PdfTextEntry>> pageEntries(pageCount);
+    utls::ParallelFor(pageCount, m_threadCount, [&](size_t i)
+    {
+        auto& entries = pageEntries[i];
+        pagesToExtract[i]->extractTextTo([&entries](PdfTextEntry&& entry) {
+            entries.push_back(std::move(entry));
+        }, pattern, params, this);
+    });
+
+    for (auto& currEntries : pageEntries)
+    {
+        for (auto& entry : currEntries)
+            handler(std::move(entry));
+    }
+}
+
+void PdfTextExtractSession::ExtractTextTo(const PdfTextEntryHandler& handler,
+    const string_view& pattern, const PdfTextExtractParams& params)
+{
+    ExtractTextTo(handler, 0, m_doc->GetPages().GetCount(), pattern, params);
+}
+
+const PdfFont* PdfTextExtractSession::GetFont(const PdfResources& resources, const PdfName& name)
+{
+    // NOTE: Fonts may be still missing after preloading, eg. if
+    // the font is not in the resources, and the font manager is
+    // not thread safe. Lock to support the concurrent extraction
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // NOTE: The same resources dictionary is usually shared
+    // between pages or XObject forms invocations
+    auto& fonts = m_fonts[&resources.GetDictionary()];
+    auto found = fonts.find(name);
+    if (found != fonts.end())
+        return found->second;
+
+    auto font = resources.GetFont(name);
+    if (font != nullptr && m_threadCount != 1)
+        preloadFont(*font);
+
+    fonts.emplace(name, font);
+    return font;
+}
+
+bool PdfTextExtractSession::ScanString(const PdfFont& font, const PdfString& encodedStr,
+    const PdfTextState& state, string& utf8str, vector<double>& lengths, vector<unsigned>& positions)
+{
+    auto& raw = encodedStr.GetRawData();
+    if (raw.length() > MAX_CACHED_STRING_LENGTH)
+        return font.TryScanEncodedString(encodedStr, state, utf8str, lengths, positions);
+
+    bool success;
+    {
+        // NOTE: Lock to support the concurrent extraction. The
+        // scan result doesn't depend on the text state, so the
+        // same string shown with the same font is decoded once
+        std::lock_guard<std::mutex> lock(m_stringsMutex);
+        auto& strings = m_strings[&font];
+        auto found = strings.find(raw);
+        if (found == strings.end())
+        {
+            ScannedString scanned;
+            scanned.Success = font.TryScanEncodedString(encodedStr,
+                scanned.Decoded, scanned.RawLengths, scanned.Positions);
+            found = strings.emplace(raw, std::move(scanned)).first;
+        }
+
+        auto& scanned = found->second;
+        utf8str = scanned.Decoded;
+        lengths = scanned.RawLengths;
+        positions = scanned.Positions;
+        success = scanned.Success;
+    }
+
+    for (auto& length : lengths)
+        length = PdfFont::GetGlyphLength(length, state);
+
+    return success;
+}
+
+void PdfTextExtractSession::Clear()
+{
+    m_fonts.clear();
+    m_strings.clear();
+}
+
+void PdfTextExtractSession::SetThreadCount(unsigned threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+void PdfTextExtractSession::preloadPage(const PdfPage& page, ObjectSet& visited)
+{
+    auto contents = page.GetContents();
+    if (contents != nullptr)
+        preloadObject(contents->GetObject(), visited);
+
+    auto resources = page.GetResources();
+    if (resources != nullptr)
+        preloadResources(*resources, visited);
+}
+
+void PdfTextExtractSession::preloadResources(const PdfResources& resources, ObjectSet& visited)
+{
+    if (m_fonts.find(&resources.GetDictionary()) != m_fonts.end())
+    {
+        // Resources already loaded
+        return;
+    }
+
+    preloadObject(resources.GetObject(), visited);
+    auto& fonts = m_fonts[&resources.GetDictionary()];
+    const PdfDictionary* dict;
+    auto fontsObj = resources.GetDictionary().FindKey("Font");
+    if (fontsObj != nullptr && fontsObj->TryGetDictionary(dict))
+    {
+        for (auto& pair : *dict)
+        {
+            const PdfFont* font = nullptr;
+            try
+            {
+                font = resources.GetFont(pair.first);
+            }
+            catch (PdfError&)
+            {
+                // Leave the font missing, the extraction
+                // will report the issue
+                continue;
+            }
+
+            if (font != nullptr)
+                preloadFont(*font);
+
+            fonts.emplace(pair.first, font);
+        }
+    }
+
+    auto xobjectsObj = resources.GetDictionary().FindKey("XObject");
+    if (xobjectsObj != nullptr && xobjectsObj->TryGetDictionary(dict))
+    {
+        for (auto& pair : dict->GetIndirectIterator())
+        {
+            unique_ptr<const PdfXObjectForm> form;
+            if (pair.second == nullptr
+                || !PdfXObject::TryCreateFromObject(*pair.second, form)
+                || form->GetResources() == nullptr)
+            {
+                continue;
+            }
+
+            preloadResources(*form->GetResources(), visited);
+        }
+    }
+}
+
+// Initialize the state that fonts, their metrics and encodings
+// lazily compute on first use, so the workers only read it
+void preloadFont(const PdfFont& font)
+{
+    (void)font.GetWordSpacingLength(PdfTextState());
+
+    auto& metrics = font.GetMetrics();
+    FT_Face face;
+    (void)metrics.TryGetOrLoadFace(face);
+    (void)metrics.GetBaseFontName();
+    (void)metrics.GetBaseFontNameSafe();
+    (void)metrics.GetStyle();
+
+    // NOTE: The first char code lookup builds the
+    // reverse lookup structures of the maps
+    PdfCharCode code;
+    auto& encoding = font.GetEncoding();
+    try
+    {
+        (void)encoding.GetEncodingMap().TryGetCharCode(U' ', code);
+        const PdfEncodingMap* toUnicode;
+        if (encoding.GetToUnicodeMapSafe(toUnicode))
+            (void)toUnicode->TryGetCharCode(U' ', code);
+    }
+    catch (PdfError&)
+    {
+        // Some maps, eg. the null encoding, don't support
+        // the reverse lookup and have nothing to initialize
+    }
+}
+
+// Force the loading of all the objects reachable from
+// the given one, including streams
+void preloadObject(const PdfObject& obj, unordered_set<const PdfObject*>& visited)
+{
+    vector<const PdfObject*> stack = { &obj };
+    while (stack.size() != 0)
+    {
+        auto curr = stack.back();
+        stack.pop_back();
+        if (!visited.insert(curr).second)
+            continue;
+
+        // NOTE: This forces the loading of the object
+        // and of the stream, if present
+        (void)curr->GetStream();
+
+        const PdfDictionary* dict;
+        const PdfArray* arr;
+        if (curr->TryGetDictionary(dict))
+        {
+            for (auto& pair : dict->GetIndirectIterator())
+            {
+                // Don't climb the page tree
+                if (pair.first == PdfName::KeyParent || pair.second == nullptr)
+                    continue;
+
+                stack.push_back(pair.second);
+            }
+        }
+        else if (curr->TryGetArray(arr))
+        {
+            for (auto child : arr->GetIndirectIterator())
+            {
+                if (child != nullptr)
+                    stack.push_back(child);
+            }
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#ifndef PDF_TEXT_EXTRACT_SESSION_H
+#define PDF_TEXT_EXTRACT_SESSION_H
+
+#include "PdfPage.h"
+#include "PdfTextState.h"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace PoDoFo {
+
+class PdfDocument;
+class PdfFont;
+
+/** A document level text extraction session
+ *
+ * It caches across pages the fonts resolved by the resources,
+ * and by font the decoded text and the glyphs widths of the
+ * shown strings, so extracting the text of many pages sharing
+ * the same fonts and strings doesn't repeat the resources
+ * lookups and the strings decoding
+ * \remarks The document should not be modified while
+ * the session is in use
+ */
+class PODOFO_API PdfTextExtractSession final
+{
+public:
+    PdfTextExtractSession(const PdfDocument& doc);
+
+public:
+    /** Extract text from a range of pages
+     * The entries are returned in page order, also
+     * when the pages are extracted concurrently
+     * \param pageIndex the index of the first page
+     * \param pageCount the number of pages
+     * \see SetThreadCount
+     */
+    void ExtractTextTo(std::vector<PdfTextEntry>& entries,
+        unsigned pageIndex, unsigned pageCount,
+        const std::string_view& pattern = { },
+        const PdfTextExtractParams& params = { });
+
+    /** Extract text from all the pages of the document
+     */
+    void ExtractTextTo(std::vector<PdfTextEntry>& entries,
+        const std::string_view& pattern = { },
+        const PdfTextExtractParams& params = { });
+
+    /** Extract text from a range of pages, pushing each entry
+     * to the given handler as soon as it is finalized
+     * \remarks When pages are extracted concurrently the entries
+     * of each page are buffered, and the handler is invoked in
+     * page order from the calling thread
+     */
+    void ExtractTextTo(const PdfTextEntryHandler& handler,
+        unsigned pageIndex, unsigned pageCount,
+        const std::string_view& pattern = { },
+        const PdfTextExtractParams& params = { });
+
+    /** Extract text from all the pages of the document, pushing
+     * each entry to the given handler as soon as it is finalized
+     */
+    void ExtractTextTo(const PdfTextEntryHandler& handler,
+        const std::string_view& pattern = { },
+        const PdfTextExtractParams& params = { });
+
+    /** Get a font from the given resources, caching the result
+     * \returns the font or nullptr if the font couldn't be loaded
+     */
+    const PdfFont* GetFont(const PdfResources& resources, const PdfName& name);
+
+    /** Decode a string with the given font, caching the decoded
+     * text and the glyphs raw widths
+     * \param lengths lengths of the glyphs in the given state
+     * \param positions position of the CIDs in the utf8string
+     * \see PdfFont::TryScanEncodedString
+     */
+    bool ScanString(const PdfFont& font, const PdfString& encodedStr, const PdfTextState& state,
+        std::string& utf8str, std::vector<double>& lengths, std::vector<unsigned>& positions);
+
+    /** Clear all the cached fonts and strings
+     */
+    void Clear();
+
+    /** Set the number of threads used to extract text from
+     * page ranges. When more than one thread is used, the objects
+     * needed by the requested pages are loaded and the fonts
+     * are resolved upfront, then pages are extracted concurrently
+     * \remarks Fonts are shared by the workers and only their
+     * state known to be lazily initialized is warmed upfront.
+     * Fonts, or their metrics, shared with other documents
+     * must not be used elsewhere during the extraction
+     * \param threadCount number of threads. 0 means hardware
+     *     concurrency, 1 (default) means serial extraction
+     */
+    void SetThreadCount(unsigned threadCount);
+
+    unsigned GetThreadCount() const { return m_threadCount; }
+
+    const PdfDocument& GetDocument() const { return *m_doc; }
+
+private:
+    PdfTextExtractSession(const PdfTextExtractSession&) = delete;
+    PdfTextExtractSession& operator=(const PdfTextExtractSession&) = delete;
+
+private:
+    using FontMap = std::unordered_map<PdfName, const PdfFont*>;
+    using ObjectSet = std::unordered_set<const PdfObject*>;
+
+    struct ScannedString
+    {
+        std::string Decoded;
+        std::vector<double> RawLengths;
+        std::vector<unsigned> Positions;
+        bool Success;
+    };
+
+    using ScannedStringMap = std::unordered_map<std::string, ScannedString>;
+
+private:
+    void preloadPage(const PdfPage& page, ObjectSet& visited);
+    void preloadResources(const PdfResources& resources, ObjectSet& visited);
+
+private:
+    const PdfDocument* m_doc;
+    unsigned m_threadCount;
+    std::mutex m_mutex;
+    // Map of fonts, by resources dictionary
+    std::unordered_map<const PdfDictionary*, FontMap> m_fonts;
+    std::mutex m_stringsMutex;
+    // Map of decoded strings, by font
+    std::unordered_map<const PdfFont*, ScannedStringMap> m_strings;
+};
+
+}
+
+#endif // PDF_TEXT_EXTRACT_SESSION_H
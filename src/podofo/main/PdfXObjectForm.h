@@ -19,6 +19,7 @@ class PODOFO_API PdfXObjectForm final : public PdfXObject, public PdfCanvas
 {
     friend class PdfDocument;
     friend class PdfXObject;
+    friend class PdfPage;
 
 private:
     /** Create a new XObject with a specified dimension
@@ -113,6 +113,7 @@
 #include "main/PdfOutlines.h"
 #include "main/PdfPage.h"
 #include "main/PdfPageCollection.h"
+#include "main/PdfTextExtractSession.h"
 #include "main/PdfPainterTextObject.h"
 #include "main/PdfPainterPath.h"
 #include "main/PdfPainter.h"
@@ -10,6 +10,23 @@
 using namespace std;
 using namespace PoDoFo;
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PODOFO_HAVE_SSSE3
+#include <tmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SSSE3_TARGET
+#else
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PODOFO_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+// Index of the alpha channel in the channel maps
+constexpr signed char AlphaChannel = -1;
+
 #ifdef PODOFO_IS_LITTLE_ENDIAN
 #define FETCH_BIT(bytes, idx) ((bytes[idx / 8] >> (7 - (idx % 8))) & 1)
 #else // PODOFO_IS_BIG_ENDIAN
@@ -18,20 +35,17 @@ using namespace PoDoFo;
 
 template <int bpp>
 static void fetchScanLineRGB(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width);
-template <int bpp>
-static void fetchScanLineRGB(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine);
+    const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine = nullptr);
 static void fetchScanLineGrayScale(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width);
-static void fetchScanLineGrayScale(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width,
-    const unsigned char* srcAphaLine);
-static void fetchScanLineBW(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width);
+    const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine = nullptr);
 static void fetchScanLineBW(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width,
-    const unsigned char* srcAphaLine);
+    const unsigned char* srcScanLine, unsigned width, unsigned char* grayScanLine,
+    const unsigned char* srcAphaLine = nullptr);
+static const signed char* getRGBChannels(PdfPixelFormat format, unsigned& pixelSize);
+static const signed char* getGrayScaleChannels(PdfPixelFormat format, unsigned& pixelSize);
+static unsigned convertScanLineVectorized(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize, const signed char* channels,
+    unsigned width, const unsigned char* alphaLine);
 
 static charbuff initScanLine(PdfPixelFormat format, unsigned width, int scanLineSizeHint);
 
@@ -172,6 +186,7 @@ void utls::FetchImageCCITT(OutputStream& stream, PdfPixelFormat format, int scan
     fxcodec::ScanlineDecoder& decoder, unsigned width, unsigned heigth, const charbuff& smaskData)
 {
     charbuff scanLine = initScanLine(format, width, scanLineSize);
+    charbuff grayScanLine(width);
 
     if (smaskData.size() == 0)
     {
@@ -179,7 +194,8 @@ void utls::FetchImageCCITT(OutputStream& stream, PdfPixelFormat format, int scan
         {
             auto scanLineBW = decoder.GetScanline(i);
             fetchScanLineBW((unsigned char*)scanLine.data(),
-                format, (const unsigned char*)scanLineBW.data(), width);
+                format, (const unsigned char*)scanLineBW.data(), width,
+                (unsigned char*)grayScanLine.data());
             stream.Write(scanLine.data(), scanLine.size());
         }
     }
@@ -189,7 +205,7 @@ void utls::FetchImageCCITT(OutputStream& stream, PdfPixelFormat format, int scan
         {
             auto scanLineBW = decoder.GetScanline(i);
             fetchScanLineBW((unsigned char*)scanLine.data(),
-                format, scanLineBW.data(), width,
+                format, scanLineBW.data(), width, (unsigned char*)grayScanLine.data(),
                 (const unsigned char*)smaskData.data() + i * width);
             stream.Write(scanLine.data(), scanLine.size());
         }
@@ -295,379 +311,430 @@ void utls::FetchImageJPEG(OutputStream& stream, PdfPixelFormat format, int scanL
 
 #endif // PODOFO_HAVE_JPEG_LIB
 
-template <int bpp>
-void fetchScanLineRGB(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width)
+void utls::ConvertScanLine(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize,
+    const signed char* channels, unsigned width, const unsigned char* alphaLine)
 {
-    switch (format)
+    if (dstPixelSize == srcPixelSize)
     {
-        case PdfPixelFormat::RGB24:
+        unsigned i = 0;
+        for (; i < dstPixelSize; i++)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * bpp + 2];
-            }
-            break;
+            if (channels[i] != (signed char)i)
+                break;
         }
-        case PdfPixelFormat::BGR24:
+
+        if (i == dstPixelSize)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * bpp + 0];
-            }
-            break;
+            // Same layout, just copy the pixels
+            std::memcpy(dstScanLine, srcScanLine, (size_t)width * dstPixelSize);
+            return;
         }
-        case PdfPixelFormat::RGBA:
+    }
+
+    // Convert the bulk of the line with the vectorized
+    // kernel, if available, and the remaining pixels here
+    for (unsigned i = convertScanLineVectorized(dstScanLine, dstPixelSize,
+        srcScanLine, srcPixelSize, channels, width, alphaLine); i < width; i++)
+    {
+        auto dst = dstScanLine + (size_t)i * dstPixelSize;
+        auto src = srcScanLine + (size_t)i * srcPixelSize;
+        for (unsigned j = 0; j < dstPixelSize; j++)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 3] = 255;
-            }
-            break;
+            if (channels[j] == AlphaChannel)
+                dst[j] = alphaLine == nullptr ? 255 : alphaLine[i];
+            else
+                dst[j] = src[channels[j]];
         }
-        case PdfPixelFormat::BGRA:
+    }
+}
+
+void utls::ConvertScanLineBW(unsigned char* dstScanLine, const unsigned char* srcScanLine, unsigned width)
+{
+    // Table of the 8 grayscale pixels for every byte of 1 bit pixels
+    struct BWTable
+    {
+        BWTable()
         {
-            for (unsigned i = 0; i < width; i++)
+            for (unsigned i = 0; i < 256; i++)
             {
-                dstScanLine[i * 4 + 0] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 3] = 255;
+                unsigned char byte = (unsigned char)i;
+                for (unsigned j = 0; j < 8; j++)
+                    Pixels[i][j] = (unsigned char)(FETCH_BIT((&byte), j) * 255);
             }
-            break;
         }
-        case PdfPixelFormat::ARGB:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = 255;
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 3] = srcScanLine[i * bpp + 2];
+
+        unsigned char Pixels[256][8];
+    };
+    static BWTable table;
+
+    unsigned byteCount = width / 8;
+    for (unsigned i = 0; i < byteCount; i++)
+        std::memcpy(dstScanLine + i * 8, table.Pixels[srcScanLine[i]], 8);
+
+    for (unsigned i = byteCount * 8; i < width; i++)
+        dstScanLine[i] = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
+}
+
+utls::PngPredictorWriter::PngPredictorWriter(OutputStream& stream, unsigned rowSize, unsigned bytesPerPixel)
+    : m_stream(&stream), m_rowSize(rowSize), m_bytesPerPixel(bytesPerPixel),
+    m_prior(rowSize), m_candidate(rowSize), m_best((size_t)rowSize + 1)
+{
+}
+
+void utls::PngPredictorWriter::WriteRow(const unsigned char* row)
+{
+    unsigned bpp = m_bytesPerPixel;
+    const unsigned char* prior = m_prior.data();
+    unsigned bestSum = numeric_limits<unsigned>::max();
+    for (unsigned char type = 0; type < 5; type++)
+    {
+        unsigned sum = 0;
+        for (unsigned j = 0; j < m_rowSize; j++)
+        {
+            int left = j < bpp ? 0 : row[j - bpp];
+            int up = prior[j];
+            int upLeft = j < bpp ? 0 : prior[j - bpp];
+            int predictor;
+            switch (type)
+            {
+                case 1:
+                    predictor = left;
+                    break;
+                case 2:
+                    predictor = up;
+                    break;
+                case 3:
+                    predictor = (left + up) / 2;
+                    break;
+                case 4:
+                {
+                    int p = left + up - upLeft;
+                    int pa = std::abs(p - left);
+                    int pb = std::abs(p - up);
+                    int pc = std::abs(p - upLeft);
+                    predictor = pa <= pb && pa <= pc ? left : (pb <= pc ? up : upLeft);
+                    break;
+                }
+                default:
+                    predictor = 0;
+                    break;
             }
-            break;
+
+            auto value = (unsigned char)(row[j] - predictor);
+            m_candidate[j] = value;
+            sum += (unsigned)std::abs((int)(signed char)value);
         }
-        case PdfPixelFormat::ABGR:
+
+        if (sum < bestSum)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = 255;
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 3] = srcScanLine[i * bpp + 0];
-            }
-            break;
+            bestSum = sum;
+            m_best[0] = type;
+            std::memcpy(m_best.data() + 1, m_candidate.data(), m_rowSize);
         }
-        default:
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
     }
+
+    m_stream->Write((const char*)m_best.data(), m_best.size());
+    std::memcpy(m_prior.data(), row, m_rowSize);
+}
+
+PdfDictionary utls::CreatePngPredictorParms(unsigned colors, unsigned bitsPerComponent, unsigned columns)
+{
+    PdfDictionary ret;
+    ret.AddKey("Predictor", static_cast<int64_t>(15));
+    ret.AddKey("Colors", static_cast<int64_t>(colors));
+    ret.AddKey("BitsPerComponent", static_cast<int64_t>(bitsPerComponent));
+    ret.AddKey("Columns", static_cast<int64_t>(columns));
+    return ret;
 }
 
 template <int bpp>
 void fetchScanLineRGB(unsigned char* dstScanLine, PdfPixelFormat format,
     const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine)
 {
+    // TODO: Handle alpha with RGB24/BGR24?
+    unsigned pixelSize;
+    auto channels = getRGBChannels(format, pixelSize);
+    utls::ConvertScanLine(dstScanLine, pixelSize, srcScanLine, bpp, channels, width, srcAphaLine);
+}
+
+void fetchScanLineGrayScale(unsigned char* dstScanLine, PdfPixelFormat format,
+    const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine)
+{
+    // TODO: Handle alpha with Grayscale, RGB24/BGR24?
+    unsigned pixelSize;
+    auto channels = getGrayScaleChannels(format, pixelSize);
+    utls::ConvertScanLine(dstScanLine, pixelSize, srcScanLine, 1, channels, width, srcAphaLine);
+}
+
+void fetchScanLineBW(unsigned char* dstScanLine, PdfPixelFormat format,
+    const unsigned char* srcScanLine, unsigned width, unsigned char* grayScanLine,
+    const unsigned char* srcAphaLine)
+{
+    if (format == PdfPixelFormat::Grayscale)
+    {
+        utls::ConvertScanLineBW(dstScanLine, srcScanLine, width);
+        return;
+    }
+
+    utls::ConvertScanLineBW(grayScanLine, srcScanLine, width);
+    fetchScanLineGrayScale(dstScanLine, format, grayScanLine, width, srcAphaLine);
+}
+
+const signed char* getRGBChannels(PdfPixelFormat format, unsigned& pixelSize)
+{
+    static const signed char RGB[] = { 0, 1, 2 };
+    static const signed char BGR[] = { 2, 1, 0 };
+    static const signed char RGBA[] = { 0, 1, 2, AlphaChannel };
+    static const signed char BGRA[] = { 2, 1, 0, AlphaChannel };
+    static const signed char ARGB[] = { AlphaChannel, 0, 1, 2 };
+    static const signed char ABGR[] = { AlphaChannel, 2, 1, 0 };
     switch (format)
     {
-        // TODO: Handle alpha?
         case PdfPixelFormat::RGB24:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * bpp + 2];
-            }
-            break;
-        }
-        // TODO: Handle alpha?
+            pixelSize = 3;
+            return RGB;
         case PdfPixelFormat::BGR24:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 3 + 0] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 3 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 3 + 2] = srcScanLine[i * bpp + 0];
-            }
-            break;
-        }
+            pixelSize = 3;
+            return BGR;
         case PdfPixelFormat::RGBA:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 3] = srcAphaLine[i];
-            }
-            break;
-        }
+            pixelSize = 4;
+            return RGBA;
         case PdfPixelFormat::BGRA:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 3] = srcAphaLine[i];
-            }
-            break;
-        }
+            pixelSize = 4;
+            return BGRA;
         case PdfPixelFormat::ARGB:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = srcAphaLine[i];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 0];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 3] = srcScanLine[i * bpp + 2];
-            }
-            break;
-        }
+            pixelSize = 4;
+            return ARGB;
         case PdfPixelFormat::ABGR:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                dstScanLine[i * 4 + 0] = srcAphaLine[i];
-                dstScanLine[i * 4 + 1] = srcScanLine[i * bpp + 2];
-                dstScanLine[i * 4 + 2] = srcScanLine[i * bpp + 1];
-                dstScanLine[i * 4 + 3] = srcScanLine[i * bpp + 0];
-            }
-            break;
-        }
+            pixelSize = 4;
+            return ABGR;
         default:
             PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
     }
 }
 
-void fetchScanLineGrayScale(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width)
+const signed char* getGrayScaleChannels(PdfPixelFormat format, unsigned& pixelSize)
 {
+    static const signed char Gray[] = { 0, 0, 0 };
+    static const signed char GrayAlpha[] = { 0, 0, 0, AlphaChannel };
+    static const signed char AlphaGray[] = { AlphaChannel, 0, 0, 0 };
     switch (format)
     {
         case PdfPixelFormat::Grayscale:
-        {
-            for (unsigned i = 0; i < width; i++)
-                dstScanLine[i] = srcScanLine[i];
-            break;
-        }
+            pixelSize = 1;
+            return Gray;
         case PdfPixelFormat::RGB24:
         case PdfPixelFormat::BGR24:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 3 + 0] = gray;
-                dstScanLine[i * 3 + 1] = gray;
-                dstScanLine[i * 3 + 2] = gray;
-            }
-            break;
-        }
+            pixelSize = 3;
+            return Gray;
         case PdfPixelFormat::RGBA:
         case PdfPixelFormat::BGRA:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 4 + 0] = gray;
-                dstScanLine[i * 4 + 1] = gray;
-                dstScanLine[i * 4 + 2] = gray;
-                dstScanLine[i * 4 + 3] = 255;
-            }
-            break;
-        }
+            pixelSize = 4;
+            return GrayAlpha;
         case PdfPixelFormat::ARGB:
         case PdfPixelFormat::ABGR:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 4 + 0] = 255;
-                dstScanLine[i * 4 + 1] = gray;
-                dstScanLine[i * 4 + 2] = gray;
-                dstScanLine[i * 4 + 3] = gray;
-            }
-            break;
-        }
+            pixelSize = 4;
+            return AlphaGray;
         default:
             PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
     }
 }
 
-void fetchScanLineGrayScale(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width, const unsigned char* srcAphaLine)
+#if defined(PODOFO_HAVE_SSSE3)
+
+static bool hasSsse3()
 {
-    switch (format)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+// Convert 4 pixels at a time, shuffling the source bytes, and the
+// alpha bytes, to their position in the destination pixels
+SSSE3_TARGET static unsigned convertScanLineSsse3(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize, const signed char* channels,
+    unsigned width, const unsigned char* alphaLine)
+{
+    alignas(16) signed char srcMask[16];
+    alignas(16) signed char alphaMask[16];
+    alignas(16) unsigned char opaque[16];
+    for (unsigned i = 0; i < 16; i++)
     {
-        // TODO: Handle alpha?
-        case PdfPixelFormat::Grayscale:
+        unsigned pixel = i / dstPixelSize;
+        signed char channel = channels[i % dstPixelSize];
+        if (pixel >= 4)
         {
-            for (unsigned i = 0; i < width; i++)
-                dstScanLine[i] = srcScanLine[i];
-            break;
+            srcMask[i] = -128;
+            alphaMask[i] = -128;
+            opaque[i] = 0;
         }
-        // TODO: Handle alpha?
-        case PdfPixelFormat::RGB24:
-        case PdfPixelFormat::BGR24:
+        else if (channel == AlphaChannel)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 3 + 0] = gray;
-                dstScanLine[i * 3 + 1] = gray;
-                dstScanLine[i * 3 + 2] = gray;
-            }
-            break;
+            srcMask[i] = -128;
+            alphaMask[i] = (signed char)pixel;
+            opaque[i] = 255;
         }
-        case PdfPixelFormat::RGBA:
-        case PdfPixelFormat::BGRA:
+        else
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 4 + 0] = gray;
-                dstScanLine[i * 4 + 1] = gray;
-                dstScanLine[i * 4 + 2] = gray;
-                dstScanLine[i * 4 + 3] = srcAphaLine[i];
-            }
-            break;
-        }
-        case PdfPixelFormat::ARGB:
-        case PdfPixelFormat::ABGR:
-        {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char gray = srcScanLine[i];
-                dstScanLine[i * 4 + 0] = srcAphaLine[i];
-                dstScanLine[i * 4 + 1] = gray;
-                dstScanLine[i * 4 + 2] = gray;
-                dstScanLine[i * 4 + 3] = gray;
-            }
-            break;
+            srcMask[i] = (signed char)(pixel * srcPixelSize + channel);
+            alphaMask[i] = -128;
+            opaque[i] = 0;
         }
-        default:
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
     }
-}
 
-void fetchScanLineBW(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width)
-{
-    switch (format)
+    __m128i srcShuffle = _mm_load_si128((const __m128i*)srcMask);
+    __m128i alphaShuffle = _mm_load_si128((const __m128i*)alphaMask);
+    __m128i opaqueBytes = _mm_load_si128((const __m128i*)opaque);
+
+    // Loads and stores are 16 bytes wide (4 bytes for
+    // grayscale sources), so don't overrun the lines
+    size_t srcLoadSize = srcPixelSize == 1 ? 4 : 16;
+    size_t srcLineSize = (size_t)width * srcPixelSize;
+    size_t dstLineSize = (size_t)width * dstPixelSize;
+    unsigned i = 0;
+    for (; (size_t)i * srcPixelSize + srcLoadSize <= srcLineSize
+        && (size_t)i * dstPixelSize + 16 <= dstLineSize; i += 4)
     {
-        case PdfPixelFormat::Grayscale:
+        __m128i pixels;
+        if (srcPixelSize == 1)
         {
-            for (unsigned i = 0; i < width; i++)
-                dstScanLine[i] = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-            break;
+            int gray;
+            std::memcpy(&gray, srcScanLine + i, 4);
+            pixels = _mm_cvtsi32_si128(gray);
         }
-        case PdfPixelFormat::RGB24:
-        case PdfPixelFormat::BGR24:
+        else
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 3 + 0] = value;
-                dstScanLine[i * 3 + 1] = value;
-                dstScanLine[i * 3 + 2] = value;
-            }
-            break;
+            pixels = _mm_loadu_si128((const __m128i*)(srcScanLine + (size_t)i * srcPixelSize));
         }
-        case PdfPixelFormat::RGBA:
-        case PdfPixelFormat::BGRA:
+
+        __m128i converted = _mm_shuffle_epi8(pixels, srcShuffle);
+        if (alphaLine == nullptr)
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 4 + 0] = value;
-                dstScanLine[i * 4 + 1] = value;
-                dstScanLine[i * 4 + 2] = value;
-                dstScanLine[i * 4 + 3] = 255;
-            }
-            break;
+            converted = _mm_or_si128(converted, opaqueBytes);
         }
-        case PdfPixelFormat::ARGB:
-        case PdfPixelFormat::ABGR:
+        else
         {
-            for (unsigned i = 0; i < width; i++)
-            {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 4 + 0] = 255;
-                dstScanLine[i * 4 + 1] = value;
-                dstScanLine[i * 4 + 2] = value;
-                dstScanLine[i * 4 + 3] = value;
-            }
-            break;
+            int alpha;
+            std::memcpy(&alpha, alphaLine + i, 4);
+            converted = _mm_or_si128(converted, _mm_shuffle_epi8(_mm_cvtsi32_si128(alpha), alphaShuffle));
         }
-        default:
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
+
+        _mm_storeu_si128((__m128i*)(dstScanLine + (size_t)i * dstPixelSize), converted);
     }
+
+    return i;
 }
 
-void fetchScanLineBW(unsigned char* dstScanLine, PdfPixelFormat format,
-    const unsigned char* srcScanLine, unsigned width,
-    const unsigned char* srcAphaLine)
+unsigned convertScanLineVectorized(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize, const signed char* channels,
+    unsigned width, const unsigned char* alphaLine)
 {
-    switch (format)
+    static bool supported = hasSsse3();
+    if (!supported || dstPixelSize > 4 || srcPixelSize > 4)
+        return 0;
+
+    return convertScanLineSsse3(dstScanLine, dstPixelSize, srcScanLine, srcPixelSize, channels, width, alphaLine);
+}
+
+#elif defined(PODOFO_HAVE_NEON)
+
+// Convert 16 pixels at a time, deinterleaving
+// the source channels and interleaving them back
+unsigned convertScanLineVectorized(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize, const signed char* channels,
+    unsigned width, const unsigned char* alphaLine)
+{
+    if ((srcPixelSize != 1 && srcPixelSize != 3 && srcPixelSize != 4)
+        || (dstPixelSize != 1 && dstPixelSize != 3 && dstPixelSize != 4))
     {
-        // TODO: Handle alpha?
-        case PdfPixelFormat::Grayscale:
-        {
-            for (unsigned i = 0; i < width; i++)
-                dstScanLine[i] = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-            break;
-        }
-        // TODO: Handle alpha?
-        case PdfPixelFormat::RGB24:
-        case PdfPixelFormat::BGR24:
+        return 0;
+    }
+
+    unsigned i = 0;
+    for (; i + 16 <= width; i += 16)
+    {
+        uint8x16_t src[4];
+        auto srcPixels = srcScanLine + (size_t)i * srcPixelSize;
+        switch (srcPixelSize)
         {
-            for (unsigned i = 0; i < width; i++)
+            case 1:
             {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 3 + 0] = value;
-                dstScanLine[i * 3 + 1] = value;
-                dstScanLine[i * 3 + 2] = value;
+                src[0] = vld1q_u8(srcPixels);
+                break;
             }
-            break;
-        }
-        case PdfPixelFormat::RGBA:
-        case PdfPixelFormat::BGRA:
-        {
-            for (unsigned i = 0; i < width; i++)
+            case 3:
             {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 4 + 0] = value;
-                dstScanLine[i * 4 + 1] = value;
-                dstScanLine[i * 4 + 2] = value;
-                dstScanLine[i * 4 + 3] = srcAphaLine[i];
+                auto loaded = vld3q_u8(srcPixels);
+                src[0] = loaded.val[0];
+                src[1] = loaded.val[1];
+                src[2] = loaded.val[2];
+                break;
+            }
+            default:
+            {
+                auto loaded = vld4q_u8(srcPixels);
+                src[0] = loaded.val[0];
+                src[1] = loaded.val[1];
+                src[2] = loaded.val[2];
+                src[3] = loaded.val[3];
+                break;
             }
-            break;
         }
-        case PdfPixelFormat::ARGB:
-        case PdfPixelFormat::ABGR:
+
+        uint8x16_t alpha = alphaLine == nullptr ? vdupq_n_u8(255) : vld1q_u8(alphaLine + i);
+        uint8x16_t dst[4];
+        for (unsigned j = 0; j < dstPixelSize; j++)
+            dst[j] = channels[j] == AlphaChannel ? alpha : src[channels[j]];
+
+        auto dstPixels = dstScanLine + (size_t)i * dstPixelSize;
+        switch (dstPixelSize)
         {
-            for (unsigned i = 0; i < width; i++)
+            case 1:
             {
-                unsigned char value = (unsigned char)(FETCH_BIT(srcScanLine, i) * 255);
-                dstScanLine[i * 4 + 0] = srcAphaLine[i];
-                dstScanLine[i * 4 + 1] = value;
-                dstScanLine[i * 4 + 2] = value;
-                dstScanLine[i * 4 + 3] = value;
+                vst1q_u8(dstPixels, dst[0]);
+                break;
+            }
+            case 3:
+            {
+                uint8x16x3_t stored = { { dst[0], dst[1], dst[2] } };
+                vst3q_u8(dstPixels, stored);
+                break;
+            }
+            default:
+            {
+                uint8x16x4_t stored = { { dst[0], dst[1], dst[2], dst[3] } };
+                vst4q_u8(dstPixels, stored);
+                break;
             }
-            break;
         }
-        default:
-            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::UnsupportedImageFormat, "Unsupported pixel format");
     }
+
+    return i;
 }
 
+#else
+
+unsigned convertScanLineVectorized(unsigned char* dstScanLine, unsigned dstPixelSize,
+    const unsigned char* srcScanLine, unsigned srcPixelSize, const signed char* channels,
+    unsigned width, const unsigned char* alphaLine)
+{
+    (void)dstScanLine;
+    (void)dstPixelSize;
+    (void)srcScanLine;
+    (void)srcPixelSize;
+    (void)channels;
+    (void)width;
+    (void)alphaLine;
+    return 0;
+}
+
+#endif
+
 charbuff initScanLine(PdfPixelFormat format, unsigned width, int scanLineSizeHint)
 {
     unsigned defaultScanLineSize;
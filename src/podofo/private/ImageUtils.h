@@ -9,6 +9,7 @@
 
 #include <podofo/auxiliary/OutputStream.h>
 #include <podofo/main/PdfColorSpace.h>
+#include <podofo/main/PdfDictionary.h>
 
 #ifdef PODOFO_HAVE_JPEG_LIB
 #include <podofo/private/JpegCommon.h>
@@ -18,6 +19,48 @@
 
 namespace utls
 {
+    /** Convert a scan line of 8 bit pixels, computing each channel
+     *  of the destination pixels from a channel of the source pixels
+     *  \param channels for each channel of the destination pixels, the
+     *      index of the source channel, or -1 for the alpha channel
+     *  \param alphaLine the alpha of the pixels, or nullptr for opaque pixels
+     *  \remarks The conversion is vectorized with SSSE3, detected at
+     *      runtime, or NEON when available
+     */
+    void ConvertScanLine(unsigned char* dstScanLine, unsigned dstPixelSize,
+        const unsigned char* srcScanLine, unsigned srcPixelSize,
+        const signed char* channels, unsigned width, const unsigned char* alphaLine = nullptr);
+
+    /** Convert a scan line of 1 bit pixels to 8 bit grayscale
+     */
+    void ConvertScanLineBW(unsigned char* dstScanLine, const unsigned char* srcScanLine, unsigned width);
+
+    /** Write scan lines encoded with PNG predictors, choosing for each
+     *  row the predictor with the minimum sum of absolute differences.
+     *  Only the previous row is retained, so images can be streamed
+     *  row by row
+     */
+    class PngPredictorWriter final
+    {
+    public:
+        PngPredictorWriter(PoDoFo::OutputStream& stream, unsigned rowSize, unsigned bytesPerPixel);
+
+    public:
+        void WriteRow(const unsigned char* row);
+
+    private:
+        PoDoFo::OutputStream* m_stream;
+        unsigned m_rowSize;
+        unsigned m_bytesPerPixel;
+        std::vector<unsigned char> m_prior;
+        std::vector<unsigned char> m_candidate;
+        std::vector<unsigned char> m_best;
+    };
+
+    /** Create the /DecodeParms of data encoded with a PngPredictorWriter
+     */
+    PoDoFo::PdfDictionary CreatePngPredictorParms(unsigned colors, unsigned bitsPerComponent, unsigned columns);
+
     /** Fetch a RGB image and write it to the stream
      */
     void FetchImage(PoDoFo::OutputStream& stream, PoDoFo::PdfPixelFormat format, int scanLineSize,
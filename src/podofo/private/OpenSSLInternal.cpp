@@ -0,0 +1,151 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2006 Dominik Seichter <domseichter@web.de>
+ * SPDX-FileCopyrightText: (C) 2020 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "PdfDeclarationsPrivate.h"
+#include "OpenSSLInternal.h"
+
+#include <openssl/opensslconf.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+#if OPENSSL_VERSION_MAJOR >= 3
+#include <openssl/provider.h>
+#endif // OPENSSL_VERSION_MAJOR >= 3
+
+class OpenSSLInit
+{
+public:
+    OpenSSLInit()
+    {
+#if OPENSSL_VERSION_MAJOR >= 3
+        m_libCtx = OSSL_LIB_CTX_new();
+        if (m_libCtx == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to create OpenSSL library context");
+
+        // NOTE: Load required legacy providers, such as RC4, together regular ones,
+        // as explained in https://wiki.openssl.org/index.php/OpenSSL_3.0#Providers
+        m_legacyProvider = OSSL_PROVIDER_load(m_libCtx, "legacy");
+        if (m_legacyProvider == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to load legacy providers in OpenSSL >= 3.x.x");
+
+        m_defaultProvider = OSSL_PROVIDER_load(m_libCtx, "default");
+        if (m_defaultProvider == nullptr)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InvalidHandle, "Unable to load default providers in OpenSSL >= 3.x.x");
+
+        // https://www.openssl.org/docs/man3.0/man7/crypto.html#FETCHING-EXAMPLES
+        Rc4 = EVP_CIPHER_fetch(m_libCtx, "RC4", "provider=legacy");
+        Aes128 = EVP_CIPHER_fetch(m_libCtx, "AES-128-CBC", "provider=default");
+        Aes256 = EVP_CIPHER_fetch(m_libCtx, "AES-256-CBC", "provider=default");
+        MD5 = EVP_MD_fetch(m_libCtx, "MD5", "provider=default");
+        SHA256 = EVP_MD_fetch(m_libCtx, "SHA2-256", "provider=default");
+        SHA384 = EVP_MD_fetch(m_libCtx, "SHA2-384", "provider=default");
+        SHA512 = EVP_MD_fetch(m_libCtx, "SHA2-512", "provider=default");
+
+#else // OPENSSL_VERSION_MAJOR < 3
+        Rc4 = EVP_rc4();
+        Aes128 = EVP_aes_128_cbc();
+        Aes256 = EVP_aes_256_cbc();
+        MD5 = EVP_md5();
+        SHA256 = EVP_sha256();
+        SHA384 = EVP_sha384();
+        SHA512 = EVP_sha512();
+#endif // OPENSSL_VERSION_MAJOR >= 3
+    }
+
+    ~OpenSSLInit()
+    {
+#if OPENSSL_VERSION_MAJOR >= 3
+        OSSL_PROVIDER_unload(m_legacyProvider);
+        OSSL_PROVIDER_unload(m_defaultProvider);
+        OSSL_LIB_CTX_free(m_libCtx);
+#endif // OPENSSL_VERSION_MAJOR >= 3
+    }
+public:
+    const EVP_CIPHER* Rc4;
+    const EVP_CIPHER* Aes128;
+    const EVP_CIPHER* Aes256;
+    const EVP_MD* MD5;
+    const EVP_MD* SHA256;
+    const EVP_MD* SHA384;
+    const EVP_MD* SHA512;
+private:
+#if OPENSSL_VERSION_MAJOR >= 3
+    OSSL_LIB_CTX *m_libCtx;
+    OSSL_PROVIDER *m_legacyProvider;
+    OSSL_PROVIDER *m_defaultProvider;
+#endif // OPENSSL_VERSION_MAJOR >= 3
+};
+
+static const OpenSSLInit& getInit();
+
+const EVP_CIPHER* ssl::Rc4()
+{
+    return getInit().Rc4;
+}
+
+const EVP_CIPHER* ssl::Aes128()
+{
+    return getInit().Aes128;
+}
+
+const EVP_CIPHER* ssl::Aes256()
+{
+    return getInit().Aes256;
+}
+
+const EVP_MD* ssl::MD5()
+{
+    return getInit().MD5;
+}
+
+const EVP_MD* ssl::SHA256()
+{
+    return getInit().SHA256;
+}
+
+const EVP_MD* ssl::SHA384()
+{
+    return getInit().SHA384;
+}
+
+const EVP_MD* ssl::SHA512()
+{
+    return getInit().SHA512;
+}
+
+charbuff ssl::ComputeHash(const EVP_MD* type, const string_view& header, InputStream& input)
+{
+    unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    if (ctx == nullptr || EVP_DigestInit_ex(ctx.get(), type, nullptr) != 1
+        || EVP_DigestUpdate(ctx.get(), header.data(), header.size()) != 1)
+    {
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error initializing the hashing engine");
+    }
+
+    char buffer[4096];
+    bool eof;
+    do
+    {
+        size_t read = input.Read(buffer, std::size(buffer), eof);
+        if (EVP_DigestUpdate(ctx.get(), buffer, read) != 1)
+            PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error computing the digest");
+    } while (!eof);
+
+    charbuff ret(EVP_MAX_MD_SIZE);
+    unsigned size;
+    if (EVP_DigestFinal_ex(ctx.get(), (unsigned char*)ret.data(), &size) != 1)
+        PODOFO_RAISE_ERROR_INFO(PdfErrorCode::InternalLogic, "Error computing the digest");
+
+    ret.resize(size);
+    return ret;
+}
+
+const OpenSSLInit& getInit()
+{
+    static OpenSSLInit s_init;
+    return s_init;
+}
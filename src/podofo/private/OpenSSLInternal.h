@@ -0,0 +1,33 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2006 Dominik Seichter <domseichter@web.de>
+ * SPDX-FileCopyrightText: (C) 2020 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef PODOFO_OPENSSL_INTERNAL_H
+#define PODOFO_OPENSSL_INTERNAL_H
+
+#include <openssl/evp.h>
+
+#include <podofo/main/PdfDeclarations.h>
+#include <podofo/auxiliary/InputStream.h>
+
+namespace ssl
+{
+    // Ciphers and message digests, fetched once from
+    // the library context of PoDoFo
+    const EVP_CIPHER* Rc4();
+    const EVP_CIPHER* Aes128();
+    const EVP_CIPHER* Aes256();
+    const EVP_MD* MD5();
+    const EVP_MD* SHA256();
+    const EVP_MD* SHA384();
+    const EVP_MD* SHA512();
+
+    /** Compute the digest of the header followed by all the input data
+     */
+    PoDoFo::charbuff ComputeHash(const EVP_MD* type, const std::string_view& header,
+        PoDoFo::InputStream& input);
+}
+
+#endif // PODOFO_OPENSSL_INTERNAL_H
@@ -0,0 +1,96 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef PARALLEL_UTILS_H
+#define PARALLEL_UTILS_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utls
+{
+    /** Get the effective number of worker threads to use
+     * \param threadCount requested thread count. 0 means hardware concurrency
+     * \param jobCount number of jobs to be processed
+     */
+    inline unsigned GetWorkerCount(unsigned threadCount, size_t jobCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+                threadCount = 1;
+        }
+
+        if (jobCount < threadCount)
+            return (unsigned)jobCount;
+
+        return threadCount;
+    }
+
+    /** Run the given functor for all indices in [0, count) using
+     * a bounded pool of worker threads. Indices are dispatched
+     * in increasing order. The calling thread participates in
+     * the work. The first exception thrown by a job is rethrown
+     * in the calling thread, after all workers have been joined
+     * \param threadCount max number of threads. 0 means hardware concurrency
+     */
+    template <typename TFunctor>
+    void ParallelFor(size_t count, unsigned threadCount, const TFunctor& functor)
+    {
+        unsigned workerCount = GetWorkerCount(threadCount, count);
+        if (workerCount <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                functor(i);
+
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::exception_ptr exception;
+        std::mutex mutex;
+        auto work = [&]()
+        {
+            while (!failed.load(std::memory_order_relaxed))
+            {
+                size_t i = next.fetch_add(1);
+                if (i >= count)
+                    break;
+
+                try
+                {
+                    functor(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (exception == nullptr)
+                        exception = std::current_exception();
+
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workerCount - 1);
+        for (unsigned i = 1; i < workerCount; i++)
+            threads.emplace_back(work);
+
+        work();
+        for (auto& thread : threads)
+            thread.join();
+
+        if (exception != nullptr)
+            std::rethrow_exception(exception);
+    }
+}
+
+#endif // PARALLEL_UTILS_H
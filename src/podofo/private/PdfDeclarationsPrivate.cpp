@@ -45,7 +45,6 @@ thread_local unsigned s_recursionDepth = 0;
 
 static const locale s_cachedLocale("C");
 
-extern PODOFO_IMPORT PdfLogSeverity s_MaxLogSeverity;
 extern PODOFO_IMPORT LogMessageCallback s_LogMessageCallback;
 
 static char getEscapedCharacter(char ch);
@@ -85,8 +84,13 @@ void formatTo(string& str, TInt value)
 
 void PoDoFo::LogMessage(PdfLogSeverity logSeverity, const string_view& msg)
 {
-    if (logSeverity > s_MaxLogSeverity)
+    if (!IsLogSeverityEnabled(logSeverity))
+    {
+        IncrementCounter(PdfInstrumentationCounter::SuppressedLogMessages);
         return;
+    }
+
+    IncrementCounter(PdfInstrumentationCounter::LogMessages);
 
     if (s_LogMessageCallback == nullptr)
     {
@@ -20,6 +20,7 @@
 #include <stdexcept>
 #include <limits>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 
 #include "Format.h"
@@ -31,6 +32,7 @@
 #define PODOFO_UNIT_TEST(classname) friend class classname
 
 #include <podofo/main/PdfDeclarations.h>
+#include <podofo/main/PdfCommon.h>
 
 #ifdef _WIN32
 // Microsft itself assumes little endian
@@ -134,6 +136,36 @@
         throw ::PoDoFo::PdfError(PdfErrorCode::InternalLogic, __FILE__, __LINE__, COMMON_FORMAT(msg, ##__VA_ARGS__));\
 };
 
+/** \def PODOFO_MAX_LOG_SEVERITY
+ *  The maximum severity of the log messages compiled in the library,
+ *  as the name of a PdfLogSeverity value. Messages with an higher
+ *  severity are discarded at compile time, eg. with
+ *  -DPODOFO_MAX_LOG_SEVERITY=Warning
+ */
+#ifndef PODOFO_MAX_LOG_SEVERITY
+#define PODOFO_MAX_LOG_SEVERITY Debug
+#endif // PODOFO_MAX_LOG_SEVERITY
+
+/** \def PODOFO_LOG(severity, msg, ...)
+ *
+ *  Log a message, checking the severity before the arguments are
+ *  evaluated and the message is formatted. Prefer it in hot loops
+ */
+#define PODOFO_LOG(severity, msg, ...) do {\
+    if (::PoDoFo::IsLogSeverityEnabled(severity))\
+        ::PoDoFo::LogMessage(severity, COMMON_FORMAT(msg, ##__VA_ARGS__));\
+    else\
+        ::PoDoFo::IncrementCounter(::PoDoFo::PdfInstrumentationCounter::SuppressedLogMessages);\
+} while (false)
+
+// Number of the values of PdfInstrumentationCounter
+constexpr unsigned InstrumentationCounterCount = (unsigned)PoDoFo::PdfInstrumentationCounter::ImportedObjects + 1;
+
+// NOTE: Exported, as they are accessed by inline functions
+extern PODOFO_API PoDoFo::PdfLogSeverity s_MaxLogSeverity;
+extern PODOFO_API std::atomic<bool> s_InstrumentationEnabled;
+extern PODOFO_API std::atomic<uint64_t> s_InstrumentationCounters[InstrumentationCounterCount];
+
 namespace PoDoFo
 {
     class OutputStream;
@@ -185,6 +217,23 @@ namespace PoDoFo
 
     std::string_view FilterToNameShort(PdfFilterType filterType);
 
+    /** Increment an instrumentation counter, only when
+     *  the instrumentation is enabled
+     */
+    inline void IncrementCounter(PdfInstrumentationCounter counter, uint64_t value = 1)
+    {
+        if (s_InstrumentationEnabled.load(std::memory_order_relaxed))
+            s_InstrumentationCounters[(unsigned)counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /** Check if messages with the given severity are logged. Severities
+     *  higher than PODOFO_MAX_LOG_SEVERITY are disabled at compile time
+     */
+    inline bool IsLogSeverityEnabled(PdfLogSeverity logSeverity)
+    {
+        return logSeverity <= PdfLogSeverity::PODOFO_MAX_LOG_SEVERITY && logSeverity <= s_MaxLogSeverity;
+    }
+
     /** Log a message to the logging system defined for PoDoFo.
      *  \param logSeverity the severity of the log message
      *  \param msg       the message to be logged
@@ -194,6 +243,13 @@ namespace PoDoFo
     template <typename... Args>
     void LogMessage(PdfLogSeverity logSeverity, const std::string_view& msg, const Args&... args)
     {
+        // Check the severity before formatting the message
+        if (!IsLogSeverityEnabled(logSeverity))
+        {
+            IncrementCounter(PdfInstrumentationCounter::SuppressedLogMessages);
+            return;
+        }
+
         LogMessage(logSeverity, COMMON_FORMAT(msg, args...));
     }
 }
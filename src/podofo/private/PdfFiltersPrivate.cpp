@@ -55,8 +55,10 @@ public:
         }
 
         m_CurrRowIndex = 0;
-        m_BytesPerPixel = (m_BitsPerComponent * m_Colors) >> 3;
-        m_Rows = (m_ColumnCount * m_Colors * m_BitsPerComponent) >> 3;
+        // Rows of less than 8 bits per pixel are padded to whole bytes,
+        // and predictors then work on single bytes
+        m_BytesPerPixel = (m_BitsPerComponent * m_Colors + 7) >> 3;
+        m_Rows = (m_ColumnCount * m_Colors * m_BitsPerComponent + 7) >> 3;
 
         // check for multiplication overflow on buffer sizes (e.g. if m_nBPC=2 and m_nColors=SIZE_MAX/2+1)
         if (utls::DoesMultiplicationOverflow(m_BitsPerComponent, m_Colors)
@@ -0,0 +1,178 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <catch.hpp>
+
+#include <podofo/private/PdfDeclarationsPrivate.h>
+#include <podofo/podofo.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+constexpr unsigned Width = 2000;
+constexpr unsigned Height = 2000;
+
+static charbuff createPixels(unsigned size);
+static unique_ptr<PdfImage> createImage(PdfDocument& doc, const PdfColorSpacePtr& colorSpace,
+    unsigned components, const PdfImage* softMask = nullptr);
+
+TEST_CASE("BenchmarkDecodeTo")
+{
+    PdfMemDocument doc;
+    auto softMask = createImage(doc, PdfColorSpaceFactory::GetDeviceGrayInstace(), 1);
+    auto rgbImg = createImage(doc, PdfColorSpaceFactory::GetDeviceRGBInstace(), 3);
+    auto rgbMaskedImg = createImage(doc, PdfColorSpaceFactory::GetDeviceRGBInstace(), 3, softMask.get());
+    auto grayImg = createImage(doc, PdfColorSpaceFactory::GetDeviceGrayInstace(), 1);
+    charbuff buffer;
+
+    BENCHMARK("RGB image to RGB24")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::RGB24);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image to BGR24")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::BGR24);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image to RGBA")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::RGBA);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image to BGRA")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::BGRA);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image to ARGB")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::ARGB);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image to ABGR")
+    {
+        rgbImg->DecodeTo(buffer, PdfPixelFormat::ABGR);
+        return buffer.size();
+    };
+
+    BENCHMARK("RGB image with soft mask to BGRA")
+    {
+        rgbMaskedImg->DecodeTo(buffer, PdfPixelFormat::BGRA);
+        return buffer.size();
+    };
+
+    BENCHMARK("Gray image to Grayscale")
+    {
+        grayImg->DecodeTo(buffer, PdfPixelFormat::Grayscale);
+        return buffer.size();
+    };
+
+    BENCHMARK("Gray image to RGB24")
+    {
+        grayImg->DecodeTo(buffer, PdfPixelFormat::RGB24);
+        return buffer.size();
+    };
+
+    BENCHMARK("Gray image to BGRA")
+    {
+        grayImg->DecodeTo(buffer, PdfPixelFormat::BGRA);
+        return buffer.size();
+    };
+
+    auto bgr = createPixels(Width * Height * 3);
+    auto img = doc.CreateImage();
+    BENCHMARK("Set BGR24 image data")
+    {
+        img->SetData(bgr, Width, Height, PdfPixelFormat::BGR24);
+        return img->GetWidth();
+    };
+}
+
+TEST_CASE("BenchmarkJpegDecodeTo")
+{
+    // Use a smooth image, closer to a photo than random pixels
+    charbuff rgb(Width * Height * 3);
+    for (unsigned i = 0; i < Height; i++)
+    {
+        for (unsigned j = 0; j < Width; j++)
+        {
+            auto pixel = rgb.data() + (i * Width + j) * 3;
+            pixel[0] = (char)(j / 8);
+            pixel[1] = (char)(i / 8);
+            pixel[2] = (char)((i + j) / 16);
+        }
+    }
+
+    PdfMemDocument doc;
+    auto rgbImg = doc.CreateImage();
+    rgbImg->SetData(rgb, Width, Height, PdfPixelFormat::RGB24);
+    charbuff jpeg;
+    rgbImg->ExportTo(jpeg, PdfExportFormat::Jpeg);
+    auto jpegImg = doc.CreateImage();
+    jpegImg->LoadFromBuffer(jpeg);
+    charbuff buffer;
+
+    BENCHMARK("JPEG image to RGB24")
+    {
+        jpegImg->DecodeTo(buffer, PdfPixelFormat::RGB24);
+        return buffer.size();
+    };
+
+    BENCHMARK("JPEG image to RGB24, 1/2 scale")
+    {
+        jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Half);
+        return buffer.size();
+    };
+
+    BENCHMARK("JPEG image to RGB24, 1/4 scale")
+    {
+        jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Quarter);
+        return buffer.size();
+    };
+
+    BENCHMARK("JPEG image to RGB24, 1/8 scale")
+    {
+        jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Eighth);
+        return buffer.size();
+    };
+
+    BENCHMARK("Export JPEG image")
+    {
+        jpegImg->ExportTo(buffer, PdfExportFormat::Jpeg);
+        return buffer.size();
+    };
+}
+
+charbuff createPixels(unsigned size)
+{
+    charbuff ret(size);
+    for (unsigned i = 0; i < size; i++)
+        ret[i] = (char)(i * 31 + i / 7);
+
+    return ret;
+}
+
+unique_ptr<PdfImage> createImage(PdfDocument& doc, const PdfColorSpacePtr& colorSpace,
+    unsigned components, const PdfImage* softMask)
+{
+    PdfImageInfo info;
+    info.Width = Width;
+    info.Height = Height;
+    info.BitsPerComponent = 8;
+    info.ColorSpace = colorSpace;
+    auto ret = doc.CreateImage();
+    ret->SetDataRaw(createPixels(Width * Height * components), info);
+    if (softMask != nullptr)
+        ret->SetSoftMask(*softMask);
+
+    return ret;
+}
@@ -0,0 +1,220 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <PdfTest.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+static vector<string> getAppearanceText(const PdfField& field);
+
+TEST_CASE("TestFindField")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& acroForm = doc.GetOrCreateAcroForm();
+        auto& name = acroForm.CreateField<PdfTextBox>("name");
+        REQUIRE(acroForm.FindField("name") == &name);
+        REQUIRE(acroForm.FindField("address") == nullptr);
+
+        // Fields created after the index has been built
+        auto& address = acroForm.CreateField<PdfTextBox>("address");
+        REQUIRE(acroForm.FindField("address") == &address);
+        auto& street = address.GetChildren().CreateChild();
+        street.SetName(PdfString("street"));
+        auto& city = address.GetChildren().CreateChild();
+        city.SetName(PdfString("city"));
+        REQUIRE(acroForm.FindField("address.street") == &street);
+        REQUIRE(acroForm.FindField("address.city") == &city);
+        REQUIRE(acroForm.FindField("city") == nullptr);
+
+        // Renamed fields
+        address.SetName(PdfString("home"));
+        REQUIRE(acroForm.FindField("address.city") == nullptr);
+        REQUIRE(acroForm.FindField("home.city") == &city);
+
+        // Removed fields
+        acroForm.RemoveField(name.GetObject().GetIndirectReference());
+        REQUIRE(acroForm.FindField("name") == nullptr);
+        REQUIRE(acroForm.FindField("home.street") == &street);
+        address.GetChildren().RemoveFieldAt(0);
+        REQUIRE(acroForm.FindField("home.street") == nullptr);
+        REQUIRE(acroForm.FindField("home.city") == &city);
+
+        StringStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    auto& acroForm = *doc.GetAcroForm();
+    auto field = acroForm.FindField("home.city");
+    REQUIRE(field != nullptr);
+    REQUIRE(field->GetFullName() == "home.city");
+    REQUIRE(acroForm.FindField("home") == &acroForm.GetFieldAt(0));
+    REQUIRE(acroForm.FindField("home.street") == nullptr);
+}
+
+TEST_CASE("TestFillFields")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        (void)page.CreateField<PdfTextBox>("name", Rect(100, 700, 200, 20));
+        auto& notes = page.CreateField<PdfTextBox>("notes", Rect(100, 600, 200, 60));
+        notes.SetMultiLine(true);
+        auto& country = page.CreateField<PdfComboBox>("country", Rect(100, 500, 200, 20));
+        country.InsertItem(PdfString("IT"), PdfString("Italy"));
+        country.InsertItem(PdfString("FR"), PdfString("France"));
+        (void)page.CreateField<PdfCheckBox>("agree", Rect(100, 400, 20, 20));
+
+        auto& acroForm = *doc.GetAcroForm();
+        ASSERT_THROW_WITH_ERROR_CODE(acroForm.FillFields({ { "missing", PdfString("value") } }), PdfErrorCode::InvalidName);
+        ASSERT_THROW_WITH_ERROR_CODE(acroForm.FillFields({ { "country", PdfString("DE") } }), PdfErrorCode::ValueOutOfRange);
+
+        INFO("No value is set if any of them is invalid");
+        ASSERT_THROW_WITH_ERROR_CODE(acroForm.FillFields({
+            { "name", PdfString("Jane Doe") },
+            { "missing", PdfString("value") },
+        }), PdfErrorCode::InvalidName);
+        REQUIRE(!acroForm.FindField("name")->GetDictionary().HasKey("V"));
+        REQUIRE(!acroForm.FindField("name")->GetDictionary().HasKey("AP"));
+
+        acroForm.FillFields({ { "name", PdfString("Jane Doe") } });
+        auto& oldAppearance = acroForm.FindField("name")->GetDictionary()
+            .MustFindKey("AP").GetDictionary().MustFindKey("N");
+        auto oldAppearanceRef = oldAppearance.GetIndirectReference();
+
+        PdfFieldsFillParams params;
+        params.ThreadCount = 2;
+        acroForm.FillFields({
+            { "name", PdfString("John Doe") },
+            { "notes", PdfString("First line\nSecond line") },
+            { "country", PdfString("FR") },
+            { "agree", PdfString("Yes") },
+        }, params);
+
+        INFO("The replaced appearance stream is removed");
+        REQUIRE(doc.GetObjects().GetObject(oldAppearanceRef) == nullptr);
+
+        StringStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    auto& acroForm = *doc.GetAcroForm();
+
+    auto& name = *acroForm.FindField("name");
+    REQUIRE(name.GetDictionary().MustFindKey("V").GetString().GetString() == "John Doe");
+    REQUIRE(getAppearanceText(name) == vector<string>{ "John Doe" });
+    REQUIRE(getAppearanceText(*acroForm.FindField("notes")) == vector<string>{ "First line", "Second line" });
+
+    // The display text of the selected item is drawn
+    auto& country = *acroForm.FindField("country");
+    REQUIRE(country.GetDictionary().MustFindKey("V").GetString().GetString() == "FR");
+    REQUIRE(getAppearanceText(country) == vector<string>{ "France" });
+
+    // The check box has no appearances, so it's switched on
+    // anyway and the viewer is requested to generate them
+    auto& agree = acroForm.FindField("agree")->GetDictionary();
+    REQUIRE(agree.MustFindKey("V").GetName() == "Yes");
+    REQUIRE(!agree.HasKey("AP"));
+    REQUIRE(agree.MustFindKey("AS").GetName() == "Yes");
+    REQUIRE(acroForm.GetNeedAppearances());
+}
+
+TEST_CASE("TestFlattenAnnotations")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        (void)page.CreateField<PdfTextBox>("name", Rect(100, 700, 200, 20));
+        (void)page.CreateField<PdfCheckBox>("agree", Rect(100, 400, 20, 20));
+        doc.GetAcroForm()->FillFields({ { "name", PdfString("John Doe") } });
+
+        // The appearance bounding box is scaled to the annotation rectangle
+        auto& square = page.GetAnnotations().CreateAnnot<PdfAnnotationSquare>(Rect(300, 300, 100, 100));
+        auto xobj = doc.CreateXObjectForm(Rect(0, 0, 50, 50));
+        PdfPainter painter;
+        painter.SetCanvas(*xobj);
+        painter.DrawRectangle(0, 0, 50, 50);
+        painter.FinishDrawing();
+        square.SetAppearanceStream(*xobj);
+
+        // Annotations without appearance are kept
+        (void)page.GetAnnotations().CreateAnnot<PdfAnnotationLink>(Rect(100, 100, 100, 20));
+
+        doc.FlattenAnnotations();
+        REQUIRE(doc.GetAcroForm() == nullptr);
+
+        StringStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    REQUIRE(doc.GetAcroForm() == nullptr);
+    REQUIRE(!doc.GetCatalog().GetDictionary().HasKey("AcroForm"));
+
+    auto& page = doc.GetPages().GetPageAt(0);
+    REQUIRE(page.GetAnnotations().GetCount() == 1);
+    REQUIRE(page.GetAnnotations().GetAnnotAt(0).GetType() == PdfAnnotationType::Link);
+
+    vector<PdfTextEntry> entries;
+    page.ExtractTextTo(entries);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].Text == "John Doe");
+
+    vector<Matrix> matrices;
+    PdfContentStreamReader reader(page);
+    PdfContent content;
+    while (reader.TryReadNext(content))
+    {
+        if (content.Type == PdfContentType::Operator && content.Operator == PdfOperator::cm)
+        {
+            auto& stack = content.Stack;
+            matrices.push_back(Matrix::FromCoefficients(stack[5].GetReal(), stack[4].GetReal(),
+                stack[3].GetReal(), stack[2].GetReal(), stack[1].GetReal(), stack[0].GetReal()));
+        }
+    }
+
+    REQUIRE(matrices.size() == 2);
+    REQUIRE(matrices[0] == Matrix::FromCoefficients(1, 0, 0, 1, 100, 700));
+    REQUIRE(matrices[1] == Matrix::FromCoefficients(2, 0, 0, 2, 300, 300));
+}
+
+vector<string> getAppearanceText(const PdfField& field)
+{
+    auto& apObj = field.GetDictionary().MustFindKey("AP").GetDictionary().MustFindKey("N");
+    unique_ptr<const PdfXObjectForm> xobj;
+    REQUIRE(PdfXObject::TryCreateFromObject(apObj, xobj));
+
+    vector<string> ret;
+    const PdfFont* font = nullptr;
+    PdfContentStreamReader reader(*xobj);
+    PdfContent content;
+    while (reader.TryReadNext(content))
+    {
+        if (content.Type != PdfContentType::Operator)
+            continue;
+
+        if (content.Operator == PdfOperator::Tf)
+        {
+            font = xobj->GetResources()->GetFont(content.Stack[1].GetName().GetString());
+        }
+        else if (content.Operator == PdfOperator::Tj)
+        {
+            REQUIRE(font != nullptr);
+            ret.push_back(font->GetEncoding().ConvertToUtf8(content.Stack[0].GetString()));
+        }
+    }
+
+    return ret;
+}
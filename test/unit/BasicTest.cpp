@@ -45,3 +45,46 @@ TEST_CASE("TestMetadataSet")
     metadata.SetTitle(nullptr);
     REQUIRE(metadata.GetTitle() == nullptr);
 }
+
+TEST_CASE("TestInstrumentationCounters")
+{
+    PdfMemDocument source;
+    source.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+    charbuff buffer;
+    {
+        BufferStreamDevice device(buffer);
+        source.Save(device);
+    }
+
+    PdfCommon::ResetInstrumentationCounters();
+    PdfCommon::SetInstrumentationEnabled(true);
+
+    PdfMemDocument loaded;
+    loaded.LoadFromBuffer(buffer);
+    PdfMemDocument doc;
+    doc.GetPages().AppendDocumentPages(loaded);
+
+    // Messages above the maximum severity are discarded before
+    // the arguments are evaluated
+    bool evaluated = false;
+    auto evaluate = [&]() { evaluated = true; return 0; };
+    PODOFO_LOG(PdfLogSeverity::Debug, "Discarded message {}", evaluate());
+    REQUIRE(!evaluated);
+
+    // Checking the severity alone doesn't count a suppressed message
+    auto suppressed = PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::SuppressedLogMessages);
+    REQUIRE(!IsLogSeverityEnabled(PdfLogSeverity::Debug));
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::SuppressedLogMessages) == suppressed);
+
+    PdfCommon::SetInstrumentationEnabled(false);
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::ParsedObjects) > 0);
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::ImportedObjects) > 0);
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::SuppressedLogMessages) >= 1);
+
+    // Disabled counters are not updated
+    suppressed = PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::SuppressedLogMessages);
+    PODOFO_LOG(PdfLogSeverity::Debug, "Discarded message");
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::SuppressedLogMessages) == suppressed);
+    PdfCommon::ResetInstrumentationCounters();
+    REQUIRE(PdfCommon::GetInstrumentationCounter(PdfInstrumentationCounter::ParsedObjects) == 0);
+}
@@ -13,6 +13,7 @@ using namespace PoDoFo;
 
 static void testAuthenticate(PdfEncrypt& encrypt);
 static void testEncrypt(PdfEncrypt& encrypt);
+static void testFindPassword(PdfEncrypt& encrypt, unsigned threadCount);
 static void createEncryptedPdf(const string_view& filename);
 
 charbuff s_encBuffer;
@@ -120,9 +121,35 @@ TEST_CASE("testAESV2")
         PdfKeyLength::L128);
 
     testAuthenticate(*encrypt);
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    //TestEncrypt(encrypt);
+    // NOTE: This also encrypts and decrypts with the found password
+    testFindPassword(*encrypt, 1);
+}
+
+TEST_CASE("testAESV2OutputStream")
+{
+    auto encrypt = PdfEncrypt::Create(PDF_USER_PASSWORD, PDF_OWNER_PASSWORD, s_protection,
+        PdfEncryptAlgorithm::AESV2,
+        PdfKeyLength::L128);
+    PdfString documentId = PdfString::FromHexData("BF37541A9083A51619AD5924ECF156DF");
+    encrypt->GenerateEncryptionKey(documentId);
+
+    charbuff encrypted;
+    {
+        BufferStreamDevice device(encrypted);
+        auto output = encrypt->CreateEncryptionOutputStream(device, PdfReference(7, 0));
+        auto& encStream = dynamic_cast<PdfEncryptOutputStream&>(*output);
+        encStream.Write(s_encBuffer);
+        INFO("the last padded block is written only when finishing");
+        size_t size = encrypted.size();
+        encStream.Finish();
+        REQUIRE(encrypted.size() == size + 16);
+        REQUIRE(encStream.IsFinished());
+        ASSERT_THROW_WITH_ERROR_CODE(encStream.Write("data"), PdfErrorCode::InternalLogic);
+    }
+
+    charbuff decrypted;
+    encrypt->DecryptTo(decrypted, encrypted, PdfReference(7, 0));
+    REQUIRE(decrypted == s_encBuffer);
 }
 
 #ifdef PODOFO_HAVE_LIBIDN
@@ -134,9 +161,7 @@ TEST_CASE("testAESV3")
         PdfKeyLength::L256);
 
     testAuthenticate(*encrypt);
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    //TestEncrypt(encrypt);
+    testEncrypt(*encrypt);
 }
 
 TEST_CASE("testAESV3R6")
@@ -146,9 +171,35 @@ TEST_CASE("testAESV3R6")
         PdfKeyLength::L256);
 
     testAuthenticate(*encrypt);
-    // AES decryption is not yet implemented.
-    // Therefore we have to disable this test.
-    //TestEncrypt(encrypt);
+    // NOTE: This also encrypts and decrypts with the found password
+    testFindPassword(*encrypt, 4);
+}
+
+TEST_CASE("testAESV3PaddingState")
+{
+    // The AESV3 authentication disables the padding on the cipher
+    // context, which must not leak to the other encryptions
+    // performed on the same thread
+    auto aesv3 = PdfEncrypt::Create(PDF_USER_PASSWORD, PDF_OWNER_PASSWORD, s_protection,
+        PdfEncryptAlgorithm::AESV3,
+        PdfKeyLength::L256);
+    testAuthenticate(*aesv3);
+
+    auto aesv2 = PdfEncrypt::Create(PDF_USER_PASSWORD, PDF_OWNER_PASSWORD, s_protection,
+        PdfEncryptAlgorithm::AESV2,
+        PdfKeyLength::L128);
+    PdfString documentId = PdfString::FromHexData("BF37541A9083A51619AD5924ECF156DF");
+    aesv2->GenerateEncryptionKey(documentId);
+
+    string_view unaligned = "Unaligned data";
+    for (auto encrypt : { aesv3.get(), aesv2.get() })
+    {
+        charbuff encrypted;
+        encrypt->EncryptTo(encrypted, unaligned, PdfReference(7, 0));
+        charbuff decrypted;
+        encrypt->DecryptTo(decrypted, encrypted, PdfReference(7, 0));
+        REQUIRE(decrypted == unaligned);
+    }
 }
 
 #endif // PODOFO_HAVE_LIBIDN
@@ -290,6 +341,76 @@ TEST_CASE("TestEncryptBigBuffer")
     }
 }
 
+// Test the concurrent decryption of the streams of a loaded document
+TEST_CASE("TestLoadStreams")
+{
+    constexpr unsigned StreamCount = 20;
+    for (auto algorithm : { PdfEncryptAlgorithm::RC4V2, PdfEncryptAlgorithm::AESV2 })
+    {
+        charbuff buffer;
+        vector<PdfReference> refs;
+        {
+            PdfMemDocument doc;
+            (void)doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            for (unsigned i = 0; i < StreamCount; i++)
+            {
+                auto& obj = doc.GetObjects().CreateDictionaryObject();
+                obj.GetOrCreateStream().SetData(utls::Format("Stream content {}", i));
+                doc.GetCatalog().GetDictionary().AddKeyIndirect(PdfName(utls::Format("Stream{}", i)), obj);
+                refs.push_back(obj.GetIndirectReference());
+            }
+
+            doc.SetEncrypted(PDF_USER_PASSWORD, "owner", PdfPermissions::Default, algorithm, PdfKeyLength::L128);
+            BufferStreamDevice device(buffer);
+            doc.Save(device);
+        }
+
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(buffer, PDF_USER_PASSWORD);
+        doc.LoadStreams(4);
+        for (unsigned i = 0; i < StreamCount; i++)
+        {
+            auto& obj = doc.GetObjects().MustGetObject(refs[i]);
+            REQUIRE(obj.IsDelayedLoadStreamDone());
+            REQUIRE(obj.MustGetStream().GetCopy() == utls::Format("Stream content {}", i));
+        }
+    }
+}
+
+// Test the encryption of streams written by PdfStreamedDocument
+TEST_CASE("TestStreamedDocumentEncryption")
+{
+    constexpr unsigned ChunkCount = 10;
+    constexpr unsigned ChunkSize = 10000;
+    string expected;
+    for (unsigned i = 0; i < ChunkCount * ChunkSize; i++)
+        expected.push_back((char)(i % 251));
+
+    for (auto algorithm : { PdfEncryptAlgorithm::RC4V2, PdfEncryptAlgorithm::AESV2 })
+    {
+        charbuff buffer;
+        PdfReference bufferRef;
+        {
+            auto encrypt = PdfEncrypt::Create(PDF_USER_PASSWORD, "owner", PdfPermissions::Default, algorithm, PdfKeyLength::L128);
+            PdfStreamedDocument doc(std::make_shared<BufferStreamDevice>(buffer), PdfVersionDefault, encrypt.get());
+            (void)doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            auto& obj = doc.GetObjects().CreateDictionaryObject();
+            bufferRef = obj.GetIndirectReference();
+            doc.GetCatalog().GetDictionary().AddKeyIndirect("TestBuffer", obj);
+            {
+                // Write the data in chunks, not aligned to the AES block size
+                auto stream = obj.GetOrCreateStream().GetOutputStream(PdfFilterList());
+                for (unsigned i = 0; i < ChunkCount; i++)
+                    stream.Write(expected.data() + i * ChunkSize, ChunkSize);
+            }
+        }
+
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(buffer, PDF_USER_PASSWORD);
+        REQUIRE(doc.GetObjects().MustGetObject(bufferRef).MustGetStream().GetCopy() == expected);
+    }
+}
+
 void testAuthenticate(PdfEncrypt& encrypt)
 {
     PdfString documentId = PdfString::FromHexData("BF37541A9083A51619AD5924ECF156DF");
@@ -304,6 +425,24 @@ void testAuthenticate(PdfEncrypt& encrypt)
     REQUIRE(!encrypt.Authenticate("wrongpassword", documentId));
 }
 
+void testFindPassword(PdfEncrypt& encrypt, unsigned threadCount)
+{
+    PdfString documentId = PdfString::FromHexData("BF37541A9083A51619AD5924ECF156DF");
+    encrypt.GenerateEncryptionKey(documentId);
+
+    vector<string_view> candidates = { "wrong1", "wrong2", "wrong3", PDF_OWNER_PASSWORD, "wrong4", PDF_USER_PASSWORD };
+    INFO("find the first matching password");
+    REQUIRE(encrypt.FindPassword(candidates, documentId, threadCount) == 3);
+    REQUIRE(encrypt.FindPassword(cspan<string_view>(candidates).subspan(4), documentId, threadCount) == 1);
+
+    INFO("no matching password");
+    REQUIRE(encrypt.FindPassword(cspan<string_view>(candidates).subspan(0, 3), documentId, threadCount) == -1);
+
+    INFO("the object is authenticated after a successful search");
+    REQUIRE(encrypt.FindPassword(candidates, documentId, threadCount) == 3);
+    testEncrypt(encrypt);
+}
+
 void testEncrypt(PdfEncrypt& encrypt)
 {
     charbuff encrypted;
@@ -97,6 +97,69 @@ TEST_CASE("TestCreateFontExtract")
     REQUIRE(entries[0].Y == 600);
 }
 
+static charbuff createSubsetFontDocument(unsigned threadCount)
+{
+    PdfMemDocument doc;
+    doc.GetFonts().SetEmbeddingThreadCount(threadCount);
+    // Fix the creation date, so the file identifier is the same
+    doc.GetMetadata().SetCreationDate(PdfDate());
+
+    // Load the same font with different encodings, to
+    // have multiple subset fonts prepared concurrently
+    charbuff fontData;
+    utls::ReadTo(fontData, TestUtils::GetTestInputFilePath("Fonts", "LiberationSans-Regular.ttf"));
+    PdfFontCreateParams params;
+    auto& font1 = doc.GetFonts().GetOrCreateFontFromBuffer(fontData, params);
+    params.Encoding = PdfEncodingFactory::CreateWinAnsiEncoding();
+    auto& font2 = doc.GetFonts().GetOrCreateFontFromBuffer(fontData, params);
+    params.Encoding = PdfEncodingFactory::CreateMacRomanEncoding();
+    auto& font3 = doc.GetFonts().GetOrCreateFontFromBuffer(fontData, params);
+    REQUIRE(&font1 != &font2);
+    REQUIRE(&font2 != &font3);
+
+    auto drawText = [&](const PdfFont& font, const string_view& text)
+    {
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.TextState.SetFont(font, 30.0);
+        painter.DrawText(text, 100, 600);
+        painter.FinishDrawing();
+    };
+
+    drawText(font1, "Parallel ěščř");
+    drawText(font2, "WinAnsi");
+    drawText(font3, "MacRoman");
+
+    charbuff ret;
+    BufferStreamDevice device(ret);
+    doc.Save(device, PdfSaveOptions::NoMetadataUpdate);
+    return ret;
+}
+
+TEST_CASE("TestParallelFontEmbedding")
+{
+    auto serial = createSubsetFontDocument(1);
+    auto parallel = createSubsetFontDocument(3);
+
+    // Objects are created serially, so the output must be the same
+    REQUIRE(serial == parallel);
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(parallel);
+    vector<PdfTextEntry> entries;
+    doc.GetPages().GetPageAt(0).ExtractTextTo(entries);
+    REQUIRE(entries[0].Text == "Parallel ěščř");
+
+    unsigned fontFileCount = 0;
+    for (auto obj : doc.GetObjects())
+    {
+        if (obj->IsDictionary() && obj->GetDictionary().HasKey("FontFile2"))
+            fontFileCount++;
+    }
+    REQUIRE(fontFileCount == 3);
+}
+
 void testSingleFont(FcPattern* font)
 {
     PdfMemDocument doc;
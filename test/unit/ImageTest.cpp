@@ -8,9 +8,18 @@
 
 #include <PdfTest.h>
 
+#ifdef PODOFO_HAVE_PNG_LIB
+#include <png.h>
+#endif // PODOFO_HAVE_PNG_LIB
+
 using namespace std;
 using namespace PoDoFo;
 
+#ifdef PODOFO_HAVE_PNG_LIB
+static charbuff createPng(unsigned width, unsigned height, int colorType, int depth,
+    bool interlaced, const charbuff& rows, const charbuff& palette = { }, const charbuff& trans = { });
+#endif // PODOFO_HAVE_PNG_LIB
+
 TEST_CASE("TestImage1")
 {
     PdfMemDocument doc;
@@ -204,3 +213,542 @@ TEST_CASE("TestImage6")
 
     TestUtils::WriteTestOutputFile(TestUtils::GetTestOutputFilePath("TestImage2.ppm"), ppmbuffer);
 }
+
+TEST_CASE("TestDecodePixelFormats")
+{
+    // Odd width, so the vectorized conversions also leave remaining pixels
+    constexpr unsigned Width = 37;
+    constexpr unsigned Height = 3;
+    charbuff rgb(Width * Height * 3);
+    charbuff gray(Width * Height);
+    charbuff alpha(Width * Height);
+    for (unsigned i = 0; i < Width * Height; i++)
+    {
+        rgb[i * 3 + 0] = (char)(i * 7);
+        rgb[i * 3 + 1] = (char)(i * 7 + 1);
+        rgb[i * 3 + 2] = (char)(i * 7 + 2);
+        gray[i] = (char)(i * 5);
+        alpha[i] = (char)(255 - i);
+    }
+
+    PdfMemDocument doc;
+    PdfImageInfo info;
+    info.Width = Width;
+    info.Height = Height;
+    info.BitsPerComponent = 8;
+    info.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
+    auto softMask = doc.CreateImage();
+    softMask->SetDataRaw(alpha, info);
+    auto grayImg = doc.CreateImage();
+    grayImg->SetDataRaw(gray, info);
+    auto grayMaskedImg = doc.CreateImage();
+    grayMaskedImg->SetDataRaw(gray, info);
+    grayMaskedImg->SetSoftMask(*softMask);
+    info.ColorSpace = PdfColorSpaceFactory::GetDeviceRGBInstace();
+    auto rgbImg = doc.CreateImage();
+    rgbImg->SetDataRaw(rgb, info);
+    auto rgbMaskedImg = doc.CreateImage();
+    rgbMaskedImg->SetDataRaw(rgb, info);
+    rgbMaskedImg->SetSoftMask(*softMask);
+
+    // Reference per pixel conversion, from the RGB components and the alpha
+    auto getExpected = [&](PdfPixelFormat format, bool isGray, bool masked)
+    {
+        unsigned pixelSize = format == PdfPixelFormat::Grayscale ? 1
+            : (format == PdfPixelFormat::RGB24 || format == PdfPixelFormat::BGR24 ? 3 : 4);
+        unsigned rowSize = pixelSize == 4 ? Width * 4 : 4 * ((Width * pixelSize + 3) / 4);
+        charbuff ret(rowSize * Height);
+        for (unsigned i = 0; i < Height; i++)
+        {
+            for (unsigned j = 0; j < Width; j++)
+            {
+                unsigned idx = i * Width + j;
+                char r = isGray ? gray[idx] : rgb[idx * 3 + 0];
+                char g = isGray ? gray[idx] : rgb[idx * 3 + 1];
+                char b = isGray ? gray[idx] : rgb[idx * 3 + 2];
+                char a = masked ? alpha[idx] : (char)255;
+                auto pixel = ret.data() + i * rowSize + j * pixelSize;
+                switch (format)
+                {
+                    case PdfPixelFormat::Grayscale:
+                        pixel[0] = r;
+                        break;
+                    case PdfPixelFormat::RGB24:
+                        pixel[0] = r; pixel[1] = g; pixel[2] = b;
+                        break;
+                    case PdfPixelFormat::BGR24:
+                        pixel[0] = b; pixel[1] = g; pixel[2] = r;
+                        break;
+                    case PdfPixelFormat::RGBA:
+                        pixel[0] = r; pixel[1] = g; pixel[2] = b; pixel[3] = a;
+                        break;
+                    case PdfPixelFormat::BGRA:
+                        pixel[0] = b; pixel[1] = g; pixel[2] = r; pixel[3] = a;
+                        break;
+                    case PdfPixelFormat::ARGB:
+                        pixel[0] = a; pixel[1] = r; pixel[2] = g; pixel[3] = b;
+                        break;
+                    case PdfPixelFormat::ABGR:
+                        pixel[0] = a; pixel[1] = b; pixel[2] = g; pixel[3] = r;
+                        break;
+                    default:
+                        FAIL("Unsupported format");
+                }
+            }
+        }
+
+        return ret;
+    };
+
+    const PdfPixelFormat formats[] = { PdfPixelFormat::Grayscale, PdfPixelFormat::RGB24, PdfPixelFormat::BGR24,
+        PdfPixelFormat::RGBA, PdfPixelFormat::BGRA, PdfPixelFormat::ARGB, PdfPixelFormat::ABGR };
+    for (auto format : formats)
+    {
+        charbuff buffer;
+        grayImg->DecodeTo(buffer, format);
+        REQUIRE(buffer == getExpected(format, true, false));
+        grayMaskedImg->DecodeTo(buffer, format);
+        REQUIRE(buffer == getExpected(format, true, true));
+        if (format == PdfPixelFormat::Grayscale)
+            continue;
+
+        rgbImg->DecodeTo(buffer, format);
+        REQUIRE(buffer == getExpected(format, false, false));
+        rgbMaskedImg->DecodeTo(buffer, format);
+        REQUIRE(buffer == getExpected(format, false, true));
+    }
+
+    // Convert BGR pixels to the PDF layout
+    auto bgr = getExpected(PdfPixelFormat::BGR24, false, false);
+    auto img = doc.CreateImage();
+    img->SetData(bgr, Width, Height, PdfPixelFormat::BGR24);
+    charbuff buffer;
+    img->GetObject().MustGetStream().CopyTo(buffer);
+    REQUIRE(buffer == rgb);
+}
+
+TEST_CASE("TestJpegPassthroughAndScaledDecode")
+{
+    constexpr unsigned Width = 64;
+    constexpr unsigned Height = 48;
+    charbuff rgb(Width * Height * 3);
+    charbuff alpha(Width * Height);
+    for (unsigned i = 0; i < Height; i++)
+    {
+        for (unsigned j = 0; j < Width; j++)
+        {
+            unsigned offset = i * Width + j;
+            rgb[offset * 3 + 0] = (char)(j * 4);
+            rgb[offset * 3 + 1] = (char)(i * 5);
+            rgb[offset * 3 + 2] = (char)128;
+            alpha[offset] = (char)(offset % 251);
+        }
+    }
+
+    PdfMemDocument doc;
+    auto rgbImg = doc.CreateImage();
+    rgbImg->SetData(rgb, Width, Height, PdfPixelFormat::RGB24);
+
+    charbuff jpeg;
+    charbuff buffer;
+    REQUIRE(!rgbImg->TryGetRawJpegData(buffer));
+    PdfArray args;
+    args.Add(PdfObject(0.9));
+    rgbImg->ExportTo(jpeg, PdfExportFormat::Jpeg, args);
+
+    auto jpegImg = doc.CreateImage();
+    jpegImg->LoadFromBuffer(jpeg);
+
+    // The JPEG data is returned and exported as it is
+    REQUIRE(jpegImg->TryGetRawJpegData(buffer));
+    REQUIRE(buffer == jpeg);
+    jpegImg->ExportTo(buffer, PdfExportFormat::Jpeg);
+    REQUIRE(buffer == jpeg);
+
+    // Full scale decoding is the same as plain decoding
+    charbuff full;
+    jpegImg->DecodeTo(full, PdfPixelFormat::RGB24);
+    jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Full);
+    REQUIRE(buffer == full);
+
+    // The scaled JPEG pixels are close to the average of the full resolution ones
+    jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Half);
+    REQUIRE(jpegImg->GetScaledWidth(PdfImageScale::Half) == Width / 2);
+    REQUIRE(jpegImg->GetScaledHeight(PdfImageScale::Half) == Height / 2);
+    REQUIRE(buffer.size() == (Width / 2) * 3 * (Height / 2));
+    for (unsigned i = 0; i < Height / 2; i++)
+    {
+        for (unsigned j = 0; j < Width / 2; j++)
+        {
+            for (unsigned k = 0; k < 3; k++)
+            {
+                int sum = 0;
+                for (unsigned n = 0; n < 4; n++)
+                    sum += (unsigned char)full[((i * 2 + n / 2) * Width + j * 2 + n % 2) * 3 + k];
+
+                int value = (unsigned char)buffer[(i * (Width / 2) + j) * 3 + k];
+                REQUIRE(std::abs(value - sum / 4) <= 8);
+            }
+        }
+    }
+
+    jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::Grayscale, PdfImageScale::Quarter);
+    REQUIRE(buffer.size() == (Width / 4) * (Height / 4));
+    jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::RGB24, PdfImageScale::Eighth);
+    REQUIRE(buffer.size() == (Width / 8) * 3 * (Height / 8));
+
+    // The soft mask is subsampled together with the image
+    PdfImageInfo info;
+    info.Width = Width;
+    info.Height = Height;
+    info.BitsPerComponent = 8;
+    info.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
+    auto softMask = doc.CreateImage();
+    softMask->SetDataRaw(alpha, info);
+    jpegImg->SetSoftMask(*softMask);
+    rgbImg->SetSoftMask(*softMask);
+    jpegImg->DecodeScaledTo(buffer, PdfPixelFormat::BGRA, PdfImageScale::Quarter);
+    for (unsigned i = 0; i < Height / 4; i++)
+    {
+        for (unsigned j = 0; j < Width / 4; j++)
+            REQUIRE(buffer[(i * (Width / 4) + j) * 4 + 3] == alpha[i * 4 * Width + j * 4]);
+    }
+
+    // Non JPEG images are subsampled
+    rgbImg->DecodeScaledTo(buffer, PdfPixelFormat::RGBA, PdfImageScale::Quarter);
+    for (unsigned i = 0; i < Height / 4; i++)
+    {
+        for (unsigned j = 0; j < Width / 4; j++)
+        {
+            unsigned srcOffset = i * 4 * Width + j * 4;
+            unsigned dstOffset = (i * (Width / 4) + j) * 4;
+            REQUIRE(buffer[dstOffset + 0] == rgb[srcOffset * 3 + 0]);
+            REQUIRE(buffer[dstOffset + 1] == rgb[srcOffset * 3 + 1]);
+            REQUIRE(buffer[dstOffset + 2] == rgb[srcOffset * 3 + 2]);
+            REQUIRE(buffer[dstOffset + 3] == alpha[srcOffset]);
+        }
+    }
+}
+
+TEST_CASE("TestJpegPassthroughInvertedDecode")
+{
+    constexpr unsigned Width = 16;
+    constexpr unsigned Height = 16;
+    charbuff rgb(Width * Height * 3);
+    for (unsigned i = 0; i < rgb.size(); i++)
+        rgb[i] = (char)(i % 256);
+
+    PdfMemDocument doc;
+    auto rgbImg = doc.CreateImage();
+    rgbImg->SetData(rgb, Width, Height, PdfPixelFormat::RGB24);
+    charbuff jpeg;
+    rgbImg->ExportTo(jpeg, PdfExportFormat::Jpeg);
+
+    // Add an Adobe APP14 marker right after the start of image
+    charbuff adobeJpeg = jpeg;
+    adobeJpeg.insert(2, string_view("\xFF\xEE\x00\x0E" "Adobe\x00\x64\x00\x00\x00\x00\x00", 16));
+
+    PdfArray decode;
+    for (unsigned i = 0; i < 8; i++)
+        decode.Add(PdfObject((int64_t)(i % 2 == 0 ? 1 : 0)));
+
+    // The inverted /Decode array is accepted only with the Adobe marker
+    charbuff buffer;
+    auto jpegImg = doc.CreateImage();
+    jpegImg->LoadFromBuffer(jpeg);
+    jpegImg->GetDictionary().AddKey("Decode", decode);
+    REQUIRE(!jpegImg->TryGetRawJpegData(buffer));
+
+    auto adobeImg = doc.CreateImage();
+    adobeImg->LoadFromBuffer(adobeJpeg);
+    adobeImg->GetDictionary().AddKey("Decode", decode);
+    REQUIRE(adobeImg->TryGetRawJpegData(buffer));
+    REQUIRE(buffer == adobeJpeg);
+}
+
+TEST_CASE("TestOptimizeImages")
+{
+    constexpr unsigned Width = 600;
+    constexpr unsigned Height = 400;
+    charbuff photo(Width * Height * 3);
+    charbuff lineArt(Width * Height);
+    charbuff gradient(Width * Height);
+    for (unsigned i = 0; i < Height; i++)
+    {
+        for (unsigned j = 0; j < Width; j++)
+        {
+            unsigned offset = i * Width + j;
+            photo[offset * 3 + 0] = (char)(j * 255 / Width);
+            photo[offset * 3 + 1] = (char)(i * 255 / Height);
+            photo[offset * 3 + 2] = (char)((i * j) % 251);
+            lineArt[offset] = (char)((i / 20 + j / 20) % 2 == 0 ? 0 : 255);
+            gradient[offset] = (char)(i + j);
+        }
+    }
+
+    PdfMemDocument doc;
+    auto photoImg = doc.CreateImage();
+    photoImg->SetData(photo, Width, Height, PdfPixelFormat::RGB24);
+    auto lineArtImg = doc.CreateImage();
+    lineArtImg->SetData(lineArt, Width, Height, PdfPixelFormat::Grayscale);
+    auto smallImg = doc.CreateImage();
+    smallImg->SetData(gradient, Width, Height, PdfPixelFormat::Grayscale);
+    charbuff jpeg;
+    photoImg->ExportTo(jpeg, PdfExportFormat::Jpeg);
+    auto jpegImg = doc.CreateImage();
+    jpegImg->LoadFromBuffer(jpeg);
+
+    // The photo is drawn 1 inch wide, and also inside a form 2 inches
+    // wide, so its effective resolution is 300 DPI. The line art is
+    // 600 DPI, as the JPEG image, while the last image is 150 DPI
+    auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+    auto form = doc.CreateXObjectForm(Rect(0, 0, 144, 96));
+    {
+        PdfPainter painter;
+        painter.SetCanvas(*form);
+        painter.DrawImage(*photoImg, 0, 0, 144.0 / Width, 96.0 / Height);
+        painter.FinishDrawing();
+    }
+    {
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.DrawImage(*photoImg, 0, 0, 72.0 / Width, 48.0 / Height);
+        painter.DrawXObject(*form, 100, 100);
+        painter.DrawImage(*lineArtImg, 300, 0, 72.0 / Width, 48.0 / Height);
+        painter.DrawImage(*smallImg, 300, 300, 288.0 / Width, 192.0 / Height);
+        painter.DrawImage(*jpegImg, 0, 500, 72.0 / Width, 48.0 / Height);
+        painter.FinishDrawing();
+    }
+
+    PdfImageOptimizeParams params;
+    params.ThreadCount = 0;
+    REQUIRE(doc.OptimizeImages(params) == 4);
+
+    charbuff output;
+    {
+        BufferStreamDevice device(output);
+        doc.Save(device);
+    }
+    PdfMemDocument optimized;
+    optimized.LoadFromBuffer(output);
+    auto& objects = optimized.GetObjects();
+
+    // The photo is downsampled to 150 DPI and encoded with JPEG
+    charbuff buffer;
+    unique_ptr<PdfImage> image;
+    REQUIRE(PdfXObject::TryCreateFromObject(objects.MustGetObject(photoImg->GetObject().GetIndirectReference()), image));
+    REQUIRE(image->GetWidth() == Width / 2);
+    REQUIRE(image->GetHeight() == Height / 2);
+    REQUIRE(image->GetDictionary().MustFindKey("Filter").GetName() == "DCTDecode");
+    image->DecodeTo(buffer, PdfPixelFormat::RGB24);
+    REQUIRE(std::abs((unsigned char)buffer[(100 * 300 + 150) * 3] - (int)(300 * 255 / Width)) <= 8);
+
+    // The line art is downsampled to 150 DPI, and encoded with Flate and PNG predictors
+    REQUIRE(PdfXObject::TryCreateFromObject(objects.MustGetObject(lineArtImg->GetObject().GetIndirectReference()), image));
+    REQUIRE(image->GetWidth() == Width / 4);
+    REQUIRE(image->GetHeight() == Height / 4);
+    REQUIRE(image->GetDictionary().MustFindKey("Filter").GetName() == "FlateDecode");
+    REQUIRE(image->GetDictionary().MustFindKey("DecodeParms").GetDictionary().MustFindKey("Predictor").GetNumber() == 15);
+    image->DecodeTo(buffer, PdfPixelFormat::Grayscale);
+    unsigned scanLineSize = 4 * ((Width / 4 + 3) / 4);
+    for (unsigned i = 0; i < Height / 4; i++)
+    {
+        for (unsigned j = 0; j < Width / 4; j++)
+            REQUIRE(buffer[i * scanLineSize + j] == lineArt[i * 4 * Width + j * 4]);
+    }
+
+    // The JPEG image is downsampled to 150 DPI
+    REQUIRE(PdfXObject::TryCreateFromObject(objects.MustGetObject(jpegImg->GetObject().GetIndirectReference()), image));
+    REQUIRE(image->GetWidth() == Width / 4);
+    REQUIRE(image->GetHeight() == Height / 4);
+    REQUIRE(image->GetDictionary().MustFindKey("Filter").GetName() == "DCTDecode");
+
+    // The last image keeps its size, and it's losslessly recompressed
+    REQUIRE(PdfXObject::TryCreateFromObject(objects.MustGetObject(smallImg->GetObject().GetIndirectReference()), image));
+    REQUIRE(image->GetWidth() == Width);
+    REQUIRE(image->GetHeight() == Height);
+    REQUIRE(image->GetDictionary().MustFindKey("Filter").GetName() == "FlateDecode");
+    image->DecodeTo(buffer, PdfPixelFormat::Grayscale);
+    REQUIRE(buffer == gradient);
+}
+
+TEST_CASE("TestXObjectCache")
+{
+    constexpr unsigned Width = 64;
+    constexpr unsigned Height = 32;
+    charbuff pixels(Width * Height * 3);
+    for (unsigned i = 0; i < pixels.size(); i++)
+        pixels[i] = (char)(i % 253);
+
+    PdfMemDocument doc;
+    auto image1 = doc.GetOrCreateImage(pixels, Width, Height, PdfPixelFormat::RGB24);
+    auto image2 = doc.GetOrCreateImage(pixels, Width, Height, PdfPixelFormat::RGB24);
+    REQUIRE(&image1->GetObject() == &image2->GetObject());
+    REQUIRE(image2->GetWidth() == Width);
+
+    // Different parameters for the same pixels create a new image
+    auto image3 = doc.GetOrCreateImage(pixels, Width / 2, Height * 2, PdfPixelFormat::RGB24);
+    REQUIRE(&image3->GetObject() != &image1->GetObject());
+
+    // Files and buffers with the same content share the image
+    charbuff jpeg;
+    image1->ExportTo(jpeg, PdfExportFormat::Jpeg);
+    auto jpegImage1 = doc.GetOrCreateImageFromBuffer(jpeg);
+    auto filepath = TestUtils::GetTestOutputFilePath("TestXObjectCache.jpg");
+    TestUtils::WriteTestOutputFile("TestXObjectCache.jpg", jpeg);
+    auto jpegImage2 = doc.GetOrCreateImage(filepath);
+    REQUIRE(&jpegImage1->GetObject() == &jpegImage2->GetObject());
+
+    // A cached image modified afterwards is not returned anymore
+    image3->SetData(pixels, Width, Height, PdfPixelFormat::RGB24);
+    auto image4 = doc.GetOrCreateImage(pixels, Width / 2, Height * 2, PdfPixelFormat::RGB24);
+    REQUIRE(&image4->GetObject() != &image3->GetObject());
+    REQUIRE(image4->GetWidth() == Width / 2);
+
+    // Identical forms are stored once
+    auto drawForm = [&](double x) {
+        auto form = doc.CreateXObjectForm(Rect(0, 0, 100, 100));
+        PdfPainter painter;
+        painter.SetCanvas(*form);
+        painter.DrawImage(*image1, 0, 0);
+        painter.DrawLine(x, 0, 100, 100);
+        painter.FinishDrawing();
+        return form;
+    };
+    auto createForm = [&](double x) {
+        return doc.DeduplicateXObjectForm(drawForm(x));
+    };
+
+    auto form1 = createForm(0);
+    auto objectCount = doc.GetObjects().GetSize();
+    auto form2 = createForm(0);
+    REQUIRE(&form1->GetObject() == &form2->GetObject());
+    REQUIRE(doc.GetObjects().GetSize() == objectCount);
+    auto form3 = createForm(10);
+    REQUIRE(&form3->GetObject() != &form1->GetObject());
+
+    // The references to a form already drawn are redirected
+    auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+    auto form4 = drawForm(0);
+    PdfPainter painter;
+    painter.SetCanvas(page);
+    painter.DrawXObject(*form4, 0, 0);
+    painter.FinishDrawing();
+    auto form4Ref = form4->GetObject().GetIndirectReference();
+    form4 = doc.DeduplicateXObjectForm(std::move(form4));
+    REQUIRE(&form4->GetObject() == &form1->GetObject());
+    REQUIRE(doc.GetObjects().GetObject(form4Ref) == nullptr);
+    auto xobjects = page.MustGetResources().GetResourceIterator("XObject");
+    auto it = xobjects.begin();
+    REQUIRE(it != xobjects.end());
+    REQUIRE((*it).second == &form1->GetObject());
+}
+
+#ifdef PODOFO_HAVE_PNG_LIB
+
+TEST_CASE("TestPngRowStreaming")
+{
+    constexpr unsigned Width = 301;
+    constexpr unsigned Height = 57;
+    charbuff rgba(Width * Height * 4);
+    for (unsigned i = 0; i < Height; i++)
+    {
+        for (unsigned j = 0; j < Width; j++)
+        {
+            unsigned offset = (i * Width + j) * 4;
+            rgba[offset + 0] = (char)(j * 255 / Width);
+            rgba[offset + 1] = (char)(i * 255 / Height);
+            rgba[offset + 2] = (char)((i * j) % 251);
+            rgba[offset + 3] = (char)((i + j) % 256);
+        }
+    }
+
+    PdfMemDocument doc;
+    charbuff buffer;
+    for (bool interlaced : { false, true })
+    {
+        // The rows are Flate compressed with PNG predictors, and
+        // the alpha channel is split to the soft mask
+        auto image = doc.CreateImage();
+        image->LoadFromBuffer(createPng(Width, Height, PNG_COLOR_TYPE_RGB_ALPHA, 8, interlaced, rgba));
+        auto& dict = image->GetDictionary();
+        REQUIRE(dict.MustFindKey("Filter").GetName() == "FlateDecode");
+        auto& decodeParms = dict.MustFindKey("DecodeParms").GetDictionary();
+        REQUIRE(decodeParms.MustFindKey("Predictor").GetNumber() == 15);
+        REQUIRE(decodeParms.MustFindKey("Colors").GetNumber() == 3);
+        REQUIRE(decodeParms.MustFindKey("Columns").GetNumber() == Width);
+        REQUIRE(dict.FindKey("SMask") != nullptr);
+        image->DecodeTo(buffer, PdfPixelFormat::RGBA);
+        REQUIRE(buffer == rgba);
+    }
+
+    // Packed palette indices with transparency: black, red,
+    // green and blue, with the first two partially transparent
+    constexpr unsigned PaletteWidth = 13;
+    charbuff palette(12);
+    palette[3] = (char)255;
+    palette[7] = (char)255;
+    palette[11] = (char)255;
+    charbuff trans(2);
+    trans[1] = (char)128;
+    charbuff indices(((PaletteWidth * 2 + 7) / 8) * 2);
+    unsigned rowSize = (unsigned)indices.size() / 2;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        for (unsigned j = 0; j < PaletteWidth; j++)
+        {
+            unsigned index = (i + j) % 4;
+            indices[i * rowSize + j / 4] |= (char)(index << (6 - (j % 4) * 2));
+        }
+    }
+
+    auto image = doc.CreateImage();
+    image->LoadFromBuffer(createPng(PaletteWidth, 2, PNG_COLOR_TYPE_PALETTE, 2, false, indices, palette, trans));
+    REQUIRE(image->GetDictionary().MustFindKey("BitsPerComponent").GetNumber() == 2);
+    image->GetObject().MustGetStream().CopyTo(buffer);
+    REQUIRE(buffer == indices);
+
+    unique_ptr<PdfImage> smask;
+    REQUIRE(PdfXObject::TryCreateFromObject(image->GetDictionary().MustFindKey("SMask"), smask));
+    smask->DecodeTo(buffer, PdfPixelFormat::Grayscale);
+    unsigned scanLineSize = 4 * ((PaletteWidth + 3) / 4);
+    for (unsigned i = 0; i < 2; i++)
+    {
+        for (unsigned j = 0; j < PaletteWidth; j++)
+        {
+            unsigned index = (i + j) % 4;
+            REQUIRE((unsigned char)buffer[i * scanLineSize + j] == (index < trans.size() ? (unsigned char)trans[index] : 255));
+        }
+    }
+}
+
+charbuff createPng(unsigned width, unsigned height, int colorType, int depth,
+    bool interlaced, const charbuff& rows, const charbuff& palette, const charbuff& trans)
+{
+    charbuff ret;
+    auto png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    auto info = png_create_info_struct(png);
+    png_set_write_fn(png, &ret, [](png_structp png, png_bytep data, png_size_t length) {
+        ((charbuff*)png_get_io_ptr(png))->append((const char*)data, length);
+    }, nullptr);
+    png_set_IHDR(png, info, width, height, depth, colorType,
+        interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    if (palette.size() != 0)
+        png_set_PLTE(png, info, (png_const_colorp)palette.data(), (int)palette.size() / 3);
+    if (trans.size() != 0)
+        png_set_tRNS(png, info, (png_const_bytep)trans.data(), (int)trans.size(), nullptr);
+
+    png_write_info(png, info);
+    size_t rowSize = rows.size() / height;
+    vector<png_bytep> rowPointers(height);
+    for (unsigned i = 0; i < height; i++)
+        rowPointers[i] = (png_bytep)const_cast<char*>(rows.data()) + i * rowSize;
+
+    png_write_image(png, rowPointers.data());
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return ret;
+}
+
+#endif // PODOFO_HAVE_PNG_LIB
@@ -85,3 +85,248 @@ TEST_CASE("TestFlattening")
         REQUIRE(child.GetDictionary().MustGetKey("Parent").GetReference() == pageRootRef);
     }
 }
+
+TEST_CASE("TestAppendDocumentPages")
+{
+    PdfMemDocument source;
+    PdfPainter painter;
+    for (unsigned i = 0; i < 20; i++)
+    {
+        auto& page = source.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        painter.SetCanvas(page);
+        painter.TextState.SetFont(source.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+        painter.DrawText(utls::Format("Page {}", i), 100, 600);
+        painter.FinishDrawing();
+    }
+
+    // Link the last page from the pages to import
+    auto& link = source.GetPages().GetPageAt(3).GetAnnotations().CreateAnnot<PdfAnnotationLink>(Rect(100, 100, 100, 20));
+    link.SetDestination(std::make_shared<PdfDestination>(source.GetPages().GetPageAt(19)));
+
+    charbuff buffer;
+    {
+        StringStreamDevice device(buffer);
+        source.Save(device);
+        source.LoadFromBuffer(buffer);
+    }
+
+    PdfMemDocument doc;
+    doc.GetPages().AppendDocumentPages(source, 3, 2);
+    doc.GetPages().InsertDocumentPageAt(0, source, 10);
+    REQUIRE(doc.GetPages().GetCount() == 3);
+
+    // Only the objects reachable from the imported pages are copied
+    REQUIRE(doc.GetObjects().GetSize() < source.GetObjects().GetSize() / 2);
+
+    charbuff outBuffer;
+    StringStreamDevice device(outBuffer);
+    doc.Save(device);
+    doc.LoadFromBuffer(outBuffer);
+
+    const unsigned expectedPages[] = { 10, 3, 4 };
+    for (unsigned i = 0; i < std::size(expectedPages); i++)
+    {
+        auto& page = doc.GetPages().GetPageAt(i);
+        vector<PdfTextEntry> entries;
+        page.ExtractTextTo(entries);
+        REQUIRE(entries.size() == 1);
+        REQUIRE(entries[0].Text == utls::Format("Page {}", expectedPages[i]));
+    }
+
+    // The reference to the page not imported is dropped
+    auto& annot = doc.GetPages().GetPageAt(1).GetAnnotations().GetAnnotAt(0);
+    REQUIRE(annot.GetDictionary().MustFindKey("Dest").GetArray()[0].IsNull());
+}
+
+TEST_CASE("TestAppendDocumentPagesDeduplicate")
+{
+    // Create a document with an image with a soft mask
+    charbuff sourceBuffer;
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        PdfImageInfo info;
+        info.Width = 2;
+        info.Height = 2;
+        info.BitsPerComponent = 8;
+        info.ColorSpace = PdfColorSpaceFactory::GetDeviceGrayInstace();
+        auto alpha = doc.CreateImage();
+        alpha->SetDataRaw(bufferview("\x00\x40\x80\xFF", 4), info);
+        auto img = doc.CreateImage();
+        info.ColorSpace = PdfColorSpaceFactory::GetDeviceRGBInstace();
+        img->SetDataRaw(bufferview("\xFF\x00\x00\x00\xFF\x00\x00\x00\xFF\xFF\xFF\xFF", 12), info);
+        img->SetSoftMask(*alpha);
+
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.DrawImage(*img, 100, 100);
+        painter.FinishDrawing();
+
+        StringStreamDevice device(sourceBuffer);
+        doc.Save(device);
+    }
+
+    auto countImages = [](const PdfDocument& doc)
+    {
+        unsigned ret = 0;
+        for (auto obj : doc.GetObjects())
+        {
+            if (obj->IsDictionary() && obj->GetDictionary().FindKeyAs<PdfName>("Subtype") == "Image")
+                ret++;
+        }
+
+        return ret;
+    };
+
+    constexpr unsigned SourceCount = 5;
+    PdfMemDocument merged;
+    PdfMemDocument mergedDedup;
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        PdfMemDocument source;
+        source.LoadFromBuffer(sourceBuffer);
+        merged.GetPages().AppendDocumentPages(source);
+        mergedDedup.GetPages().AppendDocumentPages(source, PdfImportFlags::DeduplicateStreams);
+    }
+
+    REQUIRE(countImages(merged) == SourceCount * 2);
+    REQUIRE(countImages(mergedDedup) == 2);
+    REQUIRE(mergedDedup.GetPages().GetCount() == SourceCount);
+
+    // All the pages share the same image
+    charbuff buffer;
+    StringStreamDevice device(buffer);
+    mergedDedup.Save(device);
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    REQUIRE(countImages(doc) == 2);
+    const PdfObject* image = nullptr;
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        auto xobjects = doc.GetPages().GetPageAt(i).MustGetResources().GetResourceIterator("XObject");
+        auto it = xobjects.begin();
+        REQUIRE(it != xobjects.end());
+        if (image == nullptr)
+            image = (*it).second;
+        else
+            REQUIRE((*it).second == image);
+    }
+}
+
+TEST_CASE("TestAppendDocumentPagesDeduplicateSharedFont")
+{
+    // Create documents with the same form drawing text. The
+    // last document draws it with a different font
+    constexpr unsigned SourceCount = 4;
+    vector<charbuff> sourceBuffers(SourceCount);
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        auto form = doc.CreateXObjectForm(Rect(0, 0, 200, 50));
+        auto& font = doc.GetFonts().GetStandard14Font(i == SourceCount - 1
+            ? PdfStandard14FontType::Courier : PdfStandard14FontType::Helvetica);
+
+        PdfPainter painter;
+        painter.SetCanvas(*form);
+        painter.TextState.SetFont(font, 12);
+        painter.DrawText("Shared", 10, 10);
+        painter.FinishDrawing();
+
+        painter.SetCanvas(page);
+        painter.DrawXObject(*form, 100, 100);
+        painter.FinishDrawing();
+
+        StringStreamDevice device(sourceBuffers[i]);
+        doc.Save(device);
+    }
+
+    PdfMemDocument merged;
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        PdfMemDocument source;
+        source.LoadFromBuffer(sourceBuffers[i]);
+        merged.GetPages().AppendDocumentPages(source, PdfImportFlags::DeduplicateStreams);
+    }
+
+    // The forms drawn with the same font are shared,
+    // the one drawn with the different font is not
+    vector<const PdfObject*> forms;
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        auto xobjects = merged.GetPages().GetPageAt(i).MustGetResources().GetResourceIterator("XObject");
+        auto it = xobjects.begin();
+        REQUIRE(it != xobjects.end());
+        forms.push_back((*it).second);
+    }
+
+    REQUIRE(forms[1] == forms[0]);
+    REQUIRE(forms[2] == forms[0]);
+    REQUIRE(forms[3] != forms[0]);
+}
+
+TEST_CASE("TestAppendDocumentPagesStreamed")
+{
+    // Create documents with different text and the same image
+    constexpr unsigned SourceCount = 4;
+    vector<charbuff> sourceBuffers(SourceCount);
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        PdfImageInfo info;
+        info.Width = 2;
+        info.Height = 1;
+        info.BitsPerComponent = 8;
+        info.ColorSpace = PdfColorSpaceFactory::GetDeviceRGBInstace();
+        auto img = doc.CreateImage();
+        img->SetDataRaw(bufferview("\xFF\x00\x00\x00\xFF\x00", 6), info);
+
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+        painter.DrawText(utls::Format("Document {}", i), 100, 600);
+        painter.DrawImage(*img, 100, 100);
+        painter.FinishDrawing();
+
+        StringStreamDevice device(sourceBuffers[i]);
+        doc.Save(device);
+    }
+
+    charbuff buffer;
+    {
+        PdfStreamedDocument merged(std::make_shared<StringStreamDevice>(buffer));
+        for (unsigned i = 0; i < SourceCount; i++)
+        {
+            PdfMemDocument source;
+            source.LoadFromBuffer(sourceBuffers[i]);
+            merged.GetPages().AppendDocumentPages(source, PdfImportFlags::DeduplicateStreams);
+        }
+
+        // The imported fonts are already written, and
+        // they are not kept in memory anymore
+        for (auto obj : merged.GetObjects())
+            REQUIRE(!(obj->IsDictionary() && obj->GetDictionary().FindKeyAs<PdfName>("Type") == "Font"));
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    REQUIRE(doc.GetPages().GetCount() == SourceCount);
+    const PdfObject* image = nullptr;
+    for (unsigned i = 0; i < SourceCount; i++)
+    {
+        auto& page = doc.GetPages().GetPageAt(i);
+        vector<PdfTextEntry> entries;
+        page.ExtractTextTo(entries);
+        REQUIRE(entries.size() == 1);
+        REQUIRE(entries[0].Text == utls::Format("Document {}", i));
+
+        auto xobjects = page.MustGetResources().GetResourceIterator("XObject");
+        auto it = xobjects.begin();
+        REQUIRE(it != xobjects.end());
+        if (image == nullptr)
+            image = (*it).second;
+        else
+            REQUIRE((*it).second == image);
+    }
+}
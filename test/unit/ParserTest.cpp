@@ -21,6 +21,7 @@
 #include <limits>
 
 #include <sstream>
+#include <thread>
 
 #include <PdfTest.h>
 
@@ -1988,6 +1989,151 @@ TEST_CASE("testSaveIncrementalRoundTrip")
     }
 }
 
+TEST_CASE("TestForkDocument")
+{
+    charbuff templateBuff;
+    {
+        PdfMemDocument doc;
+        PdfPainter painter;
+        for (unsigned i = 0; i < 3; i++)
+        {
+            auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            painter.SetCanvas(page);
+            painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+            painter.DrawText(utls::Format("Template page {}", i), 100, 600);
+            painter.FinishDrawing();
+        }
+
+        StringStreamDevice device(templateBuff);
+        doc.Save(device);
+    }
+
+    PdfMemDocument templateDoc;
+    templateDoc.LoadFromBuffer(templateBuff);
+    charbuff templateContents;
+    templateDoc.GetPages().GetPageAt(1).GetContents()->CopyTo(templateContents);
+
+    // Produce the variants concurrently
+    constexpr unsigned VariantCount = 8;
+    vector<charbuff> variants(VariantCount, templateBuff);
+    vector<thread> threads;
+    for (unsigned i = 0; i < VariantCount; i++)
+    {
+        threads.emplace_back([&, i]()
+        {
+            auto doc = templateDoc.Fork();
+            doc->GetMetadata().SetTitle(PdfString(utls::Format("Variant {}", i)));
+            BufferStreamDevice device(variants[i]);
+            doc->SaveUpdate(device);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (unsigned i = 0; i < VariantCount; i++)
+    {
+        // Only the edited objects are written in the update
+        REQUIRE(variants[i].size() - templateBuff.size() < templateBuff.size() / 2);
+
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(variants[i]);
+        REQUIRE(doc.GetMetadata().GetTitle()->GetString() == utls::Format("Variant {}", i));
+        REQUIRE(doc.GetPages().GetCount() == 3);
+        charbuff contents;
+        doc.GetPages().GetPageAt(1).GetContents()->CopyTo(contents);
+        REQUIRE(contents == templateContents);
+    }
+
+    // A fork can be saved as a full document, and the
+    // edits don't reach the template
+    auto doc = templateDoc.Fork();
+    doc->GetPages().RemovePageAt(0);
+    charbuff buffer;
+    StringStreamDevice device(buffer);
+    doc->Save(device);
+    REQUIRE(templateDoc.GetPages().GetCount() == 3);
+    doc->LoadFromBuffer(buffer);
+    REQUIRE(doc->GetPages().GetCount() == 2);
+    charbuff contents;
+    doc->GetPages().GetPageAt(0).GetContents()->CopyTo(contents);
+    REQUIRE(contents == templateContents);
+}
+
+// Read the template and its forks concurrently
+TEST_CASE("TestForkDocumentConcurrentReads")
+{
+    constexpr unsigned PageCount = 16;
+    charbuff templateBuff;
+    {
+        PdfMemDocument doc;
+        PdfPainter painter;
+        for (unsigned i = 0; i < PageCount; i++)
+        {
+            auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            painter.SetCanvas(page);
+            painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+            painter.DrawText(utls::Format("Template page {}", i), 100, 600);
+            painter.FinishDrawing();
+        }
+
+        doc.SetEncrypted("user", "owner", PdfPermissions::Default, PdfEncryptAlgorithm::AESV2, PdfKeyLength::L128);
+        StringStreamDevice device(templateBuff);
+        doc.Save(device);
+    }
+
+    vector<charbuff> expected(PageCount);
+    {
+        PdfMemDocument doc;
+        doc.LoadFromBuffer(templateBuff, "user");
+        for (unsigned i = 0; i < PageCount; i++)
+            doc.GetPages().GetPageAt(i).GetContents()->CopyTo(expected[i]);
+    }
+
+    PdfMemDocument templateDoc;
+    templateDoc.LoadFromBuffer(templateBuff, "user");
+
+    // NOTE: Forks are created upfront, as creating them
+    // can't be concurrent with other accesses to the template
+    constexpr unsigned ForkCount = 4;
+    vector<unique_ptr<PdfMemDocument>> forks;
+    for (unsigned i = 0; i < ForkCount; i++)
+        forks.push_back(templateDoc.Fork());
+
+    // Read the pages in different orders, so the template and
+    // the forks load the objects from the device interleaved
+    auto readPages = [&](PdfMemDocument& doc, unsigned start) {
+        vector<charbuff> ret(PageCount);
+        for (unsigned i = 0; i < PageCount; i++)
+        {
+            unsigned index = (start + i) % PageCount;
+            doc.GetPages().GetPageAt(index).GetContents()->CopyTo(ret[index]);
+        }
+
+        return ret;
+    };
+
+    vector<vector<charbuff>> contents(ForkCount + 1);
+    vector<thread> threads;
+    threads.emplace_back([&]()
+    {
+        contents[ForkCount] = readPages(templateDoc, 0);
+    });
+    for (unsigned i = 0; i < ForkCount; i++)
+    {
+        threads.emplace_back([&, i]()
+        {
+            contents[i] = readPages(*forks[i], (i + 1) * 3);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto& pages : contents)
+        REQUIRE(pages == expected);
+}
+
 // CVE-2018-8002, CVE-2021-30470
 TEST_CASE("testNestedArrays")
 {
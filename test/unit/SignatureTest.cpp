@@ -0,0 +1,219 @@
+/**
+ * SPDX-FileCopyrightText: (C) 2024 Francesco Pretto <ceztko@gmail.com>
+ * SPDX-License-Identifier: LGPL-2.0-or-later
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <PdfTest.h>
+
+#include <openssl/evp.h>
+
+using namespace std;
+using namespace PoDoFo;
+
+namespace
+{
+    // Signer that just collects the signed data
+    class TestSigner : public PdfSigner
+    {
+    public:
+        TestSigner(vector<charbuff>* signedData = nullptr, unsigned* dryRunCount = nullptr)
+            : m_signedData(signedData), m_dryRunCount(dryRunCount) { }
+
+    public:
+        void Reset() override
+        {
+            Data.clear();
+        }
+
+        void AppendData(const bufferview& data) override
+        {
+            Data.append(data.data(), data.size());
+        }
+
+        void ComputeSignature(charbuff& buffer, bool dryrun) override
+        {
+            if (dryrun)
+            {
+                if (m_dryRunCount != nullptr)
+                    (*m_dryRunCount)++;
+            }
+            else if (m_signedData != nullptr)
+            {
+                m_signedData->push_back(Data);
+            }
+
+            buffer.assign(64, 'S');
+        }
+
+        string GetSignatureSubFilter() const override
+        {
+            return "adbe.pkcs7.detached";
+        }
+
+        string GetSignatureType() const override
+        {
+            return "Sig";
+        }
+
+    public:
+        charbuff Data;
+
+    private:
+        vector<charbuff>* m_signedData;
+        unsigned* m_dryRunCount;
+    };
+}
+
+static charbuff createTestDocument();
+static charbuff getByteRangeData(const charbuff& signedDoc, const PdfArray& byteRange);
+static const PdfArray& getByteRange(const PdfMemDocument& doc);
+
+TEST_CASE("TestSignDocument")
+{
+    auto input = createTestDocument();
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(input);
+    auto& page = doc.GetPages().GetPageAt(0);
+    auto& signature = page.CreateField<PdfSignature>("Signature", Rect());
+
+    charbuff output = input;
+    BufferStreamDevice device(output);
+    TestSigner signer;
+    SignDocument(doc, device, signer, signature);
+
+    PdfMemDocument signedDoc;
+    signedDoc.LoadFromBuffer(output);
+    auto& byteRange = getByteRange(signedDoc);
+    REQUIRE(byteRange.GetSize() == 4);
+    REQUIRE(byteRange[2].GetNumber() + byteRange[3].GetNumber() == (int64_t)output.size());
+
+    // The data fed to the signer while writing must be
+    // exactly the data covered by the /ByteRange
+    REQUIRE(signer.Data == getByteRangeData(output, byteRange));
+}
+
+TEST_CASE("TestSignDocuments")
+{
+    constexpr unsigned JobCount = 7;
+    auto input = createTestDocument();
+    vector<unique_ptr<PdfMemDocument>> docs;
+    vector<charbuff> outputs(JobCount * 2, input);
+    vector<unique_ptr<BufferStreamDevice>> devices;
+    vector<PdfSigningJob> jobs;
+    for (unsigned i = 0; i < JobCount * 2; i++)
+    {
+        docs.push_back(std::make_unique<PdfMemDocument>());
+        docs[i]->LoadFromBuffer(input);
+        auto& signature = docs[i]->GetPages().GetPageAt(0).CreateField<PdfSignature>("Signature", Rect());
+        devices.push_back(std::make_unique<BufferStreamDevice>(outputs[i]));
+        jobs.push_back({ docs[i].get(), devices[i].get(), &signature });
+    }
+
+    // Signatures are computed serially in the jobs order
+    vector<charbuff> signedData;
+    unsigned dryRunCount = 0;
+    unsigned signerCount = 0;
+    PdfSigningContext context([&]() {
+        signerCount++;
+        return std::make_unique<TestSigner>(&signedData, &dryRunCount);
+    }, 3);
+    context.SignDocuments({ jobs.begin(), jobs.begin() + JobCount });
+    REQUIRE(signerCount == 3);
+    REQUIRE(dryRunCount == 1);
+
+    // The signers and the signature size are reused
+    context.SignDocuments({ jobs.begin() + JobCount, jobs.end() - 1 });
+    context.SignDocument(*jobs.back().Document, *jobs.back().Device, *jobs.back().Signature);
+    REQUIRE(signerCount == 3);
+    REQUIRE(context.GetSignerCount() == 3);
+    REQUIRE(dryRunCount == 1);
+
+    REQUIRE(signedData.size() == JobCount * 2);
+    for (unsigned i = 0; i < JobCount * 2; i++)
+    {
+        PdfMemDocument signedDoc;
+        signedDoc.LoadFromBuffer(outputs[i]);
+        auto& byteRange = getByteRange(signedDoc);
+        REQUIRE(signedData[i] == getByteRangeData(outputs[i], byteRange));
+    }
+}
+
+TEST_CASE("TestDeferredSigning")
+{
+    auto input = createTestDocument();
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(input);
+    auto& signature = doc.GetPages().GetPageAt(0).CreateField<PdfSignature>("Signature", Rect());
+
+    charbuff output = input;
+    PdfDeferredSigningParams params;
+    params.SignatureSize = 64;
+    charbuff digest;
+    PdfDeferredSigningState state;
+    {
+        BufferStreamDevice device(output);
+        state = PrepareDeferredSigning(doc, device, signature, params, digest);
+    }
+
+    // Finish the signing with a different device
+    {
+        BufferStreamDevice device(output);
+        ASSERT_THROW_WITH_ERROR_CODE(FinishDeferredSigning(device, state, string(65, 'S')), PdfErrorCode::ValueOutOfRange);
+        FinishDeferredSigning(device, state, string(64, 'S'));
+    }
+
+    PdfMemDocument signedDoc;
+    signedDoc.LoadFromBuffer(output);
+    auto data = getByteRangeData(output, getByteRange(signedDoc));
+    unsigned char expected[EVP_MAX_MD_SIZE];
+    unsigned expectedSize;
+    REQUIRE(EVP_Digest(data.data(), data.size(), expected, &expectedSize, EVP_sha256(), nullptr) == 1);
+    REQUIRE(digest == string((const char*)expected, expectedSize));
+}
+
+charbuff createTestDocument()
+{
+    PdfMemDocument doc;
+    auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+    PdfPainter painter;
+    painter.SetCanvas(page);
+    painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+    painter.DrawText("Signed document", 100, 600);
+    painter.FinishDrawing();
+
+    charbuff ret;
+    BufferStreamDevice device(ret);
+    doc.Save(device);
+    return ret;
+}
+
+const PdfArray& getByteRange(const PdfMemDocument& doc)
+{
+    for (auto obj : doc.GetObjects())
+    {
+        const PdfDictionary* dict;
+        if (obj->TryGetDictionary(dict) && dict->HasKey("ByteRange"))
+        {
+            REQUIRE(dict->MustFindKey("Contents").GetString().GetRawData() == string(64, 'S'));
+            return dict->MustFindKey("ByteRange").GetArray();
+        }
+    }
+
+    FAIL("No signature found");
+    throw runtime_error("Unreachable");
+}
+
+charbuff getByteRangeData(const charbuff& signedDoc, const PdfArray& byteRange)
+{
+    charbuff ret;
+    for (unsigned i = 0; i < byteRange.GetSize(); i += 2)
+    {
+        ret.append(signedDoc.data() + byteRange[i].GetNumber(),
+            (size_t)byteRange[i + 1].GetNumber());
+    }
+
+    return ret;
+}
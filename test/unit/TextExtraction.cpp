@@ -45,3 +45,204 @@ TEST_CASE("TextExtraction2")
     ASSERT_EQUAL(entries[0].X, 31.199999999999999);
     ASSERT_EQUAL(entries[0].Y, 801.60000000000002);
 }
+
+TEST_CASE("TextExtractionSession")
+{
+    PdfMemDocument doc;
+    doc.Load(TestUtils::GetTestInputFilePath("TextExtraction1.pdf"));
+    vector<PdfTextEntry> expected;
+    doc.GetPages().GetPageAt(0).ExtractTextTo(expected);
+
+    PdfTextExtractSession session(doc);
+    vector<PdfTextEntry> entries;
+    session.ExtractTextTo(entries, 0, 1);
+    REQUIRE(entries.size() == expected.size());
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        REQUIRE(entries[i].Text == expected[i].Text);
+        ASSERT_EQUAL(entries[i].X, expected[i].X);
+        ASSERT_EQUAL(entries[i].Y, expected[i].Y);
+    }
+
+    ASSERT_THROW_WITH_ERROR_CODE(session.ExtractTextTo(entries, 0, 2), PdfErrorCode::PageNotFound);
+}
+
+TEST_CASE("TextExtractionSessionStrings")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& font = doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica);
+        for (unsigned i = 0; i < 3; i++)
+        {
+            auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            PdfPainter painter;
+            painter.SetCanvas(page);
+            // The same strings with different sizes and spacings,
+            // so cached widths are scaled with the current state
+            painter.TextState.SetFont(font, 10.0 + i * 4);
+            painter.TextState.SetCharSpacing(i);
+            painter.DrawText("Repeated", 100, 600);
+            painter.DrawText("Repeated", 100, 500);
+            painter.FinishDrawing();
+        }
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    vector<PdfTextEntry> expected;
+    for (unsigned i = 0; i < 3; i++)
+        doc.GetPages().GetPageAt(i).ExtractTextTo(expected);
+
+    PdfTextExtractSession session(doc);
+    vector<PdfTextEntry> entries;
+    session.ExtractTextTo(entries);
+    REQUIRE(entries.size() == 6);
+    REQUIRE(entries.size() == expected.size());
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        REQUIRE(entries[i].Text == "Repeated");
+        ASSERT_EQUAL(entries[i].X, expected[i].X);
+        ASSERT_EQUAL(entries[i].Y, expected[i].Y);
+        ASSERT_EQUAL(entries[i].Length, expected[i].Length);
+    }
+}
+
+TEST_CASE("TextExtractionParallel")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& font = doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica);
+        for (unsigned i = 0; i < 20; i++)
+        {
+            auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+            PdfPainter painter;
+            painter.SetCanvas(page);
+            painter.TextState.SetFont(font, 12);
+            painter.DrawText(utls::Format("Page {}", i), 100, 600);
+            painter.FinishDrawing();
+        }
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    PdfTextExtractSession session(doc);
+    session.SetThreadCount(4);
+    vector<PdfTextEntry> entries;
+    session.ExtractTextTo(entries);
+    REQUIRE(entries.size() == 20);
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        REQUIRE(entries[i].Text == utls::Format("Page {}", i));
+        REQUIRE(entries[i].Page == (int)i);
+    }
+}
+
+TEST_CASE("TextExtractionHandler")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+        painter.DrawText("  Hello World", 100, 600);
+        painter.DrawText("Second line ", 100, 500);
+        painter.FinishDrawing();
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    auto& page = doc.GetPages().GetPageAt(0);
+    vector<PdfTextEntry> expected;
+    page.ExtractTextTo(expected);
+
+    vector<PdfTextEntry> entries;
+    page.ExtractTextTo([&entries](PdfTextEntry&& entry) {
+        entries.push_back(std::move(entry));
+    });
+    REQUIRE(expected.size() == 2);
+    REQUIRE(expected[0].Text == "Hello World");
+    REQUIRE(entries.size() == expected.size());
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        REQUIRE(entries[i].Text == expected[i].Text);
+        ASSERT_EQUAL(entries[i].Length, expected[i].Length);
+        REQUIRE(entries[i].Font != nullptr);
+        REQUIRE(entries[i].FontSize == 12);
+    }
+
+    // Text only extraction must produce the same text and positions
+    unsigned count = 0;
+    PdfTextExtractParams params = { };
+    params.Flags = PdfTextExtractFlags::TextOnly;
+    page.ExtractTextTo([&](PdfTextEntry&& entry) {
+        REQUIRE(entry.Text == expected[count].Text);
+        ASSERT_EQUAL(entry.X, expected[count].X);
+        ASSERT_EQUAL(entry.Y, expected[count].Y);
+        REQUIRE(entry.Length == 0);
+        count++;
+    }, { }, params);
+    REQUIRE(count == expected.size());
+
+    // Words are split on the same boundaries
+    params.Flags = PdfTextExtractFlags::TokenizeWords;
+    expected.clear();
+    page.ExtractTextTo(expected, params);
+    REQUIRE(expected.size() == 4);
+    count = 0;
+    params.Flags = PdfTextExtractFlags::TokenizeWords | PdfTextExtractFlags::TextOnly;
+    page.ExtractTextTo([&](PdfTextEntry&& entry) {
+        REQUIRE(entry.Text == expected[count].Text);
+        ASSERT_EQUAL(entry.X, expected[count].X);
+        ASSERT_EQUAL(entry.Y, expected[count].Y);
+        count++;
+    }, { }, params);
+    REQUIRE(count == expected.size());
+
+    params.Flags = PdfTextExtractFlags::TextOnly | PdfTextExtractFlags::ComputeBoundingBox;
+    ASSERT_THROW_WITH_ERROR_CODE(page.ExtractTextTo(entries, params), PdfErrorCode::NotImplemented);
+}
+
+TEST_CASE("TextExtractionClipRegions")
+{
+    charbuff buffer;
+    {
+        PdfMemDocument doc;
+        auto& page = doc.GetPages().CreatePage(PdfPage::CreateStandardPageSize(PdfPageSize::A4));
+        PdfPainter painter;
+        painter.SetCanvas(page);
+        painter.TextState.SetFont(doc.GetFonts().GetStandard14Font(PdfStandard14FontType::Helvetica), 12);
+        for (unsigned i = 0; i < 10; i++)
+            painter.DrawText(utls::Format("Field {}", i), 100, 700 - i * 50.0);
+        painter.FinishDrawing();
+
+        BufferStreamDevice device(buffer);
+        doc.Save(device);
+    }
+
+    PdfMemDocument doc;
+    doc.LoadFromBuffer(buffer);
+    auto& page = doc.GetPages().GetPageAt(0);
+
+    PdfTextExtractParams params = { };
+    params.ClipRegions = { Rect(90, 545, 200, 20), Rect(90, 245, 20, 20), Rect(400, 300, 50, 50) };
+    vector<PdfTextEntry> entries;
+    page.ExtractTextTo(entries, params);
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].Text == "Field 3");
+    ASSERT_EQUAL(entries[0].X, 100);
+    ASSERT_EQUAL(entries[0].Y, 550);
+    REQUIRE(entries[1].Text == "Field 9");
+}
@@ -6,9 +6,12 @@
 #include <podofo/private/PdfDeclarationsPrivate.h>
 #include "ImageExtractor.h"
 
+#include <podofo/private/ParallelUtils.h>
+
 #include <sys/stat.h>
 #include <cstdlib>
 #include <cstdio>
+#include <unordered_map>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -17,8 +20,13 @@
 using namespace std;
 using namespace PoDoFo;
 
+static bool isImage(const PdfObject& obj);
+static bool isJpeg(const PdfObject& obj);
+static string getImageDictKey(const PdfObject& obj);
+static bool isDuplicate(const PdfObject& obj, const string& dictKey, const charbuff& data);
+
 ImageExtractor::ImageExtractor()
-    : m_ImageCount(0), m_fileCounter(0), m_buffer{}
+    : m_ImageCount(0), m_DuplicateCount(0), m_threadCount(1), m_fileCounter(0), m_buffer{}
 {
 }
 
@@ -29,58 +37,89 @@ void ImageExtractor::Init(const string_view& input, const string_view& output)
 
     m_outputDirectory = output;
 
+    CollectImages(document);
+
+    // The images are written to distinct files, and their objects
+    // are fully loaded, so they can be extracted concurrently
+    utls::ParallelFor(m_images.size(), m_threadCount, [&](size_t i)
+    {
+        ExtractImage(m_images[i]);
+    });
+
+    m_ImageCount += (unsigned)m_images.size();
+    m_images.clear();
+}
+
+void ImageExtractor::SetThreadCount(unsigned threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+void ImageExtractor::CollectImages(const PdfMemDocument& document)
+{
+    // Map of image digests to indices of collected images
+    unordered_map<size_t, vector<size_t>> imageIndices;
     for (auto obj : document.GetObjects())
     {
-        if (obj->IsDictionary())
+        if (!isImage(*obj))
+            continue;
+
+        // NOTE: Reading the raw data also forces the
+        // loading of the stream, before the extraction
+        auto data = obj->GetStream()->GetCopy(true);
+        auto dictKey = getImageDictKey(*obj);
+        size_t hash = std::hash<string>()(dictKey) * 31
+            + std::hash<string_view>()(string_view(data.data(), data.size()));
+        auto& indices = imageIndices[hash];
+        const ImageInfo* duplicate = nullptr;
+        for (size_t index : indices)
         {
-            PdfObject* typeObj = obj->GetDictionary().GetKey(PdfName::KeyType);
-            PdfObject* subtypeObj = obj->GetDictionary().GetKey(PdfName::KeySubtype);
-            if ((typeObj && typeObj->IsName() && (typeObj->GetName() == "XObject")) ||
-                (subtypeObj && subtypeObj->IsName() && (subtypeObj->GetName() == "Image")))
+            // Compare the whole image only when the digest matches
+            auto& image = m_images[index];
+            if (image.DataSize == data.size() && isDuplicate(*image.Object, dictKey, data))
             {
-                auto filter = obj->GetDictionary().GetKey(PdfName::KeyFilter);
-                if (filter != nullptr && filter->IsArray() && filter->GetArray().GetSize() == 1 &&
-                    filter->GetArray()[0].IsName() && (filter->GetArray()[0].GetName() == "DCTDecode"))
-                    filter = &filter->GetArray()[0];
-
-                if (filter && filter->IsName() && (filter->GetName() == "DCTDecode"))
-                {
-                    // The only filter is JPEG -> create a JPEG file
-                    ExtractImage(*obj, true);
-                }
-                else
-                {
-                    ExtractImage(*obj, false);
-                }
+                duplicate = &image;
+                break;
             }
         }
-    }
-}
 
-void ImageExtractor::ExtractImage(const PdfObject& obj, bool jpeg)
-{
-    FILE* file = nullptr;
-    const char* extension = jpeg ? "jpg" : "ppm";
+        if (duplicate != nullptr)
+        {
+            printf("-> Skipping image object %s, identical to %s\n", obj->GetIndirectReference().ToString().data(),
+                duplicate->Object->GetIndirectReference().ToString().data());
+            m_DuplicateCount++;
+            continue;
+        }
 
-    // Do not overwrite existing files:
-    do
-    {
-        snprintf(m_buffer, MAX_PATH, "%s/pdfimage_%04i.%s", m_outputDirectory.data(), m_fileCounter++, extension);
+        bool jpeg = isJpeg(*obj);
+        const char* extension = jpeg ? "jpg" : "ppm";
+
+        // Do not overwrite existing files:
+        do
+        {
+            snprintf(m_buffer, MAX_PATH, "%s/pdfimage_%04i.%s", m_outputDirectory.data(), m_fileCounter++, extension);
+        }
+        while (FileExists(m_buffer));
+
+        printf("-> Writing image object %s to the file: %s\n", obj->GetIndirectReference().ToString().data(), m_buffer);
+        indices.push_back(m_images.size());
+        m_images.push_back({ obj, jpeg, m_buffer, data.size() });
     }
-    while (FileExists(m_buffer));
+}
 
-    file = fopen(m_buffer, "wb");
+void ImageExtractor::ExtractImage(const ImageInfo& image)
+{
+    auto& obj = *image.Object;
+    FILE* file = fopen(image.Filename.data(), "wb");
     if (file == nullptr)
     {
         PODOFO_RAISE_ERROR(PdfErrorCode::InvalidHandle);
     }
 
-    printf("-> Writing image object %s to the file: %s\n", obj.GetIndirectReference().ToString().data(), m_buffer);
-
-    if (jpeg)
+    if (image.Jpeg)
     {
-        auto& memprovider = dynamic_cast<const PdfMemoryObjectStream&>(obj.GetStream()->GetProvider());
-        auto& buffer = memprovider.GetBuffer();
+        // The only filter is JPEG -> write the data as it is
+        auto buffer = obj.GetStream()->GetCopy(true);
         fwrite(buffer.data(), buffer.size(), sizeof(char), file);
     }
     else
@@ -101,7 +140,6 @@ void ImageExtractor::ExtractImage(const PdfObject& obj, bool jpeg)
     }
 
     fclose(file);
-    m_ImageCount++;
 }
 
 bool ImageExtractor::FileExists(const string_view& filepath)
@@ -115,3 +153,41 @@ bool ImageExtractor::FileExists(const string_view& filepath)
 
     return result;
 }
+
+bool isImage(const PdfObject& obj)
+{
+    if (!obj.IsDictionary() || obj.GetStream() == nullptr)
+        return false;
+
+    auto typeObj = obj.GetDictionary().GetKey(PdfName::KeyType);
+    auto subtypeObj = obj.GetDictionary().GetKey(PdfName::KeySubtype);
+    return (typeObj && typeObj->IsName() && (typeObj->GetName() == "XObject")) ||
+        (subtypeObj && subtypeObj->IsName() && (subtypeObj->GetName() == "Image"));
+}
+
+bool isJpeg(const PdfObject& obj)
+{
+    auto filter = obj.GetDictionary().GetKey(PdfName::KeyFilter);
+    if (filter != nullptr && filter->IsArray() && filter->GetArray().GetSize() == 1 &&
+        filter->GetArray()[0].IsName() && (filter->GetArray()[0].GetName() == "DCTDecode"))
+        filter = &filter->GetArray()[0];
+
+    return filter && filter->IsName() && (filter->GetName() == "DCTDecode");
+}
+
+// Images with the same dictionary and the same
+// raw data produce the same extracted file
+string getImageDictKey(const PdfObject& obj)
+{
+    // NOTE: /Length may be an indirect object unique to the stream
+    PdfObject dictCopy(obj.GetDictionary());
+    dictCopy.GetDictionary().RemoveKey(PdfName::KeyLength);
+    string ret;
+    dictCopy.ToString(ret);
+    return ret;
+}
+
+bool isDuplicate(const PdfObject& obj, const string& dictKey, const charbuff& data)
+{
+    return getImageDictKey(obj) == dictKey && obj.GetStream()->GetCopy(true) == data;
+}
@@ -26,19 +26,47 @@ public:
      */
     void Init(const std::string_view& input, const std::string_view& output);
 
+    /** Set the number of threads used to write the images.
+     *  The image objects are collected first, then they are
+     *  decoded and written concurrently
+     *  \param threadCount number of threads. 0 means hardware
+     *      concurrency, 1 (default) means serial extraction
+     */
+    void SetThreadCount(unsigned threadCount);
+
     /**
      * \returns the number of succesfully extracted images
      */
     inline unsigned GetNumImagesExtracted() const;
 
+    /**
+     * \returns the number of images skipped because identical
+     *      to an already extracted one
+     */
+    inline unsigned GetNumDuplicateImages() const;
+
+private:
+    struct ImageInfo
+    {
+        const PoDoFo::PdfObject* Object;
+        bool Jpeg;
+        std::string Filename;
+        // Size of the raw data, to quickly tell
+        // apart images with the same digest
+        size_t DataSize;
+    };
+
 private:
+    /** Collect the image objects of the document, skipping
+     *  the ones identical to an already collected image
+     */
+    void CollectImages(const PoDoFo::PdfMemDocument& document);
+
     /** Extracts the image form the given PdfObject
      *  which has to be an XObject with Subtype "Image"
-     *  \param obj a handle to a PDF object
-     *  \param jpeg if true extract as a jpeg, otherwise create a ppm
-     *  \returns ErrOk on success
+     *  \param image the image to extract
      */
-    void ExtractImage(const PoDoFo::PdfObject& obj, bool jpeg);
+    void ExtractImage(const ImageInfo& image);
 
     /** This function checks wether a file with the
      *  given filename does exist.
@@ -49,7 +77,10 @@ private:
 private:
     std::string_view m_outputDirectory;
     unsigned m_ImageCount;
+    unsigned m_DuplicateCount;
+    unsigned m_threadCount;
     unsigned m_fileCounter;
+    std::vector<ImageInfo> m_images;
     char m_buffer[MAX_PATH];
 };
 
@@ -58,4 +89,9 @@ inline unsigned ImageExtractor::GetNumImagesExtracted() const
     return m_ImageCount;
 }
 
+inline unsigned ImageExtractor::GetNumDuplicateImages() const
+{
+    return m_DuplicateCount;
+}
+
 #endif // IMAGE_EXTRACTOR_H
@@ -7,13 +7,16 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <charconv>
 
 using namespace std;
 using namespace PoDoFo;
 
 void print_help()
 {
-    printf("Usage: podofoimgextract [inputfile] [outputdirectory]\n\n");
+    printf("Usage: podofoimgextract [-j threads] [inputfile] [outputdirectory]\n\n");
+    printf("       -j number of threads used to write the images,\n");
+    printf("          0 means one per core. Default is 1\n");
     printf("\nPoDoFo Version: %s\n\n", PODOFO_VERSION_STRING);
 }
 
@@ -21,17 +24,36 @@ void Main(const cspan<string_view>& args)
 {
     ImageExtractor extractor;
 
-    if (args.size() != 3)
+    unsigned i = 1;
+    if (args.size() == 5 && args[1] == "-j")
+    {
+        auto threads = args[2];
+        unsigned threadCount;
+        auto result = std::from_chars(threads.data(), threads.data() + threads.size(), threadCount);
+        if (result.ec != std::errc() || result.ptr != threads.data() + threads.size())
+        {
+            fprintf(stderr, "Invalid number of threads: %s\n\n", string(threads).data());
+            print_help();
+            exit(-1);
+        }
+
+        extractor.SetThreadCount(threadCount);
+        i = 3;
+    }
+    else if (args.size() != 3)
     {
         print_help();
         exit(-1);
     }
 
-    auto input = args[1];
-    auto output = args[2];
+    auto input = args[i];
+    auto output = args[i + 1];
 
     extractor.Init(input, output);
 
     unsigned imageCount = extractor.GetNumImagesExtracted();
     printf("Extracted %u images successfully from the PDF file.\n", imageCount);
+    unsigned duplicateCount = extractor.GetNumDuplicateImages();
+    if (duplicateCount != 0)
+        printf("Skipped %u duplicate images.\n", duplicateCount);
 }
@@ -13,58 +13,77 @@ using namespace PoDoFo;
 
 void print_help()
 {
-    printf("Usage: podofomerge [inputfile1] [inputfile2] [outputfile]\n\n");
+    printf("Usage: podofomerge [inputfile1] [inputfile2] ... [outputfile]\n\n");
     printf("\nPoDoFo Version: %s\n\n", PODOFO_VERSION_STRING);
 }
 
-void merge(const string_view input1Path, const string_view input2Path, const string_view outputPath)
+template <typename T>
+nullable<const T&> asRef(const nullable<T>& value)
 {
-    printf("Reading file: %s\n", input1Path.data());
-    PdfMemDocument input1;
-    input1.Load(input1Path);
-    printf("Reading file: %s\n", input2Path.data());
-    PdfMemDocument input2;
-    input2.Load(input2Path);
+    if (value.has_value())
+        return *value;
+    else
+        return nullptr;
+}
+
+// Copy the document information and the XMP metadata, as
+// the output used to be the first input loaded and modified
+void copyMetadata(PdfDocument& output, const PdfMemDocument& input)
+{
+    auto& src = input.GetMetadata();
+    auto& dst = output.GetMetadata();
+    dst.SetTitle(asRef(src.GetTitle()));
+    dst.SetAuthor(asRef(src.GetAuthor()));
+    dst.SetSubject(asRef(src.GetSubject()));
+    dst.SetKeywords(src.GetKeywords());
+    dst.SetCreator(asRef(src.GetCreator()));
+    dst.SetProducer(asRef(src.GetProducer()));
+    dst.SetCreationDate(src.GetCreationDate());
+    dst.SetModifyDate(src.GetModifyDate());
+    dst.SetTrapped(src.GetTrappedRaw());
 
-    printf("Appending %i pages on a document with %i pages.\n", input2.GetPages().GetCount(), input1.GetPages().GetCount());
-    input1.GetPages().AppendDocumentPages(input2);
+    // NOTE: Set the XMP packet last, as the metadata is read back
+    // from it after, and the output streams can't be read
+    if (input.GetCatalog().GetMetadataObject() != nullptr)
+        output.GetCatalog().SetMetadataStreamValue(input.GetCatalog().GetMetadataStreamValue());
+}
 
-    // we are going to bookmark the insertions
-    // using destinations - also adding each as a NamedDest
-    /*
-      PdfDestination	p1Dest( input1.GetPage(0) );
-    input1.AddNamedDestination( p1Dest, std::string("Input1") );
-    PdfOutlines* bMarks = input1.GetOutlines();
-    PdfOutlineItem*	bmRoot = bMarks->CreateRoot( "Merged Document" );
-    PdfOutlineItem* child1 = bmRoot->CreateChild( pszInput1, p1Dest );
-    PdfDestination	p2Dest( input1.GetPage(pgCount) );
-    input1.AddNamedDestination( p2Dest, std::string("Input2") );
-    child1->CreateNext( pszInput2, p2Dest );
-    */
+void merge(const cspan<string_view>& inputPaths, const string_view outputPath)
+{
+    // The inputs are loaded one at a time, and their pages are
+    // written to the output as soon as they are imported, so
+    // only the largest input is kept in memory
+    printf("Writing file: %s\n", outputPath.data());
+    PdfStreamedDocument output(outputPath);
+    for (auto& inputPath : inputPaths)
+    {
+        printf("Reading file: %s\n", inputPath.data());
+        PdfMemDocument input;
+        input.Load(inputPath);
+
+        if (&inputPath == &inputPaths[0])
+            copyMetadata(output, input);
+
+        printf("Appending %i pages on a document with %i pages.\n", input.GetPages().GetCount(), output.GetPages().GetCount());
+        output.GetPages().AppendDocumentPages(input, PdfImportFlags::DeduplicateStreams);
+    }
 
 #ifdef TEST_FULL_SCREEN
-    input1.GetCatalog().SetUseFullScreen();
+    output.GetCatalog().SetUseFullScreen();
 #else
-    input1.GetCatalog().SetPageMode(PdfPageMode::UseBookmarks);
-    input1.GetCatalog().SetHideToolbar();
-    input1.GetCatalog().SetPageLayout(PdfPageLayout::TwoColumnLeft);
+    output.GetCatalog().SetPageMode(PdfPageMode::UseBookmarks);
+    output.GetCatalog().SetHideToolbar();
+    output.GetCatalog().SetPageLayout(PdfPageLayout::TwoColumnLeft);
 #endif
-
-    printf("Writing file: %s\n", outputPath.data());
-    input1.Save(outputPath);
 }
 
 void Main(const cspan<string_view>& args)
 {
-    if (args.size() != 4)
+    if (args.size() < 4)
     {
         print_help();
         exit(-1);
     }
 
-    auto input1Path = args[1];
-    auto input2Path = args[2];
-    auto outputPath = args[3];
-
-    merge(input1Path, input2Path, outputPath);
+    merge(args.subspan(1, args.size() - 2), args[args.size() - 1]);
 }